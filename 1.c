@@ -1,27 +1,29 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include "util.h"
 
-int main()
+int main(int argc, char *argv[])
 {
     //int d[] = {199,200,208,210,100,207,240,269,260,263};
-    char file_name[] = "data/depths.txt";
-    char buff[8];
+    char *file_name = (argc > 1) ? argv[1] : "data/depths.txt";
 
-    FILE *file_pointer = fopen(file_name, "r");
+    size_t file_size;
+    char *input = read_file(file_name, &file_size);
+    int *depths = NULL;
+    int num_depths = 0, capacity = 0;
+    parse_ints(input, file_size, &depths, &num_depths, &capacity);
+    free(input);
 
-    int previous_depth = 0;
     int descents = 0;
-    int depth = 0;
-    while(fgets(buff, sizeof buff, file_pointer) != NULL) {
-        depth = atoi(buff);
-        if (depth > previous_depth && previous_depth != 0) {
+    int i;
+    for (i = 1; i < num_depths; i++) {
+        if (depths[i] > depths[i - 1]) {
             descents++;
         }
-        previous_depth = depth;
     }
 
     printf("We have descented %d times.\n", descents);
 
-    fclose(file_pointer);
+    free(depths);
     return 0;
 }
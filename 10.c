@@ -35,9 +35,8 @@ Character values for brackets:
 #include <string.h>
 #include <errno.h>
 #include "util.h"
+#include "bench.h"
 
-#define INPUT_LEN 128       // length of each line
-#define MAX_LINES 128       // max number of lines
 #define NUM_BRACKET_TYPES 4 // number of bracket characters we use
 
 const char openers[] = "([{<";
@@ -112,68 +111,8 @@ char match(char input)
     return 0;
 }
 
-/*
-* Push an unsigned long onto the end of an array
-*
-* @param    p_array             pointer to the array to push to
-* @param    p_n                 pointer to the number of elements in the array
-* @param    element             unsigned long element to add to the end of the array
-*/
-void ul_push(unsigned long *p_array, int *p_n, unsigned long element)
-{
-    if (p_array == NULL || p_n == NULL) {
-        printf("Invalid pointer in push()\n");
-        exit(-1);
-    }
-    if (*p_n < 0) {
-        printf("Error: push() attempted to access array of size < 0.\n");
-        exit(-1);
-    }
-    p_array[*p_n] = element;
-    (*p_n)++; // increase array size
-}
-
-/*
-* Push a char onto the end of an array
-*
-* @param    p_array             pointer to the array to push to
-* @param    p_n                 pointer to the number of elements in the array
-* @param    element             char to add to the end of the array
-*/
-void c_push(char *p_array, int *p_n, char element)
-{
-    if (p_array == NULL || p_n == NULL) {
-        printf("Invalid pointer in c_push()\n");
-        exit(-1);
-    }
-    if (*p_n < 0) {
-        printf("Error: c_push() attempted to access array of size < 0.\n");
-        exit(-1);
-    }
-    p_array[*p_n] = element;
-    (*p_n)++; // increase array size
-}
-
-/*
-* pop a char off of the end of an array
-*
-* @param    p_array             pointer to the array to pop from
-* @param    p_n                 pointer to the number of elements in the array
-* @retval   element             char at the end of the array
-*/
-char c_pop(char *p_array, int *p_n)
-{
-    if (p_array == NULL || p_n == NULL) {
-        printf("Invalid pointer in c_pop()\n");
-        exit(-1);
-    }
-    if (*p_n < 0) {
-        printf("Error: c_pop() attempted to access array of size < 0.\n");
-        exit(-1);
-    }
-    (*p_n)--; // decrease the size of the array
-    return p_array[*p_n];
-}
+DEFINE_STACK(CharStack, char)
+DEFINE_VECTOR(ULongVector, unsigned long)
 
 /*
 * Given an illegal character, return its score.
@@ -249,7 +188,7 @@ void print_array_ul(unsigned long array[], int n)
 * @retval       0           sort successful
 * @retval       1           sort failure
 */
-int array_sort_descending(unsigned long *array, int n, int n_to_sort)
+int sort_scores_descending(unsigned long *array, int n, int n_to_sort)
 {
     if (array == NULL) {
         printf("Error: Bad pointer.\n");
@@ -278,83 +217,154 @@ int array_sort_descending(unsigned long *array, int n, int n_to_sort)
     return 0; // success
 }
 
+/* The navigation subsystem: every line of the input, and the scores of
+   the corrupted and incomplete lines once they have been checked. */
+struct Navigation {
+    const char **lines;
+    size_t *line_lens;
+    int num_lines;
+    struct IntVector score_corrupted;      // part 1
+    struct ULongVector score_incomplete;   // part 2
+};
+
 /*
-* Read and solve the puzzle.
+* Check one line's brackets. A corrupted line scores its first illegal
+* closer, an incomplete line scores the closers needed to finish it.
 *
-* @param    datafile        data file to open
+* @param    nav                 navigation subsystem to add the score to
+* @param    line                the line (without newline)
+* @param    line_len            length of the line
+* @param    opening_brackets    stack of opening brackets (scratch)
 */
-void read_puzzle(char datafile[])
+void check_line(struct Navigation *nav, const char *line, size_t line_len,
+        struct CharStack *opening_brackets)
 {
-    FILE *file_stream = fopen(datafile, "r");
-    if (file_stream == NULL) {
-        printf("Error reading input file %s: %s\n", datafile, strerror(errno));
-        exit(-1);
+    unsigned long score_part_2 = 0;
+    char current_char;
+    CharStack_clear(opening_brackets);
+    for (size_t char_index = 0; char_index < line_len; char_index++) {
+        current_char = line[char_index];
+        // if character is opening bracket, add it to the stack
+        if (is_opener(current_char)) {
+            CharStack_push(opening_brackets, current_char);
+        } else if (is_closer(current_char)) { // else if character is closing bracket, 
+            // pop the stack and compare them
+            if (opening_brackets->size > 0 &&
+                    CharStack_pop(opening_brackets) == match(current_char)) {
+                // if they match, continue
+                continue;
+            } else {
+                // if not a match, score the illegal character
+                IntVector_push(&nav->score_corrupted, bracket_score(current_char));
+                return; // line is corrupted
+            }
+        }
     }
-    // track num opening brackets
-    int num_openers;
-
-    // array to track part 1
-    int num_corrupted_lines = 0;
-    int score_corrupted[MAX_LINES];
+    // part II:
+    while (opening_brackets->size > 0) { // add closing brackets to all unclosed
+        char next = CharStack_pop(opening_brackets);
+        score_part_2 = part_2_score(match(next), score_part_2);
+    }
+    ULongVector_push(&nav->score_incomplete, score_part_2);
+}
 
-    // array to track part 2
-    int num_incomplete_lines = 0;
-    unsigned long score_incomplete[MAX_LINES]; 
+void *day10_parse(const char *input, size_t size)
+{
+    struct Navigation *nav = calloc(1, sizeof(struct Navigation));
+    assert(nav != NULL);
+    int capacity = 0;
+    const char *line = input, *end = input + size;
+    while (line < end) {
+        size_t line_len = strcspn(line, "\r\n");
+        if (line_len > 0) {
+            if (nav->num_lines == capacity) {
+                capacity = (capacity > 0) ? 2 * capacity : 256;
+                nav->lines = realloc(nav->lines, capacity * sizeof(char *));
+                nav->line_lens = realloc(nav->line_lens, capacity * sizeof(size_t));
+                assert(nav->lines != NULL && nav->line_lens != NULL);
+            }
+            nav->lines[nav->num_lines] = line;
+            nav->line_lens[nav->num_lines] = line_len;
+            nav->num_lines++;
+        }
+        line += line_len + 1;
+    }
+    return nav;
+}
 
-    // buffers for opening brackets & input
-    char opening_brackets[INPUT_LEN];
-    char input_buffer[INPUT_LEN];
+/* Checking the lines scores both parts, part 2 just picks the middle */
+void day10_part1(void *puzzle, char answer[ANSWER_LEN])
+{
+    struct Navigation *nav = puzzle;
+    // stack of opening brackets
+    struct CharStack opening_brackets = { 0 };
+    for (int i = 0; i < nav->num_lines; i++)
+        check_line(nav, nav->lines[i], nav->line_lens[i], &opening_brackets);
+    CharStack_free(&opening_brackets);
 
-    // read the file one line at a time
-    while (fgets(input_buffer, sizeof(input_buffer), file_stream)) {
-        unsigned long score_part_2 = 0;
-        char current_char;
-        num_openers = 0;    // reset counter to zero
-        for (int char_index = 0; char_index < INPUT_LEN; char_index++) {
-            // get the next character from the buffer
-            current_char = input_buffer[char_index];
-            if (current_char == '\n') 
-                break; // go to next line
+    int num_corrupted_lines = nav->score_corrupted.size;
+    snprintf(answer, ANSWER_LEN, "%d",
+            sum(nav->score_corrupted.data, &num_corrupted_lines));
+}
 
-            // if character is opening bracket, add it to the stack
-            if (is_opener(current_char)) {
-                c_push(opening_brackets, &num_openers, current_char);
-            } else if (is_closer(current_char)) { // else if character is closing bracket, 
-                // pop the stack and compare them
-                if (c_pop(opening_brackets, &num_openers) == match(current_char)) {
-                    // if they match, continue
-                    continue;
-                } else {
-                    // if not a match, return the illegal character
-                    push(score_corrupted, &num_corrupted_lines, bracket_score(current_char));
-                    goto next_line; // line is corrupted, move to next
-                }
-            }
-        }
-        // part II:
-        while (num_openers > 0) { // add closing brackets to all unclosed
-            char next = c_pop(opening_brackets, &num_openers);
-            score_part_2 = part_2_score(match(next), score_part_2);
-        }
-        // add final score to array of 
-        ul_push(score_incomplete, &num_incomplete_lines, score_part_2);
-        /*printf(" - Score: %lu", score_part_2);*/
-next_line:
-        ;
+void day10_part2(void *puzzle, char answer[ANSWER_LEN])
+{
+    struct Navigation *nav = puzzle;
+    int num_incomplete_lines = nav->score_incomplete.size;
+    if (num_incomplete_lines > 0) {
+        sort_scores_descending(nav->score_incomplete.data, num_incomplete_lines,
+                num_incomplete_lines);
+        snprintf(answer, ANSWER_LEN, "%lu",
+                nav->score_incomplete.data[num_incomplete_lines/2]);
     }
+}
+
+void day10_free(void *puzzle)
+{
+    struct Navigation *nav = puzzle;
+    free(nav->lines);
+    free(nav->line_lens);
+    IntVector_free(&nav->score_corrupted);
+    ULongVector_free(&nav->score_incomplete);
+    free(nav);
+}
+
+const struct Solver day10_solver = {
+    "10", day10_parse, day10_part1, day10_part2, day10_free, 1
+};
+
+/*
+* Read and solve the puzzle.
+*
+* @param    datafile        data file to open
+*/
+void read_puzzle(char datafile[])
+{
+    size_t file_size;
+    char *input = read_file(datafile, &file_size);
+    struct Navigation *nav = day10_parse(input, file_size);
+    char answer[ANSWER_LEN];
+
+    day10_part1(nav, answer);
     printf("\n");
-    printf("Num corrupted: %d\n", num_corrupted_lines);
-    printf("Corrupted Line Score: %d\n", sum(score_corrupted, &num_corrupted_lines));
-    printf("Num incomplete: %d\n", num_incomplete_lines);
-    array_sort_descending(score_incomplete, num_incomplete_lines, num_incomplete_lines);
-    /*print_array_ul(score_incomplete, num_incomplete_lines);*/
-    printf("Incomplete Line Middle Score: %lu\n", score_incomplete[num_incomplete_lines/2]);
+    printf("Num corrupted: %zu\n", nav->score_corrupted.size);
+    printf("Corrupted Line Score: %s\n", answer);
+    printf("Num incomplete: %zu\n", nav->score_incomplete.size);
+    if (nav->score_incomplete.size > 0) {
+        day10_part2(nav, answer);
+        printf("Incomplete Line Middle Score: %s\n", answer);
+    }
 
-    fclose(file_stream);
+    day10_free(nav);
+    free(input);
 }
 
+#ifndef AOC_DRIVER
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day10_solver, argc - 1, argv + 1);
+
     printf("Part 1:\n");
     printf("Test Input ");
     read_puzzle("data/10test"); 
@@ -363,3 +373,4 @@ int main(int argc, char *argv[])
     read_puzzle("data/10data"); 
     return 0;
 }
+#endif
@@ -22,168 +22,82 @@ Part I Plan:
 #include <stdint.h>
 #include <errno.h>
 #include <string.h>
-#include <time.h>
+#include "util.h"
+#include "bench.h"
 
 //#define PRINT_DEBUG // comment out to hide debugging
-#define CLOCK_INIT clock_t start_time, end_time;
-#define CLOCK_START start_time = clock();
-#define CLOCK_END end_time = clock(); printf("Executed in %.6f seconds.\n", (float)(end_time - start_time)/CLOCKS_PER_SEC);
 
 struct OctopusArmy {
+    struct Arena *arena;        // the army and its energy levels live here
     int num_rows;
     int num_cols;
     int num_octopuses;
     uint8_t *energy_levels;
+    int step;                   // steps taken so far
+    unsigned total_flashes;     // flashes so far
+    int first_sync;             // first step every octopus flashed, 0 if none yet
 };
 
 /*
-* Read a datafile of inital energy levels and fill an army of flashing octopi 
+* Fill an army of flashing octopi from rows of initial energy levels
 *
-* @param    datafile        the data file to read from
+* @param    input           the input, zero terminated
+* @param    size            size of the input
 * @retval   p_army_t        an army of octopuses, what else?
+* @retval   NULL            the rows are not all as long as the first
 */
-struct OctopusArmy *Assemble(char datafile[])
+struct OctopusArmy *OctopusArmy_parse(const char *input, size_t size)
 {
-    FILE *file_stream = fopen(datafile, "r");
-    if (file_stream == NULL) {
-        printf("Error: Could not open file %s: %s.\n", datafile, strerror(errno));
-        exit(-1);
-    }
-    struct OctopusArmy *p_army_t = malloc(sizeof(struct OctopusArmy));
-
-    // determine number of columns
-    while(fgetc(file_stream) != '\n');
-    p_army_t->num_cols = ftell(file_stream) / sizeof(char) - 1;
-
-    // determine number of rows
-    fseek(file_stream, 0, EOF);
-    p_army_t->num_rows = ftell(file_stream) / sizeof(char) - 1;
-    rewind(file_stream);
-
-    p_army_t->num_octopuses = p_army_t->num_rows * p_army_t->num_cols;
-
-    p_army_t->energy_levels = malloc(p_army_t->num_rows * p_army_t->num_cols * sizeof(uint8_t));
+    struct Arena *arena = Arena_create(sizeof(struct OctopusArmy) + size + 2 * ARENA_ALIGN);
+    struct OctopusArmy *p_army_t = Arena_calloc(arena, 1, sizeof(struct OctopusArmy));
+    p_army_t->arena = arena;
+    p_army_t->energy_levels = Arena_alloc(arena, size + 1);
 
     int octopus_index = 0;
-    char next_octopus;
-    while((next_octopus = fgetc(file_stream)) != EOF) {
-        if (next_octopus == '\n') continue;
+    for (size_t i = 0; i < size; i++) {
+        if (input[i] < '0' || input[i] > '9') continue;
 
-        p_army_t->energy_levels[octopus_index] = next_octopus - '0';
+        p_army_t->energy_levels[octopus_index] = input[i] - '0';
         octopus_index++;
     }
 
-    fclose(file_stream);
+    p_army_t->num_cols = strcspn(input, "\r\n");
+    if (p_army_t->num_cols == 0 || octopus_index % p_army_t->num_cols != 0) {
+        Arena_destroy(arena);
+        return NULL;
+    }
+    p_army_t->num_rows = octopus_index / p_army_t->num_cols;
+    p_army_t->num_octopuses = octopus_index;
     return p_army_t;
 }
 
 /*
-* Disperse the army of octopuses back to their ocean homes.
-*
-* @param    p_army_t            pointer to the army to disperse
-*/
-void OctopusArmy_disperse(struct OctopusArmy *p_army_t)
-{
-    free(p_army_t->energy_levels);
-    free(p_army_t);
-}
-
-/*
-* Remove an element from the end of a queue and return it.
+* Read a datafile of inital energy levels and fill an army of flashing octopi 
 *
-* @param    p_queue             queue structure to pop element from
-* @param    p_queue_length      pointer to length of the queue.
-* @retval                       value of last item in the queue.
-*/
-int dequeue(int *p_queue, unsigned *p_queue_length)
-{
-    if (p_queue == NULL || p_queue_length == NULL) {
-        printf("Bad pointer sent to dequeue().\n");
-        exit(-1);
-    } else if (*p_queue_length < 1) {
-        printf("Dequeue tried to access queue with length %d.\n", *p_queue_length);
-        exit(-1);
-    } 
-    (*p_queue_length)--; // decrease the length of the queue
-    return p_queue[*p_queue_length];
-}
-
-/*
-* Add an element to the rear of the queue
-* 
-* @param    p_queue             queue structure to add element to
-* @param    p_queue_length      pointer to length of the queue.
-*/
-void queue(int *p_queue, unsigned *p_queue_length, int element)
-{
-    if (p_queue == NULL || p_queue_length == NULL) {
-        printf("Bad pointer sent to queue().\n");
-        exit(-1);
-    } else if (*p_queue_length < 0) {
-        printf("queue tried to access queue with length %d.\n", *p_queue_length);
-        exit(-1);
-    }
-    (*p_queue_length)++; // make space in the queue
-    for (unsigned queue_index = *p_queue_length - 1; queue_index > 0; queue_index--) {
-        p_queue[queue_index] = p_queue[queue_index - 1];
-    }
-    p_queue[0] = element;
-}
-
-/*
-* Add an element to top of a stack
-* 
-* @param    p_stack             stack structure to add element to
-* @param    p_stack_length      pointer to length of the stack.
+* @param    datafile        the data file to read from
+* @retval   p_army_t        an army of octopuses, what else?
 */
-void push(int *p_stack, unsigned *p_stack_length, int element)
+struct OctopusArmy *Assemble(char datafile[])
 {
-    if (p_stack == NULL || p_stack_length == NULL) {
-        printf("Bad pointer sent to push().\n");
-        exit(-1);
-    } else if (*p_stack_length < 0) {
-        printf("push() tried to access stack with length %d.\n", *p_stack_length);
+    size_t file_size;
+    char *input = read_file(datafile, &file_size);
+    struct OctopusArmy *p_army_t = OctopusArmy_parse(input, file_size);
+    free(input);
+    if (p_army_t == NULL) {
+        printf("Error: Octopus rows are not all the same length.\n");
         exit(-1);
     }
-    p_stack[*p_stack_length] = element;
-    (*p_stack_length)++; // make space in the stack
-    /*printf("Push: %d to stack size %d.\n", element, *p_stack_length);*/
-}
-
-/*
-* Remove an element from the end of a queue and return it.
-*
-* @param    p_stack             stack structure to pop element from
-* @param    p_stack_length      pointer to length of the stack.
-* @retval                       value of last item in the stack.
-*/
-int pop(int *p_stack, unsigned *p_stack_length)
-{
-    if (p_stack == NULL || p_stack_length == NULL) {
-        printf("Bad pointer sent to pop().\n");
-        exit(-1);
-    } else if (*p_stack_length < 1) {
-        printf("pop() tried to access stack with length %d.\n", *p_stack_length);
-        exit(-1);
-    } 
-    (*p_stack_length)--; // decrease the length of the stack
-    return p_stack[(*p_stack_length)];
+    return p_army_t;
 }
 
 /*
-* DEBUG: Print a queue array
+* Disperse the army of octopuses back to their ocean homes.
 *
-* @param    p_queue         pointer to queue to print
-* @param    p_queue_length  pointer to length of queue
+* @param    p_army_t            pointer to the army to disperse
 */
-void print_queue(int *p_queue, unsigned *p_queue_length)
+void OctopusArmy_disperse(struct OctopusArmy *p_army_t)
 {
-#ifdef PRINT_DEBUG
-    printf("[ ");
-    for (unsigned i = 0; i < *p_queue_length; i++) 
-        printf("%d ", p_queue[i]);
-    printf("]\n");
-#endif
+    Arena_destroy(p_army_t->arena);
 }
 
 /*
@@ -210,18 +124,17 @@ void OctopusArmy_info(struct OctopusArmy *p_army_t)
 *
 * @param    p_army_t        the army of octopuses
 * @param    octopus_index   the index within the army of the flasher
-* @param    p_energy_stack  The stack of octopuses to have their energy raised
-* @param    p_stack_length  the length of the energy stack
+* @param    energy_stack    The stack of octopuses to have their energy raised
 */
 void charge_neighbors(struct OctopusArmy *p_army_t, int octopus_index,
-        int *p_energy_stack, unsigned *p_stack_length)
+        struct IntVector *energy_stack)
 {
     if (p_army_t == NULL) {
         printf("Error: Bad pointer to OctopusArmy in charge_neighbors().\n");
         exit(-1);
     }
 
-    int self_row = octopus_index / p_army_t->num_rows;
+    int self_row = octopus_index / p_army_t->num_cols;
     int self_col = octopus_index % p_army_t->num_cols;
 
     for (int neighbor_row = self_row - 1; neighbor_row <= self_row + 1; neighbor_row++) {
@@ -237,10 +150,71 @@ void charge_neighbors(struct OctopusArmy *p_army_t, int octopus_index,
                 continue;
             int neighbor_index = neighbor_col + neighbor_row * p_army_t->num_cols;
             if (p_army_t->energy_levels[neighbor_index] < 10)
-                push(p_energy_stack, p_stack_length, neighbor_index);
+                IntVector_push(energy_stack, neighbor_index);
+        }
+    }
+
+}
+
+/*
+* Take one step: every octopus gains energy, and those that flash charge
+* their neighbors.
+*
+* @param    p_army_t        pointer to the octopus army
+* @param    energy_stack    stack of octopuses to raise (scratch)
+* @retval   step_flashes    number of octopuses that flashed this step
+*/
+int OctopusArmy_step(struct OctopusArmy *p_army_t, struct IntVector *energy_stack)
+{
+    int step_flashes = 0;
+
+    // add all octopi to the energy increase queue
+    for (int octopus_index = 0; octopus_index < p_army_t->num_octopuses; octopus_index++) {
+        if (p_army_t->energy_levels[octopus_index] < 10)
+            IntVector_push(energy_stack, octopus_index);
+
+        while(energy_stack->size > 0) {
+            int energy_index = IntVector_pop(energy_stack);
+            p_army_t->energy_levels[energy_index] += 1;
+            if (p_army_t->energy_levels[energy_index] == 10) {
+                step_flashes++;
+                charge_neighbors(p_army_t, energy_index, energy_stack);
+            }
         }
     }
 
+    // reset all octopuses that flashed to 0 energy
+    for (int octopus_index = 0; octopus_index < p_army_t->num_octopuses; octopus_index++) {
+        if (p_army_t->energy_levels[octopus_index] > 9)
+            p_army_t->energy_levels[octopus_index] = 0;
+    }
+
+    p_army_t->total_flashes += step_flashes;
+    p_army_t->step++;
+    if (step_flashes == p_army_t->num_octopuses && p_army_t->first_sync == 0)
+        p_army_t->first_sync = p_army_t->step;
+    return step_flashes;
+}
+
+/*
+* Step an army until a given step, or until it synchronizes
+*
+* @param    p_army_t        pointer to the octopus army
+* @param    target_step     step to stop at, 0 to run until the first step
+*                           every octopus flashes in (which may have passed)
+* @retval   step_flashes    number of octopuses that flashed in the last step
+*/
+int OctopusArmy_run(struct OctopusArmy *p_army_t, int target_step)
+{
+    struct IntVector energy_stack = { 0 };
+    IntVector_reserve(&energy_stack, p_army_t->num_octopuses);
+    int step_flashes = 0;
+    while (target_step > 0 ? p_army_t->step < target_step
+            : p_army_t->first_sync == 0) {
+        step_flashes = OctopusArmy_step(p_army_t, &energy_stack);
+    }
+    IntVector_free(&energy_stack);
+    return step_flashes;
 }
 
 /*
@@ -260,85 +234,65 @@ unsigned OctopusArmy_flash(struct OctopusArmy *p_army_t, int target_step)
         printf("Error: Cannot flash for less than 1 step.\n");
         return 0;
     }
-    unsigned total_flashes = 0;
-    int step_flashes = 0;
-    int step = 0;
-
-    int *energy_stack = malloc(p_army_t->num_octopuses * sizeof(int*) * 9);
-    while(step_flashes != p_army_t->num_octopuses) {
-        step_flashes = 0;
-
-        unsigned stack_size = 0;
-
-        // add all octopi to the energy increase queue
-        for (int octopus_index = 0; octopus_index < p_army_t->num_octopuses; octopus_index++) {
-            if (p_army_t->energy_levels[octopus_index] < 10)
-                push(energy_stack, &stack_size, octopus_index);
-
-            while(stack_size > 0) {
-                int energy_index = pop(energy_stack, &stack_size);
-                p_army_t->energy_levels[energy_index] += 1;
-                if (p_army_t->energy_levels[energy_index] == 10) {
-                    step_flashes++;
-                    charge_neighbors(p_army_t, energy_index, energy_stack, &stack_size);
-                }
-            }
-        }
 
-        // reset all octopuses that flashed to 0 energy
-        for (int octopus_index = 0; octopus_index < p_army_t->num_octopuses; octopus_index++) {
-            if (p_army_t->energy_levels[octopus_index] > 9)
-                p_army_t->energy_levels[octopus_index] = 0;
-        }
+    OctopusArmy_run(p_army_t, target_step);
+    printf("Total of %u flashes after %d steps.\n", p_army_t->total_flashes,
+            p_army_t->step);
+    OctopusArmy_run(p_army_t, 0);
+    printf("Octopuses sync after %d steps and %u flashes.\n", p_army_t->first_sync,
+            p_army_t->total_flashes);
 
-        total_flashes += step_flashes;
-        step++;
-        if (step == target_step) {
-            printf("Total of %u flashes after %d steps.\n", total_flashes, step);
-        }
-    }
-    energy_stack = NULL;
-    free(energy_stack);
-    printf("Octopuses sync after %d steps and %u flashes.\n", step, total_flashes);
+    return p_army_t->total_flashes;
+}
 
-    return total_flashes;
+void *day11_parse(const char *input, size_t size)
+{
+    return OctopusArmy_parse(input, size);
 }
 
-int main(int argc, char *argv[])
+void day11_part1(void *army, char answer[ANSWER_LEN])
 {
+    OctopusArmy_run(army, 100);
+    snprintf(answer, ANSWER_LEN, "%u", ((struct OctopusArmy *)army)->total_flashes);
+}
 
-    int num_steps = 100; // set arbitrarily high to solve part II
-    CLOCK_INIT
-    CLOCK_START
-    struct OctopusArmy *test_army = Assemble("data/11test");
-    printf("Test Input:\n");
-    OctopusArmy_flash(test_army, num_steps);
-    OctopusArmy_info(test_army);
-    OctopusArmy_disperse(test_army);
-    CLOCK_END
-
-    CLOCK_START
-    struct OctopusArmy *data_army = Assemble("data/11data");
-    printf("Puzzle Input:\n");
-    OctopusArmy_flash(data_army, num_steps);
-    OctopusArmy_info(data_army);
-    OctopusArmy_disperse(data_army);
-    CLOCK_END
-
-    CLOCK_START
-    struct OctopusArmy *big_army = Assemble("bigdata/11-100");
-    printf("Big Input (100x100):\n");
-    OctopusArmy_flash(big_army, num_steps);
-    OctopusArmy_info(big_army);
-    OctopusArmy_disperse(big_army);
-    CLOCK_END
-
-    CLOCK_START
-    struct OctopusArmy *bigger_army = Assemble("bigdata/11-1000");
-    printf("Bigger Input (1000x1000):\n");
-    OctopusArmy_flash(bigger_army, num_steps);
-    OctopusArmy_info(bigger_army);
-    OctopusArmy_disperse(bigger_army);
-    CLOCK_END
+/* carries on from the step part 1 stopped at */
+void day11_part2(void *army, char answer[ANSWER_LEN])
+{
+    OctopusArmy_run(army, 0);
+    snprintf(answer, ANSWER_LEN, "%d", ((struct OctopusArmy *)army)->first_sync);
+}
+
+void day11_free(void *army)
+{
+    OctopusArmy_disperse(army);
+}
+
+const struct Solver day11_solver = {
+    "11", day11_parse, day11_part1, day11_part2, day11_free, 1
+};
+
+#ifndef AOC_DRIVER
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day11_solver, argc - 1, argv + 1);
+
+    // usage: 11 [datafile ...]
+    char *default_files[] = { "data/11test", "data/11data" };
+    char **datafiles = (argc > 1) ? argv + 1 : default_files;
+    int num_files = (argc > 1) ? argc - 1 : 2;
+
+    int num_steps = 100;
+    for (int i = 0; i < num_files; i++) {
+        uint64_t start_time = bench_now();
+        struct OctopusArmy *army = Assemble(datafiles[i]);
+        printf("%s (%dx%d):\n", datafiles[i], army->num_rows, army->num_cols);
+        OctopusArmy_flash(army, num_steps);
+        OctopusArmy_info(army);
+        OctopusArmy_disperse(army);
+        printf("Executed in %.6f seconds.\n", (bench_now() - start_time) / 1e9);
+    }
     return 0;
 }
+#endif
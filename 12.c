@@ -30,76 +30,25 @@ c--A-----b--d
 #include <string.h>
 #include <errno.h>
 #include <ctype.h>
+#include "util.h"
+#include "bench.h"
 
-#define WTF 25
 // #define PRINT_DEBUG
-// arbitrarily large
-#define MAX_CAVES 128
 
 struct Cave {
     char name[8];       // longest cave name is 'start'
-    int num_tunnels;
-    int tunnels[MAX_CAVES - 1];
+    struct IntVector tunnels;   // indices of connected caves
 };
 
+DEFINE_VECTOR(CaveList, struct Cave *)
+
 struct CaveNetwork {            // graph
-    struct Cave *caves[MAX_CAVES];         // nodes
-    unsigned num_caves;
+    struct Arena *arena;        // the caves live here
+    struct CaveList caves;      // nodes
     unsigned num_tunnels;
+    int small_twice;            // one small cave may be visited twice (part 2)
 };
 
-/*
-* Read and input file into the buffer
-*
-* @param    file_name           input file to read
-* @param    p_file_size_ret     pointer to file size to return
-* @retval   input_buffer        file contents.
-*/
-char* read_input(char file_name[], int *p_num_rows)
-{
-    FILE *file_handle = fopen(file_name, "r");
-    if (file_handle == NULL) {
-        printf("Error opening file %s: %s.\n", file_name, strerror(errno));
-        exit(-1);
-    }
-
-    fseek(file_handle, 0, SEEK_END);
-    size_t file_size = ftell(file_handle);
-    rewind(file_handle);
-
-    //printf("File size %ld.\n", file_size);
-    char *input_buffer = (char*)malloc(file_size + 1);
-    if (input_buffer == NULL) {
-        printf("Error allocating memory to input buffer. Buffer size %ld bytes.\n",
-                file_size);
-        exit(-1);
-    }
-
-    int bytes_read = fread((void*)input_buffer, sizeof(unsigned char),
-            file_size, file_handle);
-
-    if (bytes_read != file_size) {
-        printf("Error reading %s: %s. Expected %ld bytes, read %d bytes.\n",
-                file_name, strerror(errno), file_size, bytes_read);
-        exit(-1);
-    }
-
-    char tmp;
-    rewind(file_handle);
-    while ((tmp = fgetc(file_handle)) != EOF) {
-        // every row has a '-', regardless of \n or \0
-        if (tmp == '-') {
-            (*p_num_rows)++;
-        }
-    }
-    fclose(file_handle);
-
-    // store a zero at the end so we know when to quit
-    input_buffer[file_size] = 0;
-    
-    return input_buffer;
-}
-
 /*
 * Determine whether a cave is big or small
 * @param    p_cave_t    pointer to cave
@@ -122,24 +71,19 @@ int Cave_create(char cave_name[], int name_len, struct CaveNetwork *p_network_t)
 {
     // check if cave already exists in network
     int cave_index;
-    for (cave_index = 0; cave_index < p_network_t->num_caves;
+    for (cave_index = 0; cave_index < p_network_t->caves.size;
             cave_index++) {
-        // strcmp returns 0 if strings match
-        if (!strncmp(p_network_t->caves[cave_index]->name,
-                    (char *)cave_name, name_len)) 
+        // strcmp returns 0 if strings match. The whole name has to
+        // match, or "st" would be found as "start".
+        if (!strcmp(p_network_t->caves.data[cave_index]->name, cave_name))
             return cave_index;
     }
 
-    struct Cave *p_cave_t_ret = malloc(sizeof(struct Cave));
-    if (p_cave_t_ret == NULL) {
-        printf("Error allocating data for cave: %s\n", strerror(errno));
-        exit(-1);
-    }
+    struct Cave *p_cave_t_ret = Arena_alloc(p_network_t->arena, sizeof(struct Cave));
     strcpy(p_cave_t_ret->name, cave_name);
-    p_cave_t_ret->num_tunnels = 0;
+    p_cave_t_ret->tunnels = (struct IntVector){ 0 };
 
-    p_network_t->caves[p_network_t->num_caves] = p_cave_t_ret;
-    p_network_t->num_caves++;
+    CaveList_push(&p_network_t->caves, p_cave_t_ret);
 
     return cave_index;
 }
@@ -151,55 +95,54 @@ int Cave_create(char cave_name[], int name_len, struct CaveNetwork *p_network_t)
 * @param    p_network_t     the cave network
 * @param    p_tunnels       An integer array of cave indices representing tunnels.
 *                           Pairs of indices represent connections
-* @retval   0               Success
-* @retval   1               Error assigning tunnels
 */
 void Network_assign_tunnels(struct CaveNetwork *p_network_t, int *p_tunnels)
 {
-    if (p_network_t == NULL) {
-        printf("Error: NULL Cave Network: %s\n", strerror(errno));
-        exit(-1);
-    }
-    if ((*p_tunnels % 2) != 0) {
-        printf("Error: Uneven number of tunnels!\n");
-        exit(-1);
-    }
-
     // loop through the tunnels array two at a time
     for (int i = 0; i < p_network_t->num_tunnels * 2; i += 2) {
         // create pointers to the cave pairs
-        struct Cave *p_cave_1 = p_network_t->caves[p_tunnels[i]];
-        struct Cave *p_cave_2 = p_network_t->caves[p_tunnels[i+1]];
+        struct Cave *p_cave_1 = p_network_t->caves.data[p_tunnels[i]];
+        struct Cave *p_cave_2 = p_network_t->caves.data[p_tunnels[i+1]];
 
         // Assign tunnels to opposite caves
-        p_cave_1->tunnels[p_cave_1->num_tunnels] = p_tunnels[i+1];
-        p_cave_2->tunnels[p_cave_2->num_tunnels] = p_tunnels[i];
-
-        p_cave_1->num_tunnels++;
-        p_cave_2->num_tunnels++;
+        IntVector_push(&p_cave_1->tunnels, p_tunnels[i+1]);
+        IntVector_push(&p_cave_2->tunnels, p_tunnels[i]);
     }
 }
 
 /*
-* Read an input file of connections to create a cave network.
+* Parse a list of connections into a cave network.
 *
-* @param    file_name           data file to open
+* @param    input               the input, zero terminated
+* @param    size                size of the input
 * @retval   p_network_t_ret     pointer to cave network
+* @retval   NULL                a line is not two names joined by '-'
 */
-struct CaveNetwork *Network_create(char file_name[])
+struct CaveNetwork *Network_parse(const char *input, size_t size)
 {
-    // read the input file
+    // every row is "name-name", names being letters only
     int num_rows = 0;
-    char *input_buffer = read_input(file_name, &num_rows);
-    if (input_buffer == NULL) {
-        printf("Error reading file %s: %s.\n", 
-                file_name, strerror(errno));
-        exit(-1);
+    const char *row = input, *end = input + size;
+    while (row < end) {
+        size_t row_len = strcspn(row, "\r\n");
+        if (row_len > 0) {
+            size_t first = 0, second = 0;
+            while (first < row_len && isalpha((unsigned char)row[first]))
+                first++;
+            while (first + 1 + second < row_len
+                    && isalpha((unsigned char)row[first + 1 + second]))
+                second++;
+            if (first == 0 || second == 0 || row[first] != '-'
+                    || first + 1 + second != row_len)
+                return NULL;
+            num_rows++;
+        }
+        row += row_len + 1;
     }
 
     // allocate memory for the cave network
-    struct CaveNetwork *p_network_t_ret = malloc(sizeof(struct CaveNetwork));
-    p_network_t_ret->num_caves = 0;
+    struct CaveNetwork *p_network_t_ret = calloc(1, sizeof(struct CaveNetwork));
+    p_network_t_ret->arena = Arena_create(0);
     p_network_t_ret->num_tunnels = num_rows;
 
     // create "start" and "end" caves to ensure they
@@ -207,45 +150,61 @@ struct CaveNetwork *Network_create(char file_name[])
     Cave_create("start", 5, p_network_t_ret);   // index 0
     Cave_create("end", 3, p_network_t_ret);     // index 1
 
-    char *p_cave_name = input_buffer;
+    const char *p_cave_name = input;
 
     // connections array sized such that each
     // pair of indices (e.g. 0-1 and 2-3) represents a connection
 
     // each row in the data file represents one tunnel between two caves
-    int tunnels[2 * num_rows];
-    int tunnel_index = 0;
-
-    // preserve the input_buffer pointer so we can free it
-    char *next_char = input_buffer;
+    struct IntVector tunnels = { 0 };
+    IntVector_reserve(&tunnels, 2 * num_rows);
 
-    while (*next_char != 0) {
-        if (!isupper(*next_char) && !islower(*next_char)) {
+    // the end of the input ends the last name, newline or not
+    for (const char *next_char = input; next_char <= end; next_char++) {
+        if (next_char == end || (!isupper(*next_char) && !islower(*next_char))) {
             // determine the length of the name
             int name_len = next_char - p_cave_name;
-            // reserve memory for the cave name
-            char cave_name[name_len];
-            // copy the name into memory
-            strncpy(cave_name, p_cave_name, name_len);
-            // add null terminator
-            cave_name[name_len] = '\0';
-            // create a new cave
-            tunnels[tunnel_index++] = Cave_create(cave_name,
-                    name_len, p_network_t_ret);
+            if (name_len > 0) {
+                // copy the name into memory, with a null terminator
+                char cave_name[name_len + 1];
+                strncpy(cave_name, p_cave_name, name_len);
+                cave_name[name_len] = '\0';
+                // create a new cave
+                IntVector_push(&tunnels, Cave_create(cave_name,
+                        name_len, p_network_t_ret));
+            }
             // move to the next cave
             p_cave_name = next_char + 1;
         }
-        next_char++;
     }
 
-    free(input_buffer);
-
     // assign the tunnels to the caves
-    Network_assign_tunnels(p_network_t_ret, tunnels);
+    Network_assign_tunnels(p_network_t_ret, tunnels.data);
+    IntVector_free(&tunnels);
 
     return p_network_t_ret;
 }
 
+/*
+* Read an input file of connections to create a cave network.
+*
+* @param    file_name           data file to open
+* @retval   p_network_t_ret     pointer to cave network
+*/
+struct CaveNetwork *Network_create(char file_name[])
+{
+    size_t file_size;
+    char *input_buffer = read_file(file_name, &file_size);
+    struct CaveNetwork *p_network_t_ret = Network_parse(input_buffer, file_size);
+    free(input_buffer);
+    if (p_network_t_ret == NULL) {
+        printf("Error: Every line of %s must be two cave names joined by '-'.\n",
+                file_name);
+        exit(-1);
+    }
+    return p_network_t_ret;
+}
+
 /*
 * Free the data from a cave network
 *
@@ -254,10 +213,12 @@ struct CaveNetwork *Network_create(char file_name[])
 void Network_destroy(struct CaveNetwork *p_network)
 {
     //free(p_network->tunnels);
-    for (int cave_index = 0; cave_index < p_network->num_caves;
+    for (int cave_index = 0; cave_index < p_network->caves.size;
             cave_index++) {
-        free(p_network->caves[cave_index]);
+        IntVector_free(&p_network->caves.data[cave_index]->tunnels);
     }
+    CaveList_free(&p_network->caves);
+    Arena_destroy(p_network->arena);
     free(p_network);
 }
 
@@ -273,19 +234,19 @@ void CaveNetwork_info(struct CaveNetwork *p_network)
         printf("Bad network requested.\n");
         exit(-1);
     }
-    printf("Cave network with %u caves and %u tunnels.\n", 
-            p_network->num_caves, p_network->num_tunnels);
+    printf("Cave network with %zu caves and %u tunnels.\n", 
+            p_network->caves.size, p_network->num_tunnels);
     printf("Caves: ");
-    for (int cave_index = 0; cave_index < p_network->num_caves; cave_index++) {
-        printf("%s ", p_network->caves[cave_index]->name);
-        if (!is_small(p_network->caves[cave_index]))
+    for (int cave_index = 0; cave_index < p_network->caves.size; cave_index++) {
+        printf("%s ", p_network->caves.data[cave_index]->name);
+        if (!is_small(p_network->caves.data[cave_index]))
             printf("(BIG) ");
     }
     printf("\n");
-    for (int i = 0; i < p_network->num_caves; i++) {
-        printf("Cave %s connected to: ", p_network->caves[i]->name);
-        for (int j = 0; j < p_network->caves[i]->num_tunnels; j++) {
-            printf("%s ", p_network->caves[p_network->caves[i]->tunnels[j]]->name);
+    for (int i = 0; i < p_network->caves.size; i++) {
+        printf("Cave %s connected to: ", p_network->caves.data[i]->name);
+        for (int j = 0; j < p_network->caves.data[i]->tunnels.size; j++) {
+            printf("%s ", p_network->caves.data[p_network->caves.data[i]->tunnels.data[j]]->name);
         }
         printf("\n");
     }
@@ -342,15 +303,14 @@ int small_cave_visit(int index, int *p_path, int *p_path_len,
         struct CaveNetwork *p_network_t)
 {
     // if cave is large, add it
-    if (!is_small(p_network_t->caves[index]))
+    if (!is_small(p_network_t->caves.data[index]))
         return 0;
 
     // find duplicate small caves of the same name
-    // TODO: Figure out WTF is happening here - why do I have to check beyond the end
-    // of the path??
-    for (int path_index = 0; path_index < *p_path_len + WTF; path_index++) {
-        if (num_occurences_in_path(path_index, p_path, p_path_len) > 1 &&
-                is_small(p_network_t->caves[path_index]))
+    // (every cave index has to be checked, not just as many as the path is long)
+    for (int cave_index = 0; cave_index < p_network_t->caves.size; cave_index++) {
+        if (num_occurences_in_path(cave_index, p_path, p_path_len) > 1 &&
+                is_small(p_network_t->caves.data[cave_index]))
             return 1;
     }
     return 0;
@@ -370,20 +330,24 @@ void Network_find_paths(int start_index, int end_index, int *p_current_path,
         int *p_path_length, int *p_num_paths, struct CaveNetwork *p_network_t)
 {
     // pointer to cave we're starting at
-    struct Cave *p_start = p_network_t->caves[start_index];
+    struct Cave *p_start = p_network_t->caves.data[start_index];
 
     // keep recursing as long as we're not in the final cave
     if (start_index != end_index) {
         // look at all the caves connected to this one
-        for (int tunnel_index = 0; tunnel_index < p_start->num_tunnels; tunnel_index++) {
+        for (int tunnel_index = 0; tunnel_index < p_start->tunnels.size; tunnel_index++) {
             // pointer to the cave we're looking towards
-            int next_index = p_start->tunnels[tunnel_index];
-            // struct Cave *p_next = p_network_t->caves[next_index];
+            int next_index = p_start->tunnels.data[tunnel_index];
+            // struct Cave *p_next = p_network_t->caves.data[next_index];
             // if we've already been there
             if (is_in_path(next_index, p_current_path, p_path_length)) {
                 // skip if it's a start or end cave
                 if (next_index == 0 || next_index == 1)
                     continue;
+                // without the second visit, every small cave is visited once
+                if (!p_network_t->small_twice
+                        && is_small(p_network_t->caves.data[next_index]))
+                    continue;
                 // if it's a small cave
                 //if (is_small(p_next))
                 if (small_cave_visit(next_index, p_current_path, p_path_length,
@@ -405,7 +369,7 @@ void Network_find_paths(int start_index, int end_index, int *p_current_path,
 #ifdef PRINT_DEBUG
         printf("Found path: ");
         for (int path_index = 0; path_index < *p_path_length; path_index++) {
-            printf("%s ", p_network_t->caves[p_current_path[path_index]]->name);
+            printf("%s ", p_network_t->caves.data[p_current_path[path_index]]->name);
         }
         printf("\n");
 #endif
@@ -413,6 +377,30 @@ void Network_find_paths(int start_index, int end_index, int *p_current_path,
     }
 }
 
+/*
+* Count the paths from start to end through a cave network
+*
+* @param    network     the cave network
+* @param    small_twice 1 if one small cave may be visited twice
+* @retval   num_paths   total number of paths
+*/
+int Network_search(struct CaveNetwork *network, int small_twice)
+{
+    // a big cave is always followed by a small one (otherwise there would be
+    // endless paths) and at most one small cave is visited twice, so no path
+    // is longer than this. The path is never grown while it is being searched.
+    struct IntVector path = { 0 };
+    IntVector_reserve(&path, 2 * network->caves.size + 2);
+    path.data[0] = 0;
+    int path_length = 1;
+    int num_paths = 0;
+
+    network->small_twice = small_twice;
+    Network_find_paths(0, 1, path.data, &path_length, &num_paths, network);
+    IntVector_free(&path);
+    return num_paths;
+}
+
 /*
 * Count the paths through a cave network
 *
@@ -423,12 +411,7 @@ int Network_count_paths(char data_file[])
 {
 
     struct CaveNetwork *network = Network_create(data_file);
-    int path[MAX_CAVES];
-    path[0] = 0;
-    int path_length = 1;
-    int num_paths = 0;
-
-    Network_find_paths(0, 1, path, &path_length, &num_paths, network);
+    int num_paths = Network_search(network, 1);
     printf("There are %d paths through network described by '%s'.\n",
             num_paths, data_file);
 
@@ -437,11 +420,40 @@ int Network_count_paths(char data_file[])
     return num_paths;
 }
 
+void *day12_parse(const char *input, size_t size)
+{
+    return Network_parse(input, size);
+}
+
+void day12_part1(void *network, char answer[ANSWER_LEN])
+{
+    snprintf(answer, ANSWER_LEN, "%d", Network_search(network, 0));
+}
+
+void day12_part2(void *network, char answer[ANSWER_LEN])
+{
+    snprintf(answer, ANSWER_LEN, "%d", Network_search(network, 1));
+}
+
+void day12_free(void *network)
+{
+    Network_destroy(network);
+}
+
+const struct Solver day12_solver = {
+    "12", day12_parse, day12_part1, day12_part2, day12_free, 1
+};
+
+#ifndef AOC_DRIVER
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day12_solver, argc - 1, argv + 1);
+
     Network_count_paths("data/12small");
     Network_count_paths("data/12med");
     Network_count_paths("data/12large");
     Network_count_paths("data/12puzzle");
     return 0;
 }
+#endif
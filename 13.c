@@ -31,9 +31,8 @@ Plan:
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
-
-#define MAX_POINTS 1024
-#define MAX_FOLDS 16
+#include "util.h"
+#include "bench.h"
 
 struct Point {
     int x;
@@ -45,89 +44,99 @@ struct Fold {
     int coordinate;
 };
 
-struct Point *Point_create(int x, int y)
+DEFINE_VECTOR(PointList, struct Point *)
+DEFINE_VECTOR(FoldList, struct Fold *)
+
+struct Point *Point_create(struct Arena *arena, int x, int y)
 {
-    struct Point *pt = malloc(sizeof(struct Point));
+    struct Point *pt = Arena_alloc(arena, sizeof(struct Point));
     pt->x = x;
     pt->y = y;
     return pt;
 }
 
-struct Fold *Fold_create(char axis, int coordinate)
+struct Fold *Fold_create(struct Arena *arena, char axis, int coordinate)
 {
-    struct Fold *fd = malloc(sizeof(struct Fold));
+    struct Fold *fd = Arena_alloc(arena, sizeof(struct Fold));
     fd->axis = axis;
     fd->coordinate = coordinate;
     return fd;
 }
 
+/* Folding reflects x to 2 * fold - x, which has to fit in an int */
+#define MAX_COORDINATE (INT_MAX / 2)
+
+int coordinate_valid(int64_t coordinate)
+{
+    return coordinate >= 0 && coordinate <= MAX_COORDINATE;
+}
+
 /*
-* read data from an input file. Populate points and folds arrays
-* and pass by reference number of folds & points.
+* Parse an input. Populate points and folds lists.
 *
-* @param    data_file       Data file to read
-* @param    p_points_t      Points array
-* @param    p_folds_t       Folds array
-* @param    p_num_points    number of points in input
-* @param    p_num_folds     number of folds in input
+* @param    arena           Arena to allocate points and folds from
+* @param    input_buffer    the input, zero terminated
+* @param    file_size       size of the input
+* @param    points          Points list
+* @param    folds           Folds list
+* @retval   0               success
+* @retval   -1              a point has no y coordinate, a fold no axis or
+*                           coordinate, or a coordinate is negative or too
+*                           big to fold
 */
-void read_data(char data_file[], struct Point **p_points_t, struct Fold **p_folds_t,
-        int *num_points, int *num_folds)
+int parse_data(struct Arena *arena, const char *input_buffer, size_t file_size,
+        struct PointList *points, struct FoldList *folds)
 {
-    FILE *file_handle = fopen(data_file, "r");
-    if (file_handle == NULL) {
-        printf("Error reading data file %s: %s\n", data_file, strerror(errno));
-        exit(-1);
-    }
-    printf("Reading data from %s...\n", data_file);
-
-    // find the file size
-    fseek(file_handle, 0, SEEK_END);
-    size_t file_size = ftell(file_handle);
-    rewind(file_handle);
-
-    char *input_buffer = (char *)malloc(file_size * sizeof(char) + 1);
+    const char *p = input_buffer;
+    const char *end = input_buffer + file_size;
 
-    size_t bytes_read = fread((void*)input_buffer, sizeof(char), file_size, file_handle);
-    if (bytes_read != file_size) {
-        printf("Error reading file. Read %ld bytes, expected %ld.\n",
-                bytes_read, file_size);
-        exit(-1);
+    // the points are pairs of numbers up to the first fold
+    const char *folds_start = strstr(input_buffer, "fold along");
+    const char *points_end = (folds_start != NULL) ? folds_start : end;
+    int64_t x_coord, y_coord;
+    while ((p = next_int(p, points_end, &x_coord)) != NULL) {
+        p = next_int(p, points_end, &y_coord);
+        if (p == NULL || !coordinate_valid(x_coord) || !coordinate_valid(y_coord))
+            return -1;
+        PointList_push(points, Point_create(arena, x_coord, y_coord));
     }
 
-    fclose(file_handle);
-    input_buffer[file_size] = 0;
-
-    // read the points
-    char *token = NULL;
-    char delimeters[] = "fold along,=\n";
-    token = strtok(input_buffer, delimeters);
-    while(token != NULL) {
-        int x_coord = atoi(token);
-        token = strtok(NULL, delimeters);
-        int y_coord = atoi(token);
-        token = strtok(NULL, delimeters);
-        //printf("[%d, %d]\n", x_coord, y_coord);
-        p_points_t[(*num_points)++] = Point_create(x_coord, y_coord);
-
-        // break out of this loop if we've reached the end of the points
-        if (token[0] == 'x' || token[0] == 'y') {
-            //printf("Found start of folds\n");
-            break;
-        }
+    // each fold is "fold along <axis>=<coordinate>"
+    int64_t fold_coord;
+    p = folds_start;
+    while (p != NULL && (p = strstr(p, "fold along ")) != NULL) {
+        p += strlen("fold along ");
+        char fold_axis = *p;
+        if (fold_axis != 'x' && fold_axis != 'y')
+            return -1;
+        p = next_int(p, end, &fold_coord);
+        if (p == NULL || !coordinate_valid(fold_coord))
+            return -1;
+        FoldList_push(folds, Fold_create(arena, fold_axis, fold_coord));
     }
+    return 0;
+}
 
-    // read the folds
-    while (token != NULL) {
-        char fold_axis = token[0];
-        token = strtok(NULL, delimeters);
-        int fold_coord = atoi(token);
-        //printf("Fold along %c at %d.\n", fold_axis, fold_coord);
-        p_folds_t[(*num_folds)++] = Fold_create(fold_axis, fold_coord);
-        token = strtok(NULL, delimeters);
+/*
+* read data from an input file. Populate points and folds lists.
+*
+* @param    arena           Arena to allocate points and folds from
+* @param    data_file       Data file to read
+* @param    points          Points list
+* @param    folds           Folds list
+*/
+void read_paper(struct Arena *arena, char data_file[], struct PointList *points,
+        struct FoldList *folds)
+{
+    printf("Reading data from %s...\n", data_file);
+    size_t file_size;
+    char *input_buffer = read_file(data_file, &file_size);
+    if (parse_data(arena, input_buffer, file_size, points, folds) < 0) {
+        printf("Error: Points must be \"x,y\" and folds \"fold along x=n\" or "
+                "\"fold along y=n\", from 0 to %d.\n", MAX_COORDINATE);
+        exit(-1);
     }
-    printf("Found %d points and %d folds.\n", *num_points, *num_folds);
-
+    printf("Found %zu points and %zu folds.\n", points->size, folds->size);
     free(input_buffer);
 }
 
@@ -166,6 +175,28 @@ void print_map(struct Point **p_points_t, int *p_num_points,
     }
 }
 
+/*
+* Draw the map into a string, a line per row. A map too big for the
+* string is cut short.
+*
+* @param    str             string to write to
+* @param    len             size of the string
+*/
+void render_map(struct Point **p_points_t, int *p_num_points,
+        int x_limit, int y_limit, char *str, size_t len)
+{
+    size_t n = 0;
+    for (int y_index = 0; y_index < y_limit && n + 1 < len; y_index++) {
+        if (y_index > 0)
+            str[n++] = '\n';
+        for (int x_index = 0; x_index < x_limit && n + 1 < len; x_index++) {
+            str[n++] = Point_exists(x_index, y_index, p_points_t, p_num_points)
+                ? '#' : ' ';
+        }
+    }
+    str[n] = '\0';
+}
+
 int fold(struct Point **p_points_t, int *p_num_points, char axis,
         int coordinate)
 {
@@ -204,37 +235,100 @@ int fold(struct Point **p_points_t, int *p_num_points, char axis,
 }
 
 
-int main(int argc, char *argv[])
+/* A sheet of transparent paper, and how far through the folds it is */
+struct Paper {
+    struct Arena *arena;            // every point and fold
+    struct PointList points;
+    struct FoldList folds;
+    int point_count;                // points still visible
+    int folds_done;
+    int x_limit, y_limit;
+};
+
+/*
+* Make the next folds
+*
+* @param    paper       the paper to fold
+* @param    num_folds   number of folds to make (stops at the last fold)
+*/
+void Paper_fold(struct Paper *paper, int num_folds)
 {
-    struct Point **points = malloc(sizeof(struct Point*) * MAX_POINTS);
-    struct Fold **folds = malloc(sizeof(struct Fold*) * MAX_FOLDS);
-    int num_folds = 0;
-    int num_points = 0;
-    char data_file[] = "data/13data";
-    read_data(data_file, points, folds, &num_points, &num_folds);
-
-    int x_limit = 0, y_limit = 0;
-    int point_count = num_points;
-    for (int i = 0; i < num_folds; i++) {
-        char axis = folds[i]->axis;
-        int coordinate = folds[i]->coordinate;
-        point_count += fold(points, &num_points, axis, coordinate);
-        if (i == 0)
-            printf("Fold %d: %d points remaining.\n", i + 1, point_count);
-        if (axis == 'x')
-            x_limit = coordinate;
-        if (axis == 'y')
-            y_limit = coordinate;
+    int num_points = paper->points.size;
+    for (; num_folds > 0 && paper->folds_done < paper->folds.size; num_folds--) {
+        struct Fold *next = paper->folds.data[paper->folds_done++];
+        paper->point_count += fold(paper->points.data, &num_points, next->axis,
+                next->coordinate);
+        if (next->axis == 'x')
+            paper->x_limit = next->coordinate;
+        if (next->axis == 'y')
+            paper->y_limit = next->coordinate;
     }
-    print_map(points, &num_points, x_limit, y_limit);
+}
 
-    for (int i = 0; i < num_points; i++) {
-        free(points[i]);
-    }
-    free(points);
-    for (int i = 0; i < num_folds; i++) {
-        free(folds[i]);
+void day13_free(void *puzzle)
+{
+    struct Paper *paper = puzzle;
+    PointList_free(&paper->points);
+    FoldList_free(&paper->folds);
+    Arena_destroy(paper->arena);
+    free(paper);
+}
+
+void *day13_parse(const char *input, size_t size)
+{
+    struct Paper *paper = calloc(1, sizeof(struct Paper));
+    assert(paper != NULL);
+    paper->arena = Arena_create(0);
+    if (parse_data(paper->arena, input, size, &paper->points, &paper->folds) < 0) {
+        day13_free(paper);
+        return NULL;
     }
-    free(folds);
+    paper->point_count = paper->points.size;
+    return paper;
+}
+
+void day13_part1(void *puzzle, char answer[ANSWER_LEN])
+{
+    struct Paper *paper = puzzle;
+    Paper_fold(paper, 1);
+    snprintf(answer, ANSWER_LEN, "%d", paper->point_count);
+}
+
+/* the answer is the letters the dots make */
+void day13_part2(void *puzzle, char answer[ANSWER_LEN])
+{
+    struct Paper *paper = puzzle;
+    int num_points = paper->points.size;
+    Paper_fold(paper, paper->folds.size);
+    render_map(paper->points.data, &num_points, paper->x_limit, paper->y_limit,
+            answer, ANSWER_LEN);
+}
+
+const struct Solver day13_solver = {
+    "13", day13_parse, day13_part1, day13_part2, day13_free, 1
+};
+
+#ifndef AOC_DRIVER
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day13_solver, argc - 1, argv + 1);
+
+    struct Paper paper = { 0 };
+    char *data_file = (argc > 1) ? argv[1] : "data/13data";
+    paper.arena = Arena_create(0);
+    read_paper(paper.arena, data_file, &paper.points, &paper.folds);
+    paper.point_count = paper.points.size;
+
+    Paper_fold(&paper, 1);
+    printf("Fold %d: %d points remaining.\n", 1, paper.point_count);
+    Paper_fold(&paper, paper.folds.size);
+    int num_points = paper.points.size;
+    print_map(paper.points.data, &num_points, paper.x_limit, paper.y_limit);
+
+    PointList_free(&paper.points);
+    FoldList_free(&paper.folds);
+    Arena_destroy(paper.arena);   // every point and fold
     return (EXIT_SUCCESS);
 }
+#endif
@@ -16,6 +16,10 @@ Next step:
 NB BC CC CN NB BB BB BC CB BH HC CB
 Contracts to
 NBCCNBBBCBHCB
+
+Elements are UTF-8 characters, so the alphabet isn't limited to A-Z,
+and there is no limit on the number of elements, rules or the length
+of the template.
 */
 
 #include <stdio.h>
@@ -23,118 +27,239 @@ NBCCNBBBCBHCB
 #include <errno.h>
 #include <string.h>
 #include <stdint.h>
+#include "util.h"
+#include "bench.h"
 
-#define MAX_TEMPLATE 127    // maximum template length
-#define MAX_ELEMENTS 26     // only A-Z allowed
-#define MAX_RULES 255       // maximum number of rules allowed
+#define NO_INSERTION -1     // a pair with no rule is never split
 // #define PRINT_DEBUG
 
+/* Open addressing hash table from a 64 bit key to a dense index: the
+   first key interned gets 0, the next 1, and so on, so everything else
+   can be kept in plain arrays. Elements are keyed by their code point
+   and pairs by their two element indices. */
+struct Interner {
+    uint64_t *keys;
+    int *indices;           // -1 for an empty slot
+    size_t table_size;      // always a power of 2
+    int num_keys;
+};
+
 /* Each pair rule has three attributes:
-   Its name (i.e. "NC")
-   The character that gets inserted (i.e. 'N')
-   Pointers to the two rules that follow ("NN" and "CN")
+   Its pair of elements (i.e. "NC")
+   The element that gets inserted (i.e. 'N'), or NO_INSERTION
+   The indices of the two rules that follow ("NN" and "CN")
 */
 typedef struct pairrule_t {
-    char pair[3];
-    char insertion;
-    struct pairrule_t *child1, *child2;
+    int first, second;
+    int insertion;
+    int child1, child2;
 } pairrule_t;
 
+DEFINE_VECTOR(RuleList, pairrule_t)
+DEFINE_VECTOR(CountList, uintmax_t)
+DEFINE_VECTOR(CodePointList, uint32_t)
+
 /* Polymer struct is made up of two dictionaries:
    1. Pair-rules
    2. Elements
-   Both dictionaries have the arrays of values,
-   corresponding arrays of value counts, and a count of values.
-   Also includes a template string to start the polymer.
+   Both dictionaries have an interner giving dense indices,
+   the values, and corresponding value counts.
 */
 typedef struct polymer_t {
-    int num_rules;
-    pairrule_t **rules;
-    uintmax_t *rule_counts;
-
-    int num_elements;
-    char elements[MAX_ELEMENTS];
-    uintmax_t element_counts[MAX_ELEMENTS];
+    struct Interner rule_index;
+    struct RuleList rules;
+    struct CountList rule_counts;
 
-    char template[MAX_TEMPLATE];
+    struct Interner element_index;
+    struct CodePointList elements;
+    struct CountList element_counts;
 } polymer_t;
 
+void Interner_init(struct Interner *in, size_t table_size)
+{
+    in->table_size = table_size;
+    in->num_keys = 0;
+    in->keys = malloc(table_size * sizeof(uint64_t));
+    in->indices = malloc(table_size * sizeof(int));
+    if (in->keys == NULL || in->indices == NULL) {
+        printf("Error: Could not allocate interner of %zu slots.\n", table_size);
+        exit(-1);
+    }
+    memset(in->indices, -1, table_size * sizeof(int));
+}
+
+void Interner_free(struct Interner *in)
+{
+    free(in->keys);
+    free(in->indices);
+}
+
+uint64_t Interner_hash(uint64_t key)
+{
+    // splitmix64 finalizer
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111eb;
+    return key ^ (key >> 31);
+}
+
 /*
-* Find the index of a rule given it's characteristic pair
+* Find the index of a key, adding it if it is new
 *
-* @param    pm      pointer to the polymer
-* @param    pair    element pair that defines the rules
-* @retval   index   index of rule
-* @retval   -1      rule not found.
+* @param    in          the interner
+* @param    key         key to look up
+* @param    p_added     set to 1 if the key was new, 0 if not (may be NULL)
+* @retval   index       dense index of the key
 */
-int find_rule_index(char pair[], polymer_t *pm)
+int Interner_intern(struct Interner *in, uint64_t key, int *p_added)
 {
-    for (int rule_index = 0; rule_index < pm->num_rules; rule_index++) {
-        if (!strcmp(pair, pm->rules[rule_index]->pair)) {
-            return rule_index;
+    size_t mask = in->table_size - 1;
+    size_t slot = Interner_hash(key) & mask;
+    while (in->indices[slot] >= 0) {
+        if (in->keys[slot] == key) {
+            if (p_added != NULL)
+                *p_added = 0;
+            return in->indices[slot];
         }
+        slot = (slot + 1) & mask;
     }
-    return -1;
+
+    // keep the table at most half full
+    if (2 * (in->num_keys + 1) > in->table_size) {
+        struct Interner bigger;
+        Interner_init(&bigger, in->table_size * 2);
+        for (size_t i = 0; i < in->table_size; i++) {
+            if (in->indices[i] < 0)
+                continue;
+            size_t s = Interner_hash(in->keys[i]) & (bigger.table_size - 1);
+            while (bigger.indices[s] >= 0)
+                s = (s + 1) & (bigger.table_size - 1);
+            bigger.keys[s] = in->keys[i];
+            bigger.indices[s] = in->indices[i];
+        }
+        bigger.num_keys = in->num_keys;
+        Interner_free(in);
+        *in = bigger;
+        return Interner_intern(in, key, p_added);
+    }
+
+    in->keys[slot] = key;
+    in->indices[slot] = in->num_keys;
+    if (p_added != NULL)
+        *p_added = 1;
+    return in->num_keys++;
 }
 
 /*
-* Find the index of an element in a polymer.
+* Decode the UTF-8 character at a position in a buffer
 *
-* @param    element     element to look for
-* @param    polymer_t   polymer to look in
-* @retval   index       index of polymer
-* @retval   -1          polymer not found.
+* @param    p           position of the character
+* @param    end         end of the buffer
+* @param    p_code      code point (output)
+* @retval   p           just past the character
 */
-int element_index(char element, polymer_t *p_poly)
+const char *next_code_point(const char *p, const char *end, uint32_t *p_code)
 {
-    for (int index = 0; index < p_poly->num_elements; index++) {
-        if (p_poly->elements[index] == element) {
-            return index;
-        }
+    unsigned char lead = *p++;
+    int extra = (lead >= 0xF0) ? 3 : (lead >= 0xE0) ? 2 : (lead >= 0xC0) ? 1 : 0;
+    uint32_t code = (extra) ? lead & (0x3F >> extra) : lead;
+    while (extra-- > 0 && p < end && ((unsigned char)*p & 0xC0) == 0x80) {
+        code = (code << 6) | ((unsigned char)*p++ & 0x3F);
     }
-    return -1;
+    *p_code = code;
+    return p;
 }
 
-void create_rule(polymer_t *polymer, char pair[], char insertion)
+/*
+* Print a code point as UTF-8
+*
+* @param    code        code point to print
+*/
+void print_code_point(uint32_t code)
 {
-    //printf("Creating rule %s...\n", pair);
-    int rule_index = find_rule_index(pair, polymer);
-    if (rule_index >= 0) {
-        polymer->rules[rule_index]->insertion = insertion;
+    if (code < 0x80) {
+        putchar(code);
+    } else if (code < 0x800) {
+        putchar(0xC0 | (code >> 6));
+        putchar(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        putchar(0xE0 | (code >> 12));
+        putchar(0x80 | ((code >> 6) & 0x3F));
+        putchar(0x80 | (code & 0x3F));
     } else {
-        pairrule_t *rule = (pairrule_t*)malloc(sizeof(pairrule_t));
-        strcpy(rule->pair, pair);
-        rule->insertion = insertion;
-        rule->child1 = rule->child2 = NULL;
-        polymer->rules[polymer->num_rules] = rule;
+        putchar(0xF0 | (code >> 18));
+        putchar(0x80 | ((code >> 12) & 0x3F));
+        putchar(0x80 | ((code >> 6) & 0x3F));
+        putchar(0x80 | (code & 0x3F));
     }
 }
 
 /*
-* Create links to child rules within a polymer
-* 
+* Find the index of an element in a polymer, adding it if it is new.
+*
+* @param    pm          polymer to look in
+* @param    code        the element's code point
+* @retval   index       index of element
+*/
+int element_index(polymer_t *pm, uint32_t code)
+{
+    int added;
+    int index = Interner_intern(&pm->element_index, code, &added);
+    if (added) {
+        CodePointList_push(&pm->elements, code);
+        CountList_push(&pm->element_counts, 0);
+    }
+    return index;
+}
+
+/*
+* Find the index of the rule for a pair of elements, adding it (with no
+* insertion until create_rule() gives it one) if it is new.
+*
+* @param    pm          pointer to the polymer
+* @param    first       index of the first element of the pair
+* @param    second      index of the second element of the pair
+* @retval   index       index of rule
+*/
+int rule_index(polymer_t *pm, int first, int second)
+{
+    int added;
+    uint64_t key = ((uint64_t)first << 32) | (uint32_t)second;
+    int index = Interner_intern(&pm->rule_index, key, &added);
+    if (added) {
+        pairrule_t rule = { first, second, NO_INSERTION, -1, -1 };
+        RuleList_push(&pm->rules, rule);
+        CountList_push(&pm->rule_counts, 0);
+    }
+    return index;
+}
+
+void create_rule(polymer_t *polymer, int first, int second, int insertion)
+{
+    int index = rule_index(polymer, first, second);
+    polymer->rules.data[index].insertion = insertion;
+}
+
+/*
+* Create links to child rules within a polymer. Children that have no
+* rule of their own get one with no insertion, so they keep their count.
+*
 * @param        pm      polymer to link
 */
 void link_rules(polymer_t *pm)
 {
-    // loop through all rules in polymer
-    for (int rule_index = 0; rule_index < pm->num_rules; rule_index++) {
-        // initialize child pairs
-        char child_1[3], child_2[3];
-        // child 1 is first element of rule plus insertion
-        child_1[0] = pm->rules[rule_index]->pair[0];
-        child_1[1] = child_2[0] = pm->rules[rule_index]->insertion;
+    // rule_index() may add rules (and move the array) as we go
+    for (int index = 0; index < pm->rules.size; index++) {
+        pairrule_t rule = pm->rules.data[index];
+        if (rule.insertion == NO_INSERTION)
+            continue;
+        // child 1 is first element of rule plus insertion,
         // child 2 is insertion + second element
-        child_2[1] = pm->rules[rule_index]->pair[1];
-        // null terminate
-        child_1[2] = child_2[2] = '\0';
-        pm->rules[rule_index]->child1 = 
-            (struct pairrule_t*)pm->rules[find_rule_index(child_1, pm)];
-        pm->rules[rule_index]->child2 = 
-            (struct pairrule_t*)pm->rules[find_rule_index(child_2, pm)];
-
-        // initialize rule counts to zero
-        pm->rule_counts[rule_index] = 0;
+        int child1 = rule_index(pm, rule.first, rule.insertion);
+        int child2 = rule_index(pm, rule.insertion, rule.second);
+        pm->rules.data[index].child1 = child1;
+        pm->rules.data[index].child2 = child2;
     }
 }
 
@@ -146,32 +271,40 @@ void link_rules(polymer_t *pm)
 void print_polymer(polymer_t *pm)
 {
 #ifdef PRINT_DEBUG
-    for (int i = 0; i < pm->num_elements; i++) {
-        printf("%c - %lu\n", pm->elements[i], pm->element_counts[i]);
+    for (int i = 0; i < pm->elements.size; i++) {
+        print_code_point(pm->elements.data[i]);
+        printf(" - %ju\n", pm->element_counts.data[i]);
     }
-    for (int rule_index = 0; rule_index < pm->num_rules; rule_index++) {
-        printf("Rule: %s -> %c (%lu), Children: %s, %s.\n",
-                pm->rules[rule_index]->pair,
-                pm->rules[rule_index]->insertion,
-                pm->rule_counts[rule_index],
-                pm->rules[rule_index]->child1->pair,
-                pm->rules[rule_index]->child2->pair);
+    for (int i = 0; i < pm->rules.size; i++) {
+        pairrule_t *rule = &pm->rules.data[i];
+        printf("Rule: ");
+        print_code_point(pm->elements.data[rule->first]);
+        print_code_point(pm->elements.data[rule->second]);
+        printf(" -> ");
+        if (rule->insertion != NO_INSERTION)
+            print_code_point(pm->elements.data[rule->insertion]);
+        printf(" (%ju)\n", pm->rule_counts.data[i]);
     }
 #endif
 }
 
 /*
-* Display the result for the advent of code puzzle
-* 
-* @param    pm      polymer that has been linked & grown
+* Find the counts of the most and least common elements
+*
+* @param    pm          polymer that has been linked & grown
+* @param    p_min       least common element count (output)
+* @param    p_max       most common element count (output)
+* @retval   0           success
+* @retval   1           polymer has no elements
 */
-void element_count_range(polymer_t *pm)
+int element_count_bounds(polymer_t *pm, uintmax_t *p_min, uintmax_t *p_max)
 {
-    // initialize max and min as first element count
-    uintmax_t max_count = pm->element_counts[0], 
-                  min_count = pm->element_counts[0];
-    for (int i = 1; i < pm->num_elements; i++) {
-        uintmax_t current_element = pm->element_counts[i];
+    // elements that only appear in rules may never have been inserted
+    uintmax_t max_count = 0, min_count = UINTMAX_MAX;
+    for (int i = 0; i < pm->elements.size; i++) {
+        uintmax_t current_element = pm->element_counts.data[i];
+        if (current_element == 0)
+            continue;
         if (current_element > max_count) {
             max_count = current_element;
         }
@@ -179,71 +312,121 @@ void element_count_range(polymer_t *pm)
             min_count = current_element;
         }
     }
-    printf("Min: %lu\nMax: %lu\n", min_count, max_count);
-    printf("Result: %lu\n", (max_count - min_count));
+    if (max_count == 0)
+        return 1;
+    *p_min = min_count;
+    *p_max = max_count;
+    return 0;
 }
 
 /*
-* Create a polymer given a template.
-* @param    template        template string
-* @param    n               length of template string
-* @retval   pm              pointer to the template
+* Display the result for the advent of code puzzle
+*
+* @param    pm      polymer that has been linked & grown
 */
-polymer_t* create_polymer(char template[], size_t *template_length, char *input_buffer)
+void element_count_range(polymer_t *pm)
 {
-    // allocate memory, initialize some variables
-    polymer_t *pm = malloc(sizeof(polymer_t));
-    pm->num_elements = 0;
-    pm->num_rules = 0;
-    strcpy(pm->template, template);
-
-
-    // allocate memory for rules & rule counts
-    pm->rules = (pairrule_t**)malloc(sizeof(pairrule_t*) * MAX_RULES);
-    pm->rule_counts = (uintmax_t*)malloc(sizeof(uintmax_t*) * MAX_RULES);
-
-    const char delimeters[] = " ->\n";
-    char *token = NULL;
-    token = strtok(input_buffer, delimeters);
-    while(token != NULL) {
-        char rule_pair[8];
-        strcpy(rule_pair, token);
-        token = strtok(NULL, delimeters);
-        char rule_insertion = token[0];
-        create_rule(pm, rule_pair, rule_insertion);
-        pm->num_rules++;
-        // TODO: Valgrind error on this line. Error goes away if I add
-        // if(pm->num_rules > (final number of rules)) { break; }
-        token = strtok(NULL, delimeters);
+    uintmax_t min_count, max_count;
+    if (element_count_bounds(pm, &min_count, &max_count)) {
+        printf("Error: Polymer has no elements.\n");
+        return;
     }
-    free(input_buffer);
+    printf("Min: %ju\nMax: %ju\n", min_count, max_count);
+    printf("Result: %ju\n", (max_count - min_count));
+}
 
-    // create links to child rules
-    link_rules(pm);
+/*
+* Free a polymer from memory.
+* @param    polymer_t   polymer to free.
+*/
+void free_polymer(polymer_t *pm)
+{
+    Interner_free(&pm->rule_index);
+    RuleList_free(&pm->rules);
+    CountList_free(&pm->rule_counts);
+    Interner_free(&pm->element_index);
+    CodePointList_free(&pm->elements);
+    CountList_free(&pm->element_counts);
+    free(pm);
+}
 
-    // add the characters and rules found in the template
-    // to the polymer data
-    for (int template_index = 0; template_index < *template_length; template_index++) {
-        char element = template[template_index];
-        // skip the last element to ensure we only check pairs
-        if (template_index < (*template_length - 1)) {
-            char next_element = template[template_index + 1];
-            char pair[3] = { element, next_element, '\0' };
-            pm->rule_counts[find_rule_index(pair, pm)]++;
+/*
+* Create a polymer from an input buffer. The first line is the template,
+* which is counted in one pass: each element, and each pair of neighbors.
+* Every other line is a pair rule "AB -> C".
+*
+* @param    input           input buffer
+* @param    input_size      bytes in the input buffer
+* @retval   pm              pointer to the polymer
+* @retval   NULL            a rule is malformed
+*/
+polymer_t* create_polymer(const char *input, size_t input_size)
+{
+    polymer_t *pm = calloc(1, sizeof(polymer_t));
+    if (pm == NULL) {
+        printf("Error: Could not allocate polymer.\n");
+        exit(-1);
+    }
+    Interner_init(&pm->element_index, 64);
+    Interner_init(&pm->rule_index, 1024);
+
+    const char *p = input, *end = input + input_size;
+    uint32_t code;
+
+    // template: count the elements, and the pairs by their rule
+    int previous = -1;
+    while (p < end && *p != '\n' && *p != '\r') {
+        p = next_code_point(p, end, &code);
+        int current = element_index(pm, code);
+        pm->element_counts.data[current]++;
+        if (previous >= 0) {
+            int pair = rule_index(pm, previous, current);   // may grow the lists
+            pm->rule_counts.data[pair]++;
         }
+        previous = current;
+    }
 
-        int current_element_index = element_index(element, pm);
-        // if the element is already in the polymer, increment the count
-        if (current_element_index >= 0) {
-            pm->element_counts[current_element_index]++;
-            continue; 
-        } else { // add teh element to the polymer
-            pm->elements[pm->num_elements] = element;
-            pm->element_counts[pm->num_elements] = 1;
-            pm->num_elements++;
+    // rules: pair, "->", insertion, separated by whitespace
+    int line = 1;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+            if (*p == '\n')
+                line++;
+            p++;
         }
+        if (p >= end)
+            break;
+        uint32_t first, second, insertion;
+        p = next_code_point(p, end, &first);
+        if (p >= end || *p == ' ') {
+            printf("Error: Rule on line %d does not start with a pair.\n", line);
+            free_polymer(pm);
+            return NULL;
+        }
+        p = next_code_point(p, end, &second);
+        while (p < end && *p == ' ')
+            p++;
+        if (end - p < 2 || p[0] != '-' || p[1] != '>') {
+            printf("Error: Rule on line %d has no '->'.\n", line);
+            free_polymer(pm);
+            return NULL;
+        }
+        p += 2;
+        while (p < end && *p == ' ')
+            p++;
+        if (p >= end || *p == '\n' || *p == '\r') {
+            printf("Error: Rule on line %d has no insertion.\n", line);
+            free_polymer(pm);
+            return NULL;
+        }
+        p = next_code_point(p, end, &insertion);
+        create_rule(pm, element_index(pm, first), element_index(pm, second),
+                element_index(pm, insertion));
     }
 
+    // create links to child rules
+    link_rules(pm);
+
     return pm;
 }
 
@@ -255,122 +438,95 @@ polymer_t* create_polymer(char template[], size_t *template_length, char *input_
 */
 void grow_polymer(polymer_t *pm, int num_steps)
 {
+    // set new rule counts and apply them at the end of each step
+    // applying during each step creates an infinite loop (or very long polymer)
+    uintmax_t *new_rule_counts = malloc((pm->rules.size + 1) * sizeof(uintmax_t));
+    if (new_rule_counts == NULL) {
+        printf("Error: Could not allocate rule counts.\n");
+        exit(-1);
+    }
     for (int step = 0; step < num_steps; step++) {
-        // set new element counts and new rule counts
-        // need to apply these at the end of each step
-        // applying during each step creates an infinite loop (or very long polymer)
-        uintmax_t new_element_counts[pm->num_elements];
-        memset(new_element_counts, 0, pm->num_elements * sizeof(uintmax_t));
-        uintmax_t new_rule_counts[pm->num_rules];
-        memset(new_rule_counts, 0, pm->num_rules * sizeof(uintmax_t));
+        memset(new_rule_counts, 0, pm->rules.size * sizeof(uintmax_t));
 
         // look through every rule in the polymer
-        for (int rule_index = 0; rule_index < pm->num_rules; rule_index++) {
-            pairrule_t *current_rule = pm->rules[rule_index];
-            uintmax_t current_rule_count = pm->rule_counts[rule_index];
-            int new_element_index;
-            // if the element resulting from the current rule is already in the polymer
-            if ((new_element_index = element_index(current_rule->insertion, pm)) >= 0) {
-                // add to that element count the count of the current rule
-                new_element_counts[new_element_index] += current_rule_count;
-            } else { // add the element to the polymer if not already there
-                // add the element to the list, set its count to zero
-                pm->elements[pm->num_elements] = current_rule->insertion;
-                pm->element_counts[pm->num_elements] = 0;
-                // the new count will be updated at the end
-                new_element_counts[pm->num_elements] = current_rule_count;
-                pm->num_elements++;
+        for (int index = 0; index < pm->rules.size; index++) {
+            pairrule_t *rule = &pm->rules.data[index];
+            uintmax_t count = pm->rule_counts.data[index];
+            if (count == 0)
+                continue;
+            if (rule->insertion == NO_INSERTION) {
+                // nothing inserted, the pair stays as it is
+                new_rule_counts[index] += count;
+                continue;
             }
-
-            // add to the count of the rule's children
-            int child1_index = find_rule_index(current_rule->child1->pair, pm);
-            new_rule_counts[child1_index] += current_rule_count;
-            int child2_index = find_rule_index(current_rule->child2->pair, pm);
-            new_rule_counts[child2_index] += current_rule_count;
-
-            // set the rule count for the existing rule to zero
-            // since all instance morphed into children
-            pm->rule_counts[rule_index] = 0;
-        }
-
-        // copy arrays for new element and rule counts to polymer data
-        for (int i = 0; i < pm->num_elements; i++) {
-            pm->element_counts[i] += new_element_counts[i];
-        }
-        for (int i = 0; i < pm->num_rules; i++) {
-            pm->rule_counts[i] += new_rule_counts[i];
+            // every instance morphs into the two children,
+            // and adds one inserted element
+            pm->element_counts.data[rule->insertion] += count;
+            new_rule_counts[rule->child1] += count;
+            new_rule_counts[rule->child2] += count;
         }
 
+        memcpy(pm->rule_counts.data, new_rule_counts, pm->rules.size * sizeof(uintmax_t));
     }
+    free(new_rule_counts);
 }
 
-/*
-* Free a polymer from memory.
-* @param    polymer_t   polymer to free.
-*/
-void free_polymer(polymer_t *pm)
+
+void *day14_parse(const char *input, size_t size)
 {
-    for(int i = 0; i < pm->num_rules; i++) {
-        free(pm->rules[i]);
-    }
-    free(pm->rules);
-    free(pm->rule_counts);
-    free(pm);
+    return create_polymer(input, size);
 }
 
-/*
-* Read input from a data file.
-* Assume first row is a template, second row is blank
-* All other rows are pair rules separated by " -> "
-*
-* @param    data_file       the data file to read
-* @param    p_template      pointer to the template buffer
-* @retval   num_rules       number of rules found
-*/
-char* read_input(char data_file[], char *p_template, size_t *template_length)
+void day14_answer(polymer_t *pm, char answer[ANSWER_LEN])
 {
-    FILE *file_handle = fopen(data_file, "r");
-    if (file_handle == NULL) {
-        printf("Error opening %s: %s.\n", data_file, strerror(errno));
-        exit(EXIT_FAILURE);
-    }
-
+    uintmax_t min_count, max_count;
+    if (!element_count_bounds(pm, &min_count, &max_count))
+        snprintf(answer, ANSWER_LEN, "%ju", max_count - min_count);
+}
 
-    // first line is the template
-    fgets(p_template, MAX_TEMPLATE * sizeof(char), file_handle);
-    *template_length = ftell(file_handle) - 1; // ignore newline
-    p_template[*template_length] = '\0';
-    //printf("Template length %lu bytes\n", template_length);
-
-    // get the remaining file size
-    fseek(file_handle, 0, SEEK_END);
-    size_t file_size = ftell(file_handle);
-    fseek(file_handle, *template_length + 1, SEEK_SET);
-
-    // get the rest of the input into a buffer
-    char *input_buffer = (char *)malloc(file_size * sizeof(char) + 1);
-    size_t bytes_read = fread(input_buffer, sizeof(char), file_size, file_handle);
-    if (bytes_read != (file_size - *template_length - 1)) {
-        printf("Error reading input buffer. Expected %lu, read %lu.\n",
-                (file_size - *template_length - 1), bytes_read);
-        exit(EXIT_FAILURE);
-    }
+void day14_part1(void *pm, char answer[ANSWER_LEN])
+{
+    grow_polymer(pm, 10);
+    day14_answer(pm, answer);
+}
 
-    fclose(file_handle);
-    input_buffer[file_size] = '\0';
+/* carries on from the 10 steps of part 1 */
+void day14_part2(void *pm, char answer[ANSWER_LEN])
+{
+    grow_polymer(pm, 30);
+    day14_answer(pm, answer);
+}
 
-    return input_buffer;
+void day14_free(void *pm)
+{
+    free_polymer(pm);
 }
 
+const struct Solver day14_solver = {
+    "14", day14_parse, day14_part1, day14_part2, day14_free, 1
+};
+
+#ifndef AOC_DRIVER
 int main(int argc, char *argv[])
 {
-    char template[MAX_TEMPLATE];
-    size_t template_length;
-    char *input_buffer = read_input("data/14data", template, &template_length);
-    polymer_t *pm = create_polymer(template, &template_length, input_buffer);
-    grow_polymer(pm, 40);
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day14_solver, argc - 1, argv + 1);
+
+    // usage: 14 [datafile] [steps]
+    char *data_file = (argc > 1) ? argv[1] : "data/14data";
+    int num_steps = (argc > 2) ? atoi(argv[2]) : 40;
+
+    size_t input_size;
+    char *input_buffer = read_file(data_file, &input_size);
+    polymer_t *pm = create_polymer(input_buffer, input_size);
+    free(input_buffer);
+    if (pm == NULL)
+        exit(-1);
+
+    grow_polymer(pm, num_steps);
     print_polymer(pm);
     element_count_range(pm);
     free_polymer(pm);
     return (EXIT_SUCCESS);
 }
+#endif
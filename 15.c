@@ -11,6 +11,10 @@ Plan: Take the input buffer using malloc
     paths that have higher risk.
 
     Use linked lists this time ;)
+
+    The search above turned out far too slow for a 100x100 map, so
+    the answer now comes from Dijkstra's algorithm, and the search is
+    kept as the reference for small maps.
 */
 
 #include <stdio.h>
@@ -18,11 +22,16 @@ Plan: Take the input buffer using malloc
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
+#include "util.h"
+#include "bench.h"
 
 //#define PRINT_DEBUG
-#define MAX_PATH_LEN 1027
+
+// a step costs at most 9, so the queue only ever holds 10 distinct risks
+#define RISK_BUCKETS 10
 
 struct CaveMap {
+    struct Arena *arena;        // the map and its risks live here
     int num_rows, num_cols;
     int end_index;
     uint8_t *risk;
@@ -30,66 +39,44 @@ struct CaveMap {
 
 typedef struct Path {
     int risk;
-    int length;
-    int indices[MAX_PATH_LEN];
+    struct IntVector indices;   // used as a stack by the search
 } Path;
 
-/* 
-* Read input from a data file and build a cave map.
+/*
+* Build a cave map from rows of risk digits.
 *
-* @param    data_file       The data file to read
+* @param    input_buffer    the input, zero terminated
+* @param    file_size       size of the input
 * @retval   cm              Cave map
+* @retval   NULL            the rows are not all as long as the first
 */
-struct CaveMap* read_input(char data_file[])
+struct CaveMap *CaveMap_parse(const char *input_buffer, size_t file_size)
 {
-    FILE* file_handle = fopen(data_file, "r");
-    // check that we opened the file
-    if (file_handle == NULL) {
-        printf("Error opening %s: %s.\n", data_file, strerror(errno));
-        exit(EXIT_FAILURE);
-    }
+    unsigned risk_index = 0;
 
-    // get the file size
-    fseek(file_handle, 0, SEEK_END);
-    size_t file_size = ftell(file_handle);
-    rewind(file_handle);
+    // initialize the cave map, in one block with its risks
+    struct Arena *arena = Arena_create(sizeof(struct CaveMap) + file_size + 2 * ARENA_ALIGN);
+    struct CaveMap *cm = Arena_alloc(arena, sizeof(struct CaveMap));
+    cm->arena = arena;
+    cm->risk = Arena_alloc(arena, file_size);
+    cm->num_cols = strcspn(input_buffer, "\r\n");
 
-    // allocate and read the input buffer
-    char *input_buffer = malloc(file_size * sizeof(char *) + 1);
-    size_t bytes_read = fread((void*)input_buffer, sizeof(char), file_size, file_handle);
-    if (bytes_read != file_size) {
-        printf("Error reading input_buffer. Read %lu, expected %lu.\n", bytes_read, file_size);
-        exit(EXIT_FAILURE);
-    }
-    // add a zero at the end
-    input_buffer[file_size] = '\0';
-
-    unsigned buffer_index = 0, risk_index = 0;;
-    char current_char;
-
-    // initialize the cave map
-    struct CaveMap *cm = malloc(sizeof(struct CaveMap));
-    cm->num_rows = cm->num_cols = 0;
-    cm->risk = malloc(sizeof(uint8_t) * file_size);
-
-    // assign the risk and number of rows/cols to the map
-    while((current_char = input_buffer[buffer_index]) != '\0') {
-        if (current_char == '\n' && cm->num_cols == 0)
-            cm->num_cols = buffer_index;
-        if (current_char != '\n') {
+    // assign the risk to the map, skipping line ends
+    for (size_t buffer_index = 0; buffer_index < file_size; buffer_index++) {
+        char current_char = input_buffer[buffer_index];
+        if (current_char >= '0' && current_char <= '9') {
             // convert char to uint8_t
             cm->risk[risk_index] = current_char - '0';
             risk_index++;
         }
-        buffer_index++;
+    }
+    if (cm->num_cols == 0 || risk_index % cm->num_cols != 0) {
+        Arena_destroy(arena);
+        return NULL;
     }
     cm->num_rows = risk_index / cm->num_cols;
     cm->end_index = cm->num_rows * cm->num_cols - 1;
 
-    // clean up
-    free(input_buffer);
-    fclose(file_handle);
-
 #ifdef PRINT_DEBUG
     printf("Rows: %d, Cols: %d\n", cm->num_rows, cm->num_cols);
     for (int i = 0; i < cm->num_rows; i++) {
@@ -102,6 +89,25 @@ struct CaveMap* read_input(char data_file[])
     return cm;
 }
 
+/* 
+* Read input from a data file and build a cave map.
+*
+* @param    data_file       The data file to read
+* @retval   cm              Cave map
+*/
+struct CaveMap* read_cave_map(char data_file[])
+{
+    size_t file_size;
+    char *input_buffer = read_file(data_file, &file_size);
+    struct CaveMap *cm = CaveMap_parse(input_buffer, file_size);
+    free(input_buffer);
+    if (cm == NULL) {
+        printf("Error: Cave map rows are not all the same length.\n");
+        exit(EXIT_FAILURE);
+    }
+    return cm;
+}
+
 /*
 * Find the neighboring points given an index in a cavemap.
 *
@@ -177,7 +183,7 @@ int path_risk(Path *p_path, struct CaveMap *p_map)
     p_path->risk = 0;
     // start path at 1, since the 0th index is the starting
     // position, and does not count towards total risk
-    for(int index = 1; index < p_path->length; index++) {
+    for(int index = 1; index < p_path->indices.size; index++) {
         p_path->risk += p_map->risk[index];
     }
     return p_path->risk;
@@ -194,8 +200,8 @@ int path_risk(Path *p_path, struct CaveMap *p_map)
 int in_path(int index, Path *p_path)
 {
     //for (int i = 0; i < p_path->length; i++) {
-    for (int i = p_path->length - 1; i >= 0; i--) {
-        if (index == p_path->indices[i])
+    for (int i = (int)p_path->indices.size - 1; i >= 0; i--) {
+        if (index == p_path->indices.data[i])
             return 1;
     }
     return 0;
@@ -204,8 +210,8 @@ int in_path(int index, Path *p_path)
 void print_path(Path *p, struct CaveMap *map)
 {
     printf("[ ");
-    for (int i = 0; i < p->length; i++) {
-        printf("%d ", map->risk[p->indices[i]]);
+    for (int i = 0; i < p->indices.size; i++) {
+        printf("%d ", map->risk[p->indices.data[i]]);
     }
     printf("]\n");
 }
@@ -223,7 +229,8 @@ void print_path_in_matrix(Path *p, struct  CaveMap *map)
     printf("\n\n");
 }
 /*
-* DFS search algorithm to find lowest risk path through cave system
+* DFS search algorithm to find lowest risk path through cave system.
+* Exponential in the size of the map; only used as a reference.
 *
 * @param    start_index     index to start on
 * @param    p_map           pointer to cavemap
@@ -244,15 +251,16 @@ void find_lowest_risk(int start_index, struct CaveMap *p_map, Path *p_path,
             if (in_path(neighbors[i], p_path)) { continue; }
             uint8_t next_risk = p_map->risk[neighbors[i]];
             if ((next_risk + p_path->risk) >= *min_risk) { continue; }
-            p_path->indices[p_path->length++] = neighbors[i];
+            IntVector_push(&p_path->indices, neighbors[i]);
             find_lowest_risk(neighbors[i], p_map, p_path, min_risk, num_paths);
             //printf("Recurse.\n");
-            p_path->length -= 1;
-            p_path->risk -= p_map->risk[p_path->indices[p_path->length]];
+            p_path->risk -= p_map->risk[IntVector_pop(&p_path->indices)];
         }
     } else {
+#ifdef PRINT_DEBUG
         printf("Made it to end. Risk = %d!\n", p_path->risk);
         print_path_in_matrix(p_path, p_map);
+#endif
         (*num_paths)++;
         //if (*num_paths % 10 == 0) {
             //printf("Found %d paths. Minimum Risk: %d\n", *num_paths, *min_risk);
@@ -263,18 +271,147 @@ void find_lowest_risk(int start_index, struct CaveMap *p_map, Path *p_path,
     }
 }
 
+/*
+* Find the risk of the lowest risk path from the top left to the bottom right
+*
+* @param    map             the cave map
+* @param    p_num_paths     number of paths examined (output)
+* @retval   min_risk        lowest total risk
+*/
+int CaveMap_lowest_risk(struct CaveMap *map, int *p_num_paths)
+{
+    Path path = { 0 };
+    IntVector_push(&path.indices, 0);
+    *p_num_paths = 0;
+    // no path is riskier than the one along the top row and down the last column
+    int min_risk = 9 * (map->num_rows + map->num_cols) + 1;
+    find_lowest_risk(0, map, &path, &min_risk, p_num_paths);
+    IntVector_free(&path.indices);
+    return min_risk;
+}
+
+/*
+* Find the risk of the lowest risk path with Dijkstra's algorithm.
+* Each step costs 0 to 9, so the open cells at risk r all sit in bucket
+* r % RISK_BUCKETS, and the buckets are emptied in order of risk: no heap
+* is needed, and each cell costs O(1). A cell can be queued again at a
+* lower risk; the stale entry is skipped when its bucket comes up.
+*
+* @param    map             the cave map
+* @retval   min_risk        lowest total risk
+*/
+int CaveMap_lowest_risk_dijkstra(struct CaveMap *map)
+{
+    int num_cells = map->end_index + 1;
+    int *risk_to = malloc(num_cells * sizeof(int));
+    if (risk_to == NULL) {
+        printf("Error: Out of memory for a %d cell cave map.\n", num_cells);
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < num_cells; i++) {
+        risk_to[i] = INT_MAX;
+    }
+    struct IntVector buckets[RISK_BUCKETS] = { { 0 } };
+    risk_to[0] = 0;
+    IntVector_push(&buckets[0], 0);
+    int num_queued = 1;
+
+    int risk;
+    for (risk = 0; num_queued > 0; risk++) {
+        struct IntVector *bucket = &buckets[risk % RISK_BUCKETS];
+        while (bucket->size > 0) {
+            int index = IntVector_pop(bucket);
+            num_queued--;
+            if (risk_to[index] != risk)
+                continue; // reached at a lower risk since
+            if (index == map->end_index)
+                goto done;
+            int neighbors[4];
+            int num_neighbors = find_neighbors(map, index, neighbors);
+            for (int i = 0; i < num_neighbors; i++) {
+                int next_risk = risk + map->risk[neighbors[i]];
+                if (next_risk < risk_to[neighbors[i]]) {
+                    risk_to[neighbors[i]] = next_risk;
+                    IntVector_push(&buckets[next_risk % RISK_BUCKETS], neighbors[i]);
+                    num_queued++;
+                }
+            }
+        }
+    }
+done:
+    for (int i = 0; i < RISK_BUCKETS; i++) {
+        IntVector_free(&buckets[i]);
+    }
+    risk = risk_to[map->end_index];
+    free(risk_to);
+    return risk;
+}
+
+/*
+* Compare Dijkstra's algorithm with the depth-first search on a small map.
+* Used by fuzz.c.
+*
+* @param    input       the map, zero terminated
+* @param    size        size of the input
+* @param    pool        unused, both engines are serial
+* @param    report      what differed (output)
+* @retval   mismatch    0 if both engines agree, 1 if not
+*/
+int day15_check_engines(const char *input, size_t size, struct ThreadPool *pool,
+        char report[ANSWER_LEN])
+{
+    struct CaveMap *map = CaveMap_parse(input, size);
+    if (map == NULL)
+        return 0; // nothing to check
+    int num_paths;
+    int expected = CaveMap_lowest_risk(map, &num_paths);
+    int risk = CaveMap_lowest_risk_dijkstra(map);
+    int mismatch = 0;
+    if (risk != expected) {
+        snprintf(report, ANSWER_LEN, "%dx%d map: risk %d, reference: %d",
+                map->num_rows, map->num_cols, risk, expected);
+        mismatch = 1;
+    }
+    Arena_destroy(map->arena);
+    return mismatch;
+}
+
+void *day15_parse(const char *input, size_t size)
+{
+    return CaveMap_parse(input, size);
+}
+
+void day15_part1(void *map, char answer[ANSWER_LEN])
+{
+    snprintf(answer, ANSWER_LEN, "%d", CaveMap_lowest_risk_dijkstra(map));
+}
+
+void day15_free(void *map)
+{
+    Arena_destroy(((struct CaveMap *)map)->arena);
+}
+
+/* Part 2 (the map tiled five times over) is not solved yet */
+const struct Solver day15_solver = {
+    "15", day15_parse, day15_part1, NULL, day15_free, 1
+};
+
+#ifndef AOC_DRIVER
 int main(int argc, char *argv[]) {
-    struct CaveMap *map = read_input("data/15data");
-    //struct CaveMap *map = read_input("data/15test");
-    Path *path = malloc(sizeof(Path));
-    path->risk = 0;
-    path->length = 1;
-    path->indices[0] = 0;
-    int num_paths = 0;
-    int min_risk = 100000; // arbitrarily high
-    find_lowest_risk(0, map, path, &min_risk, &num_paths);
-    printf("Minimum risk: %d\n", min_risk);
-    printf("Examined %d paths.\n", num_paths);
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day15_solver, argc - 1, argv + 1);
+
+    // usage: 15 [datafile] [dijkstra|dfs]
+    char *data_file = (argc > 1) ? argv[1] : "data/15data";
+    struct CaveMap *map = read_cave_map(data_file);
+    if (argc > 2 && strcmp(argv[2], "dfs") == 0) {
+        int num_paths;
+        int min_risk = CaveMap_lowest_risk(map, &num_paths);
+        printf("Minimum risk: %d\n", min_risk);
+        printf("Examined %d paths.\n", num_paths);
+    } else {
+        printf("Minimum risk: %d\n", CaveMap_lowest_risk_dijkstra(map));
+    }
 
 #ifdef PRINT_DEBUG
     int neighbors[4];
@@ -285,7 +422,7 @@ int main(int argc, char *argv[]) {
     }
     printf("\n");
 #endif
-    free(map->risk);
-    free(map);
+    Arena_destroy(map->arena);
     return (EXIT_SUCCESS);
 }
+#endif
@@ -1,68 +1,154 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include "bench.h"
 
-int sum_int_array(int target[], int target_size)
-// return the sum of an array of integers
+#define READ_CHUNK (1 << 20)
+
+/*
+* Count how often the sum of a window of depths is larger than the sum of
+* the window before it. Consecutive windows share all but one depth, so
+* the comparison is just the newest depth against the one that dropped
+* out: a[i] > a[i - window_size]. The last window_size depths are kept in
+* a ring buffer, so each depth costs one compare whatever the window size.
+* Depths are parsed with parse_ints() a chunk of the file at a time.
+*
+* @param    data            open input stream, one depth per line
+* @param    window_size     number of depths in a window (>= 1)
+* @retval   increases       number of windows larger than the previous one
+*/
+long depths_ring(FILE *data, int window_size)
 {
-    int sum = 0;
-    int i;
-    for (i = 0; i < target_size; i++) {
-        sum += target[i];
-        //printf("%d\n", target[i]);
+    int *ring = malloc(window_size * sizeof(int));
+    char *chunk = malloc(READ_CHUNK);
+    if (ring == NULL || chunk == NULL) {
+        printf("Error: Out of memory for a window of %d.\n", window_size);
+        exit(-1);
     }
-    return sum;
+
+    int *depths = NULL;
+    int num_parsed, capacity = 0;
+    long increases = 0;
+    long num_depths = 0;
+    int slot = 0;
+    size_t kept = 0, len;
+    do {
+        len = fread(chunk + kept, 1, READ_CHUNK - kept, data);
+        size_t avail = kept + len;
+        // parse up to the last newline, carrying a split depth over to the
+        // next chunk, and everything once the file has ended
+        size_t cut = avail;
+        while (len > 0 && cut > 0 && chunk[cut - 1] != '\n')
+            cut--;
+        if (cut == 0)
+            cut = avail;
+        num_parsed = 0;
+        if (parse_ints(chunk, cut, &depths, &num_parsed, &capacity) < 0) {
+            printf("Error: Depth out of range.\n");
+            exit(-1);
+        }
+        for (int i = 0; i < num_parsed; i++) {
+            if (num_depths >= window_size && depths[i] > ring[slot])
+                increases++;
+            ring[slot] = depths[i];
+            if (++slot == window_size)
+                slot = 0;
+            num_depths++;
+        }
+        kept = avail - cut;
+        memmove(chunk, chunk + cut, kept);
+    } while (len > 0);
+
+    free(depths);
+    free(chunk);
+    free(ring);
+    return increases;
 }
 
-void print_window(int target[], int size)
-// print every element in an array (debug function)
+/*
+* Count window increases over depths already in memory, where the
+* comparison needs no ring: a[i] > a[i - window_size].
+*
+* @param    depths          the depths
+* @param    num_depths      number of depths
+* @param    window_size     number of depths in a window (>= 1)
+* @retval   increases       number of windows larger than the previous one
+*/
+long count_window_increases(const int depths[], int num_depths, int window_size)
 {
+    long increases = 0;
     int i;
-    for (i = 0; i < size; i ++) {
-        printf("%d ", target[i]);
+    for (i = window_size; i < num_depths; i++) {
+        if (depths[i] > depths[i - window_size])
+            increases++;
     }
-    printf("\n");
+    return increases;
 }
 
-int depths_sliding(char input_file[], int window_size)
+struct Depths {
+    int *depths;
+    int num_depths;
+    int capacity;
+};
+
+void day1_free(void *puzzle)
 {
-    int depth_increases = 0;
-    FILE *file_pointer = fopen(input_file, "r");
-    char read_buffer[255];
-    
-    int sliding_window[window_size];
+    struct Depths *sonar = puzzle;
+    free(sonar->depths);
+    free(sonar);
+}
 
-    // fill the sliding_window array with zeros
-    memset(sliding_window, 0, window_size * sizeof(int));
-    int current_window_sum = 0;
-    int prev_window_sum = 0;
-    int i;
+void *day1_parse(const char *input, size_t size)
+{
+    struct Depths *sonar = calloc(1, sizeof(struct Depths));
+    assert(sonar != NULL);
+    if (parse_ints(input, size, &sonar->depths, &sonar->num_depths, &sonar->capacity) < 0) {
+        day1_free(sonar);
+        return NULL;
+    }
+    return sonar;
+}
 
-    while(fgets(read_buffer, sizeof(read_buffer), file_pointer) != NULL) {
-        // shift contents of sliding window
-        if (window_size > 1) {
-            for (i = 0; i < window_size - 1; i++) { 
-                sliding_window[i] = sliding_window[i+1];
-            }
-        }
-        // last element in window is next integer in text file.
-        sliding_window[i] = atoi(read_buffer);
-        if (sliding_window[0] != 0) { // don't start counting until window is full
-            current_window_sum = sum_int_array(sliding_window, window_size);
-            if (current_window_sum > prev_window_sum && prev_window_sum != 0) {
-                depth_increases++;
-            }
-        }
-        prev_window_sum = current_window_sum;
+void day1_part1(void *puzzle, char answer[ANSWER_LEN])
+{
+    struct Depths *sonar = puzzle;
+    snprintf(answer, ANSWER_LEN, "%ld",
+            count_window_increases(sonar->depths, sonar->num_depths, 1));
+}
 
-    }
-    fclose(file_pointer);
-    return depth_increases;
+void day1_part2(void *puzzle, char answer[ANSWER_LEN])
+{
+    struct Depths *sonar = puzzle;
+    snprintf(answer, ANSWER_LEN, "%ld",
+            count_window_increases(sonar->depths, sonar->num_depths, 3));
 }
 
+const struct Solver day1_solver = {
+    "1", day1_parse, day1_part1, day1_part2, day1_free, 1
+};
+
+#ifndef AOC_DRIVER
 int main(int argc, char *argv[])
 {
-    printf("Increases on sliding window: %d\n", 
-            depths_sliding("depths.txt", 7));
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day1_solver, argc - 1, argv + 1);
+
+    char *datafile = (argc > 1) ? argv[1] : "depths.txt";
+    int window_size = (argc > 2) ? atoi(argv[2]) : 7;
+    if (window_size < 1) {
+        printf("Error: Window size must be at least 1.\n");
+        exit(-1);
+    }
+
+    FILE *data = fopen(datafile, "r");
+    if (data == NULL) {
+        printf("Error opening %s: %s.\n", datafile, strerror(errno));
+        exit(-1);
+    }
+    printf("Increases on sliding window: %ld\n",
+            depths_ring(data, window_size));
+    fclose(data);
     return 0;
 }
+#endif
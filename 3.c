@@ -1,7 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
+#include "util.h"
 
 /* Work to go:
 1) Re-think how the datafile is read, and use getc() instead of gets()
@@ -16,49 +16,53 @@
 int main(int argc, char *argv[])
 {
     // get the data
-    char datafile[] = "data/3data";
+    char *datafile = (argc > 1) ? argv[1] : "data/3data";
     FILE *data = fopen(datafile, "r");
     if (data == NULL) {
         printf("error, no data file\n");
         return 1;
     }
-    char buffer[255];
 
-    // each number is 5 bits long
-    int data_size = 12;
-    int sums[data_size];
-    memset(sums, 0, data_size * sizeof(int));
-
-    int p; // bit position
-    int data_len = 0; // size of the data array
-    while(fgets(buffer, sizeof(buffer), data) != NULL) {
-        for (p = 0; p < data_size; p++) {
-            if (buffer[p] == '1') {
-                sums[p]++;
-            }
-        }
-        data_len++;
+    // count the ones in every column in a single pass,
+    // the word size comes from the first row
+    struct BitColumnCounter *counter = count_bit_columns(data);
+    fclose(data);
+    if (counter == NULL) {
+        printf("error, empty data file\n");
+        return 1;
     }
+    int data_size = counter->width;
+    unsigned long data_len = counter->num_rows;
 
     // print intermediate output
     int i;
     for (i = 0; i < data_size; i++) {
-        printf("%d ", sums[i]);
+        printf("%lu ", (unsigned long)counter->counts[i]);
     }
     printf("\n");
 
-    int gamma = 0;
-    int epsilon = 0;
-    int place;
+    // gamma takes the most common bit in each column, epsilon the least.
+    // Build both as bit strings so any word size works.
+    char *gamma_bits = malloc(data_size + 1);
+    char *epsilon_bits = malloc(data_size + 1);
     for (i = 0; i < data_size; i++) {
-        place = (int)pow(2, data_size - i - 1);
-        if ((double)(sums[i]) / (double)(data_len) > 0.5) {
-            gamma += place;
-        } else {
-            epsilon += place;
-        }
+        int most_common = (2 * counter->counts[i] >= data_len); // ties go to 1
+        gamma_bits[i] = most_common ? '1' : '0';
+        epsilon_bits[i] = most_common ? '0' : '1';
     }
-    printf("gamma: %d epsilon %d\n", gamma, epsilon);
-    printf("product: %d\n", gamma * epsilon);
+    gamma_bits[data_size] = epsilon_bits[data_size] = '\0';
+
+    if (data_size <= 32) {
+        unsigned long gamma = strtoul(gamma_bits, NULL, 2);
+        unsigned long epsilon = strtoul(epsilon_bits, NULL, 2);
+        printf("gamma: %lu epsilon %lu\n", gamma, epsilon);
+        printf("product: %lu\n", gamma * epsilon);
+    } else {
+        printf("gamma: %s\nepsilon: %s\n", gamma_bits, epsilon_bits);
+    }
+
+    free(gamma_bits);
+    free(epsilon_bits);
+    BitColumnCounter_destroy(counter);
     return 0;
 }
@@ -1,6 +1,9 @@
 #include <stdio.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
+#include "util.h"
+#include "bench.h"
 
 /* Part I Plan:
    - Read a datafile
@@ -46,35 +49,16 @@
         answers are completed
 
    */
-int get_word_size(FILE *data)
+unsigned long bin_to_int(char bin_str[], int *word_size)
 {
-    rewind(data); // start at the beginning
-    int word_size = 0;
-    while(fgetc(data) != '\n') {
-        word_size++;
-    }
-    return word_size;
-}
-
-int get_num_rows(FILE *data, int word_size)
-{
-    fseek(data, 0, SEEK_END);
-    int end_bytes = ftell(data);
-    rewind(data);
-
-    return end_bytes / (word_size + 1);
-}
-
-int bin_to_int(char bin_str[], int *word_size)
-{
-    int result = 0;
+    unsigned long result = 0;
     int bit_index;
     for (bit_index = 0; bit_index < *word_size; bit_index++) {
         switch (bin_str[bit_index]) {
             case '0':
                 break;
             case '1':
-                result += 0b1 << (*word_size - bit_index - 1);
+                result += 1UL << (*word_size - bit_index - 1);
                 break;
             case '\n':
             case '\0':
@@ -86,43 +70,18 @@ int bin_to_int(char bin_str[], int *word_size)
     return result;
 }
 
-void read_file_info(char datafile[], int *word_size, int *num_rows)
+int compare_numbers(const void *a, const void *b)
 {
-    FILE *data = fopen(datafile, "r");
-    assert(data != NULL);
-    
-    *word_size = get_word_size(data);
-    *num_rows = get_num_rows(data, *word_size);
-
-    // be kind
-    rewind(data);
-    fclose(data);
+    unsigned long na = *(const unsigned long *)a, nb = *(const unsigned long *)b;
+    return (na > nb) - (na < nb);
 }
 
-void read_data(char datafile[], int *word_size, int *num_rows, int numbers[])
-{
-    FILE *data = fopen(datafile, "r");
-    assert(data != NULL);
-
-    char buffer[*(word_size + 1)]; // additional char for \n
-    int i = 0;
-    while (fgets(buffer, sizeof(buffer), data) != NULL) {
-        numbers[i] = bin_to_int(buffer, word_size);
-        // printf("%d\n", numbers[i]);
-        i++;
-    }
-    
-    // be kind
-    rewind(data);
-    fclose(data);
-}
-
-unsigned short int most_common(int numbers[], int bit_index, int num_rows)
+unsigned short int most_common(unsigned long numbers[], int bit_index, int num_rows)
 {
     int i;
     int count1 = 0;
     int count0 = 0;
-    int test_bit = 0b1 << bit_index;
+    unsigned long test_bit = 1UL << bit_index;
     for (i = 0; i < num_rows; i++) {
         if (numbers[i] & test_bit) {
             count1++;
@@ -137,7 +96,7 @@ unsigned short int most_common(int numbers[], int bit_index, int num_rows)
     }
 }
 
-unsigned short int least_common(int numbers[], int bit_index, int num_rows)
+unsigned short int least_common(unsigned long numbers[], int bit_index, int num_rows)
 {
     if (most_common(numbers, bit_index, num_rows) == 1) {
         return 0;
@@ -146,12 +105,12 @@ unsigned short int least_common(int numbers[], int bit_index, int num_rows)
     }
 }
 
-int filter(int array[], int num_elements, int bit_index, int criteria)
+int filter(unsigned long array[], int num_elements, int bit_index, int criteria)
 {
     assert(criteria == 1 || criteria == 0);
     int i;
     int filtered_elements = 0;
-    int test_bit = 0b1 << bit_index;
+    unsigned long test_bit = 1UL << bit_index;
 
     for (i = 0; i < num_elements; i++) {
         if ((array[i] & test_bit) == (criteria * test_bit)) {
@@ -162,15 +121,6 @@ int filter(int array[], int num_elements, int bit_index, int criteria)
     return filtered_elements;
 }
 
-void print_array(int array[], int num_elements) {
-    int i;
-    printf("[ ");
-    for (i = 0; i < num_elements; i++) {
-        printf("%d ", array[i]);
-    }
-    printf("]\n");
-}
-
 int invert(int input, int word_size)
 {
     int i;
@@ -185,56 +135,289 @@ int invert(int input, int word_size)
     return result;
 }
 
-int main(int argc, char *argv[])
+/*
+* Find a rating by repeatedly filtering on the most (or least) common bit.
+* Each bit costs a full pass over the remaining numbers; kept as the
+* reference for find_rating().
+*
+* @param    numbers         the numbers (not modified)
+* @param    num_rows        number of numbers
+* @param    word_size       bits per number
+* @param    use_most        1 for oxygen (most common), 0 for CO2 (least common)
+* @retval   rating          the last number left
+*/
+unsigned long find_rating_reference(unsigned long numbers[], int num_rows,
+        int word_size, int use_most)
+{
+    unsigned long *remaining = malloc(num_rows * sizeof(unsigned long));
+    assert(remaining != NULL);
+    memcpy(remaining, numbers, num_rows * sizeof(unsigned long));
+
+    int index;
+    int criteria;
+    int filtered;
+    for (index = word_size - 1; index >= 0 && num_rows > 1; index--) { // start at msb
+        if (use_most)
+            criteria = most_common(remaining, index, num_rows);
+        else
+            criteria = least_common(remaining, index, num_rows);
+        filtered = filter(remaining, num_rows, index, criteria);
+        if (filtered > 0) // all left share this bit: nothing to filter
+            num_rows = filtered;
+    }
+    unsigned long rating = remaining[0];
+    free(remaining);
+    return rating;
+}
+
+/*
+* Find a rating from the sorted numbers. The candidates are always a
+* range of the sorted array sharing the bits seen so far, so within the
+* range the numbers with the next bit clear all come before those with it
+* set. A binary search for the split gives both counts, and keeping one
+* side narrows the range: O(word_size * log(num_rows)) in total.
+*
+* @param    sorted          the numbers, sorted ascending
+* @param    num_rows        number of numbers
+* @param    word_size       bits per number
+* @param    use_most        1 for oxygen (most common), 0 for CO2 (least common)
+* @retval   rating          the last number left
+*/
+unsigned long find_rating(unsigned long sorted[], int num_rows, int word_size,
+        int use_most)
+{
+    int lo = 0, hi = num_rows;
+    int index;
+    for (index = word_size - 1; index >= 0 && hi - lo > 1; index--) {
+        unsigned long test_bit = 1UL << index;
+        // first number in the range with this bit set
+        int first = lo, last = hi;
+        while (first < last) {
+            int mid = first + (last - first) / 2;
+            if (sorted[mid] & test_bit) last = mid; else first = mid + 1;
+        }
+        int zeros = first - lo, ones = hi - first;
+        // ties keep the ones for oxygen and the zeros for CO2
+        int keep_ones = (use_most) ? (ones >= zeros) : (ones < zeros);
+        if (keep_ones && ones > 0)
+            lo = first;
+        else if (zeros > 0)
+            hi = first;
+        else
+            lo = first;
+    }
+    return sorted[lo];
+}
+
+struct Diagnostic {
+    const char *input;
+    size_t size;
+    int word_size;
+    int num_rows;
+    unsigned long *numbers;     // sorted by part 2
+    unsigned long gamma, epsilon;
+    unsigned long ox_rate, co2_rate;
+};
+
+void day3_free(void *puzzle)
+{
+    struct Diagnostic *report = puzzle;
+    free(report->numbers);
+    free(report);
+}
+
+/*
+* Parse a diagnostic report: rows of '0' and '1', all as wide as the first
+*
+* @param    input       the report, zero terminated
+* @param    size        size of the input
+* @retval   report      the parsed report
+* @retval   NULL        the first row is empty or wider than 64 bits, or a
+*                       row has another width or a character other than 0 or 1
+*/
+void *day3_parse(const char *input, size_t size)
 {
-    int word_size, num_rows;
-    char data_file[] = "3data.txt";
+    struct Diagnostic *report = calloc(1, sizeof(struct Diagnostic));
+    assert(report != NULL);
+    report->input = input;
+    report->size = size;
+    const char *row = input + strspn(input, "\r\n");
+    report->word_size = strcspn(row, "\r\n");
+    if (report->word_size == 0 || report->word_size > 64) {
+        free(report);
+        return NULL;
+    }
 
-    read_file_info(data_file, &word_size, &num_rows);
+    // every row takes word_size + 1 bytes, bar the last
+    report->numbers = malloc((size / (report->word_size + 1) + 1)
+            * sizeof(unsigned long));
+    assert(report->numbers != NULL);
+    while (*row != '\0') {
+        if (strspn(row, "01") != (size_t)report->word_size
+                || strchr("\r\n", row[report->word_size]) == NULL) {
+            day3_free(report);
+            return NULL;
+        }
+        report->numbers[report->num_rows++] =
+            bin_to_int((char *)row, &report->word_size);
+        row += report->word_size;
+        row += strspn(row, "\r\n");
+    }
+    return report;
+}
 
-    int numbers[num_rows];
-    read_data(data_file, &word_size, &num_rows, numbers);
+/*
+* Format a 128 bit number in decimal
+*
+* @param    value       the number
+* @param    str         string to write to, at least 40 chars
+*/
+void format_u128(unsigned __int128 value, char str[])
+{
+    char digits[40];
+    int n = 0;
+    do {
+        digits[n++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (n > 0) {
+        *str++ = digits[--n];
+    }
+    *str = '\0';
+}
 
-    printf("word size: %d bits\n", word_size);
-    printf("file size: %d rows\n", num_rows);
+void day3_part1(void *puzzle, char answer[ANSWER_LEN])
+{
+    struct Diagnostic *report = puzzle;
+    int word_size = report->word_size;
+
+    // all column counts come from one pass over the rows,
+    // rather than a pass over the numbers for every bit
+    struct BitColumnCounter *counter = BitColumnCounter_create(word_size);
+    const char *row = report->input + strspn(report->input, "\r\n");
+    while (*row != '\0') {
+        BitColumnCounter_add_row(counter, row);
+        row += word_size;
+        row += strspn(row, "\r\n");
+    }
+    BitColumnCounter_flush(counter);
 
     int i;
-    unsigned int gamma = 0;
-    unsigned int epsilon = 0;
+    report->gamma = report->epsilon = 0;
     for (i = 0; i < word_size; i++) {
-        gamma += most_common(numbers, i, num_rows) << i;
-        epsilon += least_common(numbers, i, num_rows) << i;
+        // column 0 is the most significant bit; ties go to 1, as in most_common()
+        unsigned long bit = 1UL << (word_size - i - 1);
+        if (2 * counter->counts[i] >= counter->num_rows) {
+            report->gamma += bit;
+        } else {
+            report->epsilon += bit;
+        }
     }
-    printf("gamma: %u\n", gamma);
-    printf("epsilon: %u\n", epsilon);
+    BitColumnCounter_destroy(counter);
+    // both fit in 64 bits, their product needs up to 128
+    format_u128((unsigned __int128)report->gamma * report->epsilon, answer);
+}
 
-    int index;
-    int criteria;
+void day3_part2(void *puzzle, char answer[ANSWER_LEN])
+{
+    struct Diagnostic *report = puzzle;
+    // sort once, then both ratings are a walk down the sorted ranges
+    qsort(report->numbers, report->num_rows, sizeof(unsigned long),
+            compare_numbers);
+    report->ox_rate = find_rating(report->numbers, report->num_rows,
+            report->word_size, 1);
+    report->co2_rate = find_rating(report->numbers, report->num_rows,
+            report->word_size, 0);
+    format_u128((unsigned __int128)report->ox_rate * report->co2_rate, answer);
+}
+
+/*
+* Compare the fast ratings and the bit column counts with the one bit at a
+* time reference. Used by fuzz.c.
+*
+* @param    input       the report, zero terminated
+* @param    size        size of the input
+* @param    pool        unused, all the engines are serial
+* @param    report      what differed (output)
+* @retval   mismatch    0 if every engine agrees, 1 if not
+*/
+int day3_check_engines(const char *input, size_t size, struct ThreadPool *pool,
+        char report[ANSWER_LEN])
+{
+    struct Diagnostic *diag = day3_parse(input, size);
+    if (diag == NULL)
+        return 0; // nothing to check
+    int mismatch = 0;
+    int i;
+
+    // gamma from the bit sliced counter against counting each column
+    char answer[ANSWER_LEN], expected[40];
+    unsigned long gamma = 0, epsilon = 0;
+    for (i = 0; i < diag->word_size; i++) {
+        if (most_common(diag->numbers, i, diag->num_rows))
+            gamma |= 1UL << i;
+        else
+            epsilon |= 1UL << i;
+    }
+    day3_part1(diag, answer);
+    format_u128((unsigned __int128)gamma * epsilon, expected);
+    if (strcmp(answer, expected) != 0) {
+        snprintf(report, ANSWER_LEN, "power %.64s, reference: %s", answer, expected);
+        mismatch = 1;
+    }
 
-    for (index = word_size - 1; index >= 0; index--) { // start at msb
-        criteria = most_common(numbers, index, num_rows);
-        // print_array(numbers, num_rows);
-        // printf("most common at index %d: %d\n", index, criteria);
-        num_rows = filter(numbers, num_rows, index, criteria);
-        if (num_rows == 1)
-            break;
+    unsigned long ratings[2];
+    for (i = 0; i < 2 && !mismatch; i++)
+        ratings[i] = find_rating_reference(diag->numbers, diag->num_rows,
+                diag->word_size, i);
+    qsort(diag->numbers, diag->num_rows, sizeof(unsigned long), compare_numbers);
+    for (i = 0; i < 2 && !mismatch; i++) {
+        unsigned long rating = find_rating(diag->numbers, diag->num_rows,
+                diag->word_size, i);
+        if (rating == ratings[i])
+            continue;
+        snprintf(report, ANSWER_LEN, "%s rating %lu, reference: %lu",
+                i ? "oxygen" : "CO2", rating, ratings[i]);
+        mismatch = 1;
     }
-    int ox_rate = numbers[0];
-    read_file_info(data_file, &word_size, &num_rows);
-    read_data(data_file, &word_size, &num_rows, numbers);
+    day3_free(diag);
+    return mismatch;
+}
+
+const struct Solver day3_solver = {
+    "3", day3_parse, day3_part1, day3_part2, day3_free, 1
+};
+
+#ifndef AOC_DRIVER
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day3_solver, argc - 1, argv + 1);
 
-    for (index = word_size - 1; index >= 0; index--) { // start at msb
-        criteria = invert(most_common(numbers, index, num_rows), 1);
-        // print_array(numbers, num_rows);
-        // printf("most common at index %d: %d\n", index, criteria);
-        num_rows = filter(numbers, num_rows, index, criteria);
-        if (num_rows == 1)
-            break;
+    char *data_file = (argc > 1) ? argv[1] : "3data.txt";
+
+    // the file is read from disk once, everything else works from memory
+    size_t file_size;
+    char *input = read_file(data_file, &file_size);
+    struct Diagnostic *report = day3_parse(input, file_size);
+    if (report == NULL) {
+        printf("Error: Rows must be 1 to 64 characters of 0 and 1, all the same width.\n");
+        exit(-1);
     }
+    printf("word size: %d bits\n", report->word_size);
+    printf("file size: %d rows\n", report->num_rows);
+
+    char answer[ANSWER_LEN];
+    day3_part1(report, answer);
+    printf("gamma: %lu\n", report->gamma);
+    printf("epsilon: %lu\n", report->epsilon);
 
-    int co2_rate = numbers[0];
-    printf("Oxygen Rate: %d - CO2 Rate: %d\n", ox_rate, co2_rate);
-    printf("Result: %d\n", ox_rate * co2_rate);
+    day3_part2(report, answer);
+    printf("Oxygen Rate: %lu - CO2 Rate: %lu\n", report->ox_rate, report->co2_rate);
+    printf("Result: %s\n", answer);
 
+    day3_free(report);
+    free(input);
     return 0;
 }
+#endif
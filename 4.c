@@ -2,11 +2,16 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include "util.h"
+#include "bench.h"
 
 // global for row/column length
 #define SET_SIZE 5
-#define MAX_CALLS 255
-#define MAX_BOARDS 255
+#define BOARD_CELLS (SET_SIZE * SET_SIZE)
+// largest bingo number, so that a call times a board's sum fits in a long
+#define MAX_NUMBER (1 << 28)
 /* Assumptions:
     Given input file where first line is comma separated list of
     values.
@@ -27,17 +32,6 @@
             and a number of turns
 */
 
-int is_in(int element, int array[], int arr_size) 
-{
-    int i;
-    for (i = 0; i < arr_size; i++) {
-        if (array[i] == element) {
-            return 1;
-        }
-    }
-    return 0;
-}
-
 int is_complete(int Set[], int calls[], int turn)
 {
     int counter = 0;
@@ -76,10 +70,9 @@ int Board_complete(struct Board *brd, int calls[], int turn)
     return 0;
 }
 
-struct Set *Set_create(int Set_nums[])
+struct Set *Set_create(struct Arena *arena, int Set_nums[])
 {
-    struct Set *Set = malloc(sizeof(struct Set));
-    assert(Set != NULL);
+    struct Set *Set = Arena_alloc(arena, sizeof(struct Set));
 
     int i;
     for (i = 0; i < SET_SIZE; i++) {
@@ -98,9 +91,9 @@ void Set_print(struct Set *Set)
     printf("]\n");
 }
 
-struct Board *Board_create()
+struct Board *Board_create(struct Arena *arena)
 {
-    struct Board *brd = malloc(sizeof(struct Board));
+    struct Board *brd = Arena_alloc(arena, sizeof(struct Board));
     brd->winning_turn = -1;
 
     return brd;
@@ -118,24 +111,16 @@ void Board_print(struct Board *brd)
 int split_str(int array[], char str[], char delimeter[])
 {
     int splits = 0;
-    char *ptr = strtok(str, delimeter);
+    char *saveptr = NULL;
+    char *ptr = strtok_r(str, delimeter, &saveptr);
     while (ptr != NULL) {
         array[splits] = atoi(ptr);
-        ptr = strtok(NULL, delimeter);
+        ptr = strtok_r(NULL, delimeter, &saveptr);
         splits++;
     }
     return splits;
 }
 
-void print_array(int array[], int num_elements) {
-    int i;
-    printf("[ ");
-    for (i = 0; i < num_elements; i++) {
-        printf("%d ", array[i]);
-    }
-    printf("]\n");
-}
-
 void fill_cols(struct Board *brd)
 {
     int row, col;
@@ -174,15 +159,16 @@ void run_tests()
     int r4[] = { 18, 19, 20, 21, 22 };
     int r5[] = { 23, 24, 25, 26, 27 };
 
-    struct Set *test_Set = Set_create(test_input);
-    struct Set *R1 = Set_create(r1);
-    struct Set *R2 = Set_create(r2);
-    struct Set *R3 = Set_create(r3);
-    struct Set *R4 = Set_create(r4);
-    struct Set *R5 = Set_create(r5);
+    struct Arena *arena = Arena_create(0);
+    struct Set *test_Set = Set_create(arena, test_input);
+    struct Set *R1 = Set_create(arena, r1);
+    struct Set *R2 = Set_create(arena, r2);
+    struct Set *R3 = Set_create(arena, r3);
+    struct Set *R4 = Set_create(arena, r4);
+    struct Set *R5 = Set_create(arena, r5);
 
     struct Set *b_test[] = { R1, R2, R3, R4, R5 };
-    struct Board *b = Board_create();
+    struct Board *b = Board_create(arena);
 
     int i;
     for (i = 0; i < SET_SIZE; i++) {
@@ -207,98 +193,679 @@ void run_tests()
     int split_len = split_str(split_test, str_test, ",");
     printf("split_len: %d\n", split_len);
     print_array(split_test, split_len);
+    Arena_destroy(arena);
 }
 
-void read_data(char data_file[], int calls[], int *num_calls, 
-        struct Board boards[], int *board_count)
-{
-    FILE *data = fopen(data_file, "r");
-    assert(data != NULL);
-
-    char buffer[MAX_CALLS];
-    *num_calls = split_str(calls, fgets(buffer, sizeof(buffer), data), ",");
-//    print_array(calls, num_calls);
-
-    int set_count = 0;
-    int set_arr[SET_SIZE];
-    int row_len;
-
-    // advance past first newline
-    fgets(buffer, sizeof(buffer), data);
-    boards[0] = *Board_create();
-    while(fgets(buffer, sizeof(buffer), data) != NULL) {
-        if (buffer[0] == '\n') {
-            fill_cols(&boards[*board_count]);
-            *board_count += 1;
-            boards[*board_count] = *Board_create();
-            set_count = 0;
-            continue;
-        } else {
-            row_len = split_str(set_arr, buffer, " ");
-            assert(row_len == 5);
-            boards[*board_count].rows[set_count] = *Set_create(set_arr);
-            // printf("%d-%d: ", board_count, set_count);
-            // Set_print(&set_tmp);
-            // Board_print(&boards[board_count]);
-            set_count++;
-            // printf("%s", buffer);
-        }
+/* A whole game: the calls in order, and the cells of every board in one
+   array, BOARD_CELLS per board in row-major order. The distinct numbers
+   called are also given dense ids 0 .. num_ids - 1, so the engines index
+   their tables by id rather than by number, however big the numbers. */
+struct Bingo {
+    int num_calls;
+    int *calls;
+    int num_boards;
+    int *cells;
+    int num_ids;
+    int *call_ids;  // id of each call
+    int *cell_ids;  // id of each cell, num_ids if its number is never called
+};
+
+/* A board that wins, and its score */
+struct Winner {
+    int board;      // -1 if no board wins
+    int turn;       // turn the board wins on, counting from 1
+    long uncalled;  // sum of the numbers not called by that turn
+};
+
+/* Cells are numbered 0-24 in row-major order, cell r * 5 + c is bit
+   r * 5 + c of a board's mask. These are the 5 rows and 5 columns. */
+const uint32_t LINE_MASKS[2 * SET_SIZE] = {
+    0x000001F, 0x00003E0, 0x0007C00, 0x00F8000, 0x1F00000,
+    0x0108421, 0x0210842, 0x0421084, 0x0842108, 0x1084210,
+};
+
+void Bingo_destroy(struct Bingo *bingo)
+{
+    free(bingo->calls);
+    free(bingo->cells);
+    free(bingo->call_ids);
+    free(bingo->cell_ids);
+    free(bingo);
+}
+
+int compare_ints(const void *a, const void *b)
+{
+    int na = *(const int *)a, nb = *(const int *)b;
+    return (na > nb) - (na < nb);
+}
+
+/*
+* Give the distinct numbers called ids in order of value, and every call
+* and cell the id of its number
+*
+* @param    bingo       the game, with calls and cells
+* @retval   0           success
+* @retval   -1          out of memory
+*/
+int Bingo_number_ids(struct Bingo *bingo)
+{
+    int num_cells = bingo->num_boards * BOARD_CELLS;
+    int *numbers = malloc(bingo->num_calls * sizeof(int));
+    bingo->call_ids = malloc(bingo->num_calls * sizeof(int));
+    bingo->cell_ids = malloc(num_cells * sizeof(int));
+    if ((bingo->num_calls > 0 && (numbers == NULL || bingo->call_ids == NULL))
+            || (num_cells > 0 && bingo->cell_ids == NULL)) {
+        free(numbers);
+        return -1;
     }
 
-    /*printf("\n");*/
-    /*Board_print(&boards[2]);*/
-    /*printf("\n");*/
-    /*Set_print(&boards[1].cols[4]);*/
-    fclose(data);
+    int i;
+    if (bingo->num_calls > 0)
+        memcpy(numbers, bingo->calls, bingo->num_calls * sizeof(int));
+    qsort(numbers, bingo->num_calls, sizeof(int), compare_ints);
+    bingo->num_ids = 0;
+    for (i = 0; i < bingo->num_calls; i++) {
+        if (i == 0 || numbers[i] != numbers[i - 1])
+            numbers[bingo->num_ids++] = numbers[i];
+    }
+    for (i = 0; i < bingo->num_calls; i++) {
+        int *found = bsearch(&bingo->calls[i], numbers, bingo->num_ids, sizeof(int),
+                compare_ints);
+        bingo->call_ids[i] = found - numbers;
+    }
+    for (i = 0; i < num_cells; i++) {
+        int *found = bsearch(&bingo->cells[i], numbers, bingo->num_ids, sizeof(int),
+                compare_ints);
+        bingo->cell_ids[i] = (found != NULL) ? found - numbers : bingo->num_ids;
+    }
+    free(numbers);
+    return 0;
 }
 
-int score(struct Board *brd, int calls[], int turn)
+/*
+* Parse a game. The first line is the comma separated calls, of any
+* length; every number after it belongs to a board. Bingo numbers are
+* from 0 to MAX_NUMBER.
+*
+* @param    input           the input, zero terminated
+* @param    file_size       size of the input
+* @retval   bingo           the game
+* @retval   NULL            a number is out of range, the board numbers
+*                           don't make whole boards, or out of memory
+*/
+struct Bingo *parse_bingo(const char *input, size_t file_size)
 {
-    int uncalled = sum_uncalled(brd, calls, turn);
-    printf("Sum of uncalled: %d\n", uncalled);
-    printf("Last call: %d\n", calls[turn - 1]);
-    int result = calls[turn - 1] * uncalled;
-    printf("Result: %d\n", result);
+    struct Bingo *bingo = calloc(1, sizeof(struct Bingo));
+    if (bingo == NULL)
+        return NULL;
+
+    const char *newline = memchr(input, '\n', file_size);
+    size_t calls_len = (newline != NULL) ? (size_t)(newline - input) : file_size;
+    int capacity = 0;
+    int num_cells = 0;
+    int ok = parse_ints(input, calls_len, &bingo->calls, &bingo->num_calls, &capacity) >= 0;
+    capacity = 0;
+    ok = ok && parse_ints(input + calls_len, file_size - calls_len, &bingo->cells,
+            &num_cells, &capacity) >= 0;
+    ok = ok && num_cells % BOARD_CELLS == 0;
+    int i;
+    for (i = 0; ok && i < bingo->num_calls; i++) {
+        ok = bingo->calls[i] >= 0 && bingo->calls[i] <= MAX_NUMBER;
+    }
+    for (i = 0; ok && i < num_cells; i++) {
+        ok = bingo->cells[i] >= 0 && bingo->cells[i] <= MAX_NUMBER;
+    }
+    bingo->num_boards = num_cells / BOARD_CELLS;
+    if (!ok || Bingo_number_ids(bingo) < 0) {
+        Bingo_destroy(bingo);
+        return NULL;
+    }
+    return bingo;
+}
 
-    return result;
+/*
+* Read a game from a data file
+*
+* @param    data_file       data file to read
+* @retval   bingo           the game
+*/
+struct Bingo *read_data(char data_file[])
+{
+    size_t file_size;
+    char *input = read_file(data_file, &file_size);
+    struct Bingo *bingo = parse_bingo(input, file_size);
+    free(input);
+    if (bingo == NULL) {
+        printf("Error: Bingo numbers must be whole boards of %d numbers from 0 to %d.\n",
+                BOARD_CELLS, MAX_NUMBER);
+        exit(-1);
+    }
+    return bingo;
 }
 
-int main(int argc, char *argv[])
+/*
+* Fill a board (rows and columns) from its cells
+*
+* @param    brd         board to fill
+* @param    cells       BOARD_CELLS numbers in row-major order
+*/
+void Board_fill(struct Board *brd, int cells[])
 {
-    int calls[MAX_CALLS];
-    int num_calls;
-    int board_count = 0;
-    struct Board boards[MAX_BOARDS];
-    read_data("data/4data", calls, &num_calls, boards, &board_count);
-    //run_tests();
+    int r;
+    for (r = 0; r < SET_SIZE; r++) {
+        memcpy(brd->rows[r].numbers, &cells[r * SET_SIZE], SET_SIZE * sizeof(int));
+    }
+    fill_cols(brd);
+    brd->winning_turn = -1;
+}
+
+/*
+* Find the first and last winners by checking every board on every turn.
+* This is slow (the number of turns squared times the number of boards),
+* and kept as the reference the faster engines must agree with.
+*
+* @param    bingo       the game
+* @param    first       first board to win (output)
+* @param    last        last board to win (output)
+* @retval   0           success
+* @retval   -1          out of memory
+*/
+int find_winners_reference(struct Bingo *bingo, struct Winner *first,
+        struct Winner *last)
+{
+    first->board = last->board = -1;
+    if (bingo->num_boards == 0)
+        return 0;
+    struct Board *boards = malloc(bingo->num_boards * sizeof(struct Board));
+    if (boards == NULL)
+        return -1;
+    int b;
+    for (b = 0; b < bingo->num_boards; b++) {
+        Board_fill(&boards[b], &bingo->cells[b * BOARD_CELLS]);
+    }
 
     // start at turn 5, since impossible to win before this
-    int turn = 4;
+    int turn;
+    for (turn = SET_SIZE; turn <= bingo->num_calls; turn++) {
+        // each turn, look through all the boards that haven't won yet
+        for (b = 0; b < bingo->num_boards; b++) {
+            if (boards[b].winning_turn == -1
+                    && Board_complete(&boards[b], bingo->calls, turn)) {
+                last->board = b;
+                last->turn = turn;
+                last->uncalled = sum_uncalled(&boards[b], bingo->calls, turn);
+                if (first->board < 0)
+                    *first = *last;
+            }
+        }
+    }
+    free(boards);
+    return 0;
+}
+
+/*
+* Build an index from each number's id to the turn it is first called on.
+* Turns count from 1, so the number called on turn t is calls[t - 1].
+* The entry after the called numbers, id num_ids, is for the numbers that
+* are never called and holds turn num_calls + 1.
+*
+* @param    bingo           the game
+* @retval   turn_index      num_ids + 1 turns, indexed by id
+* @retval   NULL            out of memory
+*/
+int *build_turn_index(struct Bingo *bingo)
+{
+    int *turn_index = malloc((bingo->num_ids + 1) * sizeof(int));
+    if (turn_index == NULL)
+        return NULL;
+    turn_index[bingo->num_ids] = bingo->num_calls + 1;
+    // if a number is called twice, only the first call counts
+    int i;
+    for (i = bingo->num_calls - 1; i >= 0; i--) {
+        turn_index[bingo->call_ids[i]] = i + 1;
+    }
+    return turn_index;
+}
+
+/*
+* Find the turn on which a board wins: a row or column is complete on the
+* turn its last number is called, and the board wins with its first
+* complete row or column.
+*
+* @param    ids         ids of the board's cells in row-major order
+* @param    turn_index  turn each id is called on
+* @param    num_calls   number of calls
+* @retval   turn        winning turn
+* @retval   num_calls + 1   board never wins
+*/
+int Board_win_turn(int ids[], int turn_index[], int num_calls)
+{
+    int r, c;
+    int win_turn = num_calls + 1;
+    int row_turn, col_turn;
+    for (r = 0; r < SET_SIZE; r++) {
+        row_turn = col_turn = 0;
+        for (c = 0; c < SET_SIZE; c++) {
+            int turn = turn_index[ids[r * SET_SIZE + c]];
+            if (turn > row_turn)
+                row_turn = turn;
+            turn = turn_index[ids[c * SET_SIZE + r]];
+            if (turn > col_turn)
+                col_turn = turn;
+        }
+        if (row_turn < win_turn)
+            win_turn = row_turn;
+        if (col_turn < win_turn)
+            win_turn = col_turn;
+    }
+    return win_turn;
+}
+
+/*
+* Sum the numbers on a board that have not been called by a given turn,
+* using the turn index rather than scanning the calls.
+*/
+long sum_uncalled_indexed(struct Bingo *bingo, int board, int turn_index[], int turn)
+{
+    int *cells = &bingo->cells[board * BOARD_CELLS];
+    int *ids = &bingo->cell_ids[board * BOARD_CELLS];
+    long sum = 0;
+    int i;
+    for (i = 0; i < BOARD_CELLS; i++) {
+        if (turn_index[ids[i]] > turn)
+            sum += cells[i];
+    }
+    return sum;
+}
+
+/*
+* Find the first and last winners from each board's winning turn.
+* One pass over the boards, ties go to the lowest numbered board for the
+* first winner and the highest numbered board for the last, as when
+* checking turn by turn.
+*
+* @param    bingo       the game
+* @param    first       first board to win (output)
+* @param    last        last board to win (output)
+* @retval   0           success
+* @retval   -1          out of memory
+*/
+int find_winners_indexed(struct Bingo *bingo, struct Winner *first,
+        struct Winner *last)
+{
+    int *turn_index = build_turn_index(bingo);
+    first->board = last->board = -1;
+    if (turn_index == NULL)
+        return -1;
+    first->turn = bingo->num_calls + 1;
+    last->turn = 0;
+
     int b;
-    int num_winners = 0;
-
-    while (turn <= num_calls) {
-        // each turn, look through all the boards
-        for (b = 0; b <= board_count; b++) {
-            // only check board that haven't won yet
-            if (boards[b].winning_turn == -1) {
-                if (Board_complete(&boards[b], calls, turn)) {
-                    num_winners++;
-                    // Assume all boards win eventually
-                    if ((num_winners == 1 || num_winners >= board_count)) {
-                        printf("Board number %d complete on turn %d!\n",
-                                b, turn);
-                        score(&boards[b], calls, turn);
-                    }
-                }
+    for (b = 0; b < bingo->num_boards; b++) {
+        int turn = Board_win_turn(&bingo->cell_ids[b * BOARD_CELLS], turn_index,
+                bingo->num_calls);
+        if (turn > bingo->num_calls)
+            continue; // never wins
+        if (turn < first->turn) {
+            first->board = b;
+            first->turn = turn;
+        }
+        if (turn >= last->turn) {
+            last->board = b;
+            last->turn = turn;
+        }
+    }
+
+    // only the two winners need scoring
+    if (first->board >= 0) {
+        first->uncalled = sum_uncalled_indexed(bingo, first->board, turn_index, first->turn);
+        last->uncalled = sum_uncalled_indexed(bingo, last->board, turn_index, last->turn);
+    }
+    free(turn_index);
+    return 0;
+}
+
+/* Shared state for finding winners on a thread pool. Winners are packed
+   as (turn << 32) | board, so the first winner is the smallest key (lowest
+   board on a tie) and the last winner the largest (highest board on a tie),
+   and each thread folds its local result in with one atomic min and max. */
+struct WinnerJob {
+    struct Bingo *bingo;
+    int *turn_index;
+    int num_parts;
+    uint64_t first_key;
+    uint64_t last_key;
+};
+
+void atomic_min_u64(uint64_t *target, uint64_t value)
+{
+    uint64_t current = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value < current && !__atomic_compare_exchange_n(target, &current, value,
+                1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+void atomic_max_u64(uint64_t *target, uint64_t value)
+{
+    uint64_t current = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value > current && !__atomic_compare_exchange_n(target, &current, value,
+                1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/*
+* Thread pool task: find the winning turns of one range of boards
+*/
+void winner_task(void *ctx, int part)
+{
+    struct WinnerJob *job = ctx;
+    struct Bingo *bingo = job->bingo;
+    long first = (long)bingo->num_boards * part / job->num_parts;
+    long last = (long)bingo->num_boards * (part + 1) / job->num_parts;
+    uint64_t first_key = UINT64_MAX, last_key = 0;
+    for (long b = first; b < last; b++) {
+        uint64_t turn = Board_win_turn(&bingo->cell_ids[b * BOARD_CELLS], job->turn_index,
+                bingo->num_calls);
+        if (turn > bingo->num_calls)
+            continue; // never wins
+        uint64_t key = (turn << 32) | b;
+        if (key < first_key)
+            first_key = key;
+        if (key > last_key)
+            last_key = key;
+    }
+    atomic_min_u64(&job->first_key, first_key);
+    atomic_max_u64(&job->last_key, last_key);
+}
+
+/*
+* Find the first and last winners, evaluating boards on a thread pool.
+* Same results as find_winners_indexed().
+*
+* @param    bingo       the game
+* @param    first       first board to win (output)
+* @param    last        last board to win (output)
+* @param    pool        thread pool to run on
+* @retval   0           success
+* @retval   -1          out of memory
+*/
+int find_winners_parallel(struct Bingo *bingo, struct Winner *first,
+        struct Winner *last, struct ThreadPool *pool)
+{
+    struct WinnerJob job;
+    job.bingo = bingo;
+    job.turn_index = build_turn_index(bingo);
+    first->board = last->board = -1;
+    if (job.turn_index == NULL)
+        return -1;
+    // a few parts per thread evens out the load
+    job.num_parts = 4 * pool->num_threads;
+    job.first_key = UINT64_MAX;
+    job.last_key = 0;
+    ThreadPool_run(pool, winner_task, &job, job.num_parts);
+
+    if (job.first_key != UINT64_MAX) {
+        first->board = job.first_key & 0xFFFFFFFF;
+        first->turn = job.first_key >> 32;
+        last->board = job.last_key & 0xFFFFFFFF;
+        last->turn = job.last_key >> 32;
+        // only the two winners need scoring
+        first->uncalled = sum_uncalled_indexed(bingo, first->board, job.turn_index,
+                first->turn);
+        last->uncalled = sum_uncalled_indexed(bingo, last->board, job.turn_index,
+                last->turn);
+    }
+    free(job.turn_index);
+    return 0;
+}
+
+/*
+* Determine whether a board's marked cells complete any row or column
+*
+* @param    marks       bitmask of marked cells
+* @retval   1           board has won
+* @retval   0           board has not won
+*/
+int Bitboard_complete(uint32_t marks)
+{
+    int complete = 0;
+    int line;
+    for (line = 0; line < 2 * SET_SIZE; line++) {
+        complete |= ((marks & LINE_MASKS[line]) == LINE_MASKS[line]);
+    }
+    return complete;
+}
+
+/*
+* Play the game on bitboards. Every board is a 25 bit mask of marked cells,
+* and a posting list maps each number's id to the (board, cell) pairs it
+* is on, so calling a number only touches the boards that have it. A call
+* can only complete lines on the boards it touches, so only those are
+* checked.
+*
+* @param    bingo       the game
+* @param    first       first board to win (output)
+* @param    last        last board to win (output)
+* @retval   0           success
+* @retval   -1          out of memory
+*/
+int find_winners_bitboard(struct Bingo *bingo, struct Winner *first,
+        struct Winner *last)
+{
+    int num_cells = bingo->num_boards * BOARD_CELLS;
+    int num_ids = bingo->num_ids;
+    int i, b;
+    first->board = last->board = -1;
+    if (bingo->num_boards == 0 || num_ids == 0)
+        return 0;
+
+    // posting lists in compressed form: entries for id n are
+    // postings[starts[n]] .. postings[starts[n + 1] - 1], in board order.
+    // Cells that are never called have no postings.
+    int *starts = calloc(num_ids + 1, sizeof(int));
+    int *fill = malloc(num_ids * sizeof(int));
+    int *postings = malloc(num_cells * sizeof(int));
+    uint32_t *marks = calloc(bingo->num_boards, sizeof(uint32_t));
+    if (starts == NULL || fill == NULL || postings == NULL || marks == NULL) {
+        free(starts);
+        free(fill);
+        free(postings);
+        free(marks);
+        return -1;
+    }
+    for (i = 0; i < num_cells; i++) {
+        if (bingo->cell_ids[i] < num_ids)
+            starts[bingo->cell_ids[i] + 1]++;
+    }
+    for (i = 0; i < num_ids; i++) {
+        starts[i + 1] += starts[i];
+    }
+    memcpy(fill, starts, num_ids * sizeof(int));
+    for (i = 0; i < num_cells; i++) {
+        if (bingo->cell_ids[i] < num_ids)
+            postings[fill[bingo->cell_ids[i]]++] = i;
+    }
+    free(fill);
+
+    int num_won = 0;
+    int turn;
+    for (turn = 1; turn <= bingo->num_calls && num_won < bingo->num_boards; turn++) {
+        int id = bingo->call_ids[turn - 1];
+        int p;
+        for (p = starts[id]; p < starts[id + 1]; p++) {
+            b = postings[p] / BOARD_CELLS;
+            uint32_t before = marks[b];
+            marks[b] |= 1u << (postings[p] % BOARD_CELLS);
+            // skip boards that had already won
+            if (Bitboard_complete(before) || !Bitboard_complete(marks[b]))
+                continue;
+            num_won++;
+            last->board = b;
+            last->turn = turn;
+            last->uncalled = 0;
+            for (i = 0; i < BOARD_CELLS; i++) {
+                if (!(marks[b] & (1u << i)))
+                    last->uncalled += bingo->cells[b * BOARD_CELLS + i];
             }
+            if (first->board < 0)
+                *first = *last;
         }
+    }
+
+    free(starts);
+    free(postings);
+    free(marks);
+    return 0;
+}
+
+/*
+* Print the score for a winning board
+*
+* @param    w           the winner
+* @param    bingo       the game
+* @retval   result      winning call times the sum of uncalled numbers
+*/
+long score(struct Winner *w, struct Bingo *bingo)
+{
+    printf("Board number %d complete on turn %d!\n", w->board, w->turn);
+    printf("Sum of uncalled: %ld\n", w->uncalled);
+    printf("Last call: %d\n", bingo->calls[w->turn - 1]);
+    long result = bingo->calls[w->turn - 1] * w->uncalled;
+    printf("Result: %ld\n", result);
+
+    return result;
+}
 
-        turn++;
-        if ((turn == num_calls) && (num_winners == 0)) {
-            printf("no winner!\n");
+/*
+* Play a game with every engine and compare the winners with the
+* reference. Used by fuzz.c.
+*
+* @param    input       the game, zero terminated
+* @param    size        size of the input
+* @param    pool        thread pool for the parallel engine
+* @param    report      what differed (output)
+* @retval   mismatch    0 if every engine agrees, 1 if not
+*/
+int day4_check_engines(const char *input, size_t size, struct ThreadPool *pool,
+        char report[ANSWER_LEN])
+{
+    const char *names[] = { "indexed", "parallel", "bitboard" };
+    struct Bingo *bingo = parse_bingo(input, size);
+    if (bingo == NULL)
+        return 0; // nothing to play
+    struct Winner first[4], last[4];
+    int failed = find_winners_reference(bingo, &first[0], &last[0]) < 0;
+    failed |= find_winners_indexed(bingo, &first[1], &last[1]) < 0;
+    failed |= find_winners_parallel(bingo, &first[2], &last[2], pool) < 0;
+    failed |= find_winners_bitboard(bingo, &first[3], &last[3]) < 0;
+    Bingo_destroy(bingo);
+    if (failed)
+        return 0; // out of memory, nothing to compare
+
+    for (int e = 1; e < 4; e++) {
+        struct Winner *w[2] = { &first[e], &last[e] };
+        struct Winner *ref[2] = { &first[0], &last[0] };
+        for (int i = 0; i < 2; i++) {
+            // the turn and score only mean something if there is a winner
+            if (w[i]->board == ref[i]->board && (ref[i]->board < 0
+                    || (w[i]->turn == ref[i]->turn && w[i]->uncalled == ref[i]->uncalled)))
+                continue;
+            snprintf(report, ANSWER_LEN, "%s %s winner: board %d turn %d uncalled %ld, "
+                    "reference: board %d turn %d uncalled %ld", names[e - 1],
+                    i ? "last" : "first", w[i]->board, w[i]->turn, w[i]->uncalled,
+                    ref[i]->board, ref[i]->turn, ref[i]->uncalled);
+            return 1;
         }
     }
+    return 0;
+}
+
+/* Both winners come out of one game, so part 1 plays it and part 2
+   only scores the last winner. */
+struct BingoPuzzle {
+    struct Bingo *bingo;
+    struct Winner first, last;
+};
+
+void *day4_parse(const char *input, size_t size)
+{
+    struct BingoPuzzle *puzzle = malloc(sizeof(struct BingoPuzzle));
+    assert(puzzle != NULL);
+    puzzle->bingo = parse_bingo(input, size);
+    if (puzzle->bingo == NULL) {
+        free(puzzle);
+        return NULL;
+    }
+    return puzzle;
+}
+
+void day4_part1(void *p, char answer[ANSWER_LEN])
+{
+    struct BingoPuzzle *puzzle = p;
+    struct Bingo *bingo = puzzle->bingo;
+    // out of memory leaves no winner, and no answer
+    find_winners_bitboard(bingo, &puzzle->first, &puzzle->last);
+    if (puzzle->first.board >= 0)
+        snprintf(answer, ANSWER_LEN, "%ld",
+                bingo->calls[puzzle->first.turn - 1] * puzzle->first.uncalled);
+}
+
+void day4_part2(void *p, char answer[ANSWER_LEN])
+{
+    struct BingoPuzzle *puzzle = p;
+    struct Bingo *bingo = puzzle->bingo;
+    if (puzzle->first.board >= 0)
+        snprintf(answer, ANSWER_LEN, "%ld",
+                bingo->calls[puzzle->last.turn - 1] * puzzle->last.uncalled);
+}
+
+void day4_free(void *p)
+{
+    struct BingoPuzzle *puzzle = p;
+    Bingo_destroy(puzzle->bingo);
+    free(puzzle);
+}
+
+const struct Solver day4_solver = {
+    "4", day4_parse, day4_part1, day4_part2, day4_free, 1
+};
+
+#ifndef AOC_DRIVER
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day4_solver, argc - 1, argv + 1);
+
+    // usage: 4 [datafile] [bitboard|indexed|parallel|reference]
+    char *datafile = (argc > 1) ? argv[1] : "data/4data";
+    struct Bingo *bingo = read_data(datafile);
+    //run_tests();
+
+    int (*engine)(struct Bingo *, struct Winner *, struct Winner *) = find_winners_bitboard;
+    if (argc > 2 && !strcmp(argv[2], "indexed"))
+        engine = find_winners_indexed;
+    else if (argc > 2 && !strcmp(argv[2], "reference"))
+        engine = find_winners_reference;
+
+    struct Winner first, last;
+    int status;
+    if (argc > 2 && !strcmp(argv[2], "parallel")) {
+        struct ThreadPool *pool = ThreadPool_create(0);
+        status = find_winners_parallel(bingo, &first, &last, pool);
+        ThreadPool_destroy(pool);
+    } else {
+        status = engine(bingo, &first, &last);
+    }
+    if (status < 0) {
+        printf("Error: Out of memory playing %d boards.\n", bingo->num_boards);
+        exit(-1);
+    }
+    if (first.board < 0) {
+        printf("no winner!\n");
+    } else {
+        score(&first, bingo);
+        score(&last, bingo);
+    }
 
+    Bingo_destroy(bingo);
     return 0;
 }
+#endif
@@ -12,11 +12,70 @@
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <stdint.h>
+#include "util.h"
+#include "bench.h"
 
-#define LINE_LEN 20
-#define MAX_LINES 1000
 #define NUM_COORDS 4
-#define GRID_SIZE 1000
+
+/* Every line we count is horizontal, vertical or at 45 degrees, so each
+   belongs to one of four families of parallel lines. Within a family a
+   line is identified by a key that is constant along it (y for horizontal,
+   x for vertical, x - y and x + y for the diagonals) and cells along it
+   are numbered by a parameter t (x, or y for vertical lines). */
+enum Family { HORIZ, VERT, DIAG, ANTI_DIAG, NUM_FAMILIES };
+
+// key = KEY_COEFFS[f][0] * x + KEY_COEFFS[f][1] * y
+const int KEY_COEFFS[NUM_FAMILIES][2] = { { 0, 1 }, { 1, 0 }, { 1, -1 }, { 1, 1 } };
+
+/* Cells key, start <= t <= end of one family */
+struct Segment {
+    long key;
+    long start, end;
+};
+
+struct SegmentList {
+    int num_segments;
+    int capacity;
+    struct Segment *segments;
+};
+
+/* Events for sweeping along a line (depth changes) or across
+   two families (insert, query, remove) */
+struct Event {
+    long key;
+    long pos;
+    int type;
+    int index;
+};
+
+struct Cell {
+    long x, y;
+};
+
+#define TILE_BITS 6
+#define TILE_SIZE (1 << TILE_BITS)  // tiles are 64 x 64 cells
+
+/* A tile holds a 2 bit saturating counter (0, 1, 2 or more) per cell,
+   split into two bitplanes with one 64 bit word per row: `once` has a bit
+   set for cells covered at least once, `twice` for cells covered at least
+   twice. That is 1 KB per 4096 cells, against 16 KB for a dense int grid. */
+struct Tile {
+    int64_t key;
+    uint64_t once[TILE_SIZE];
+    uint64_t twice[TILE_SIZE];
+};
+
+/* Only tiles that a line touches are allocated. They live in one array
+   and an open addressing hash table maps tile coordinates to an index. */
+struct TileGrid {
+    int num_tiles;
+    int tile_capacity;
+    struct Tile *tiles;
+    int table_size;     // power of two
+    int *table;         // tile index + 1, 0 for empty
+};
 
 struct Point {
     int x, y;
@@ -29,56 +88,53 @@ struct Line {
     int dy;
 };
 
-struct Point *Point_create(int x, int y)
-{
-    struct Point *pt = malloc(sizeof(struct Point));
-    pt->x = x;
-    pt->y = y;
-
-    return pt;
-}
-
-int is_horiz(struct Line *ln);
-int is_vert(struct Line *ln);
+/* All lines of an input, stored as flat coordinate arrays so that
+   parsing does one allocation per array rather than one per line,
+   and lines can be split between threads by index range. The set and
+   its arrays come from one arena, so freeing it is a single call. */
+struct LineSet {
+    struct Arena *arena;
+    int num_lines;
+    int *x1, *y1;
+    int *x2, *y2;
+};
 
-struct Line *Line_create(struct Point p1, struct Point p2)
+struct Line Line_create(struct Point p1, struct Point p2)
 {
-    struct Line *ln = malloc(sizeof(struct Line));
+    struct Line ln;
 
     // by convention, p1 is always start, p2 end
-    ln->p1 = p1;
-    ln->p2 = p2;
-    ln->dx = p2.x - p1.x;
-    ln->dy = p2.y - p1.y;
+    ln.p1 = p1;
+    ln.p2 = p2;
+    ln.dx = p2.x - p1.x;
+    ln.dy = p2.y - p1.y;
 
     return ln;
 }
 
-void Line_print(struct Line *ln)
+/*
+* Get a line from a line set
+*
+* @param    set     the line set
+* @param    l       index of the line
+* @retval   ln      the line
+*/
+struct Line LineSet_line(struct LineSet *set, int l)
 {
-    printf("Line from [%d, %d] to [%d, %d]\n", ln->p1.x, ln->p1.y,
-            ln->p2.x, ln->p2.y);
+    struct Point p1 = { set->x1[l], set->y1[l] };
+    struct Point p2 = { set->x2[l], set->y2[l] };
+    return Line_create(p1, p2);
 }
 
-void print_array(int array[], int num_elements) {
-    int i;
-    printf("[ ");
-    for (i = 0; i < num_elements; i++) {
-        printf("%d ", array[i]);
-    }
-    printf("]\n");
+void LineSet_destroy(struct LineSet *set)
+{
+    Arena_destroy(set->arena);
 }
 
-void split_str(char str[], int coords[], char delims[])
+void Line_print(struct Line *ln)
 {
-    int i;
-    char *ptr = strtok(str, delims);
-    for (i = 0; i < NUM_COORDS; i++) {
-        assert(ptr != NULL);
-        coords[i] = atoi(ptr);
-        ptr = strtok(NULL, delims);
-    }
-    // print_array(coords, NUM_COORDS);
+    printf("Line from [%d, %d] to [%d, %d]\n", ln->p1.x, ln->p1.y,
+            ln->p2.x, ln->p2.y);
 }
 
 int is_horiz(struct Line *ln)
@@ -97,34 +153,62 @@ int is_diag(struct Line *ln)
 }
 
 
-int read_data(char datafile[], struct Line lines[])
+/*
+* Parse lines of "x1,y1 -> x2,y2"
+*
+* @param    input           the input, zero terminated
+* @param    file_size       size of the input
+* @retval   set             the lines
+* @retval   NULL            a coordinate is negative or out of range, or the
+*                           coordinates don't make whole lines
+*/
+struct LineSet *parse_lines(const char *input, size_t file_size)
 {
-    FILE *data = fopen(datafile, "r");
-    assert(data != NULL);
-
-    char buffer[LINE_LEN];
-    int num_lines = 0;
-    int coords[NUM_COORDS];
+    // "x1,y1 -> x2,y2" is four numbers per line
+    int *coords = NULL;
+    int num_coords = 0, capacity = 0;
+    int ok = parse_ints(input, file_size, &coords, &num_coords, &capacity) >= 0
+        && num_coords % NUM_COORDS == 0;
+    for (int i = 0; ok && i < num_coords; i++)
+        ok = coords[i] >= 0;
+    if (!ok) {
+        free(coords);
+        return NULL;
+    }
 
-    struct Point p1, p2;
-    while(fgets(buffer, sizeof(buffer), data) != NULL) {
-        split_str(buffer, coords, " ->,");
-        p1 = *Point_create(coords[0], coords[1]);
-        p2 = *Point_create(coords[2], coords[3]);
-        lines[num_lines] = *Line_create(p1, p2);
-        /*if (is_vert(&lines[num_lines])) {*/
-            /*printf("Vertical ");*/
-            /*Line_print(&lines[num_lines]);*/
-        /*}*/
-        /*if (is_horiz(&lines[num_lines])) {*/
-            /*printf("Horizontal ");*/
-            /*Line_print(&lines[num_lines]);*/
-        /*}*/
-        num_lines++;
+    struct Arena *arena = Arena_create(0);
+    struct LineSet *set = Arena_calloc(arena, 1, sizeof(struct LineSet));
+    set->arena = arena;
+    set->num_lines = num_coords / NUM_COORDS;
+    // cache line aligned, since threads split the arrays by index range
+    size_t bytes = set->num_lines * sizeof(int);
+    set->x1 = Arena_alloc_aligned(arena, bytes, 64);
+    set->y1 = Arena_alloc_aligned(arena, bytes, 64);
+    set->x2 = Arena_alloc_aligned(arena, bytes, 64);
+    set->y2 = Arena_alloc_aligned(arena, bytes, 64);
+    int i;
+    for (i = 0; i < set->num_lines; i++) {
+        set->x1[i] = coords[i * NUM_COORDS];
+        set->y1[i] = coords[i * NUM_COORDS + 1];
+        set->x2[i] = coords[i * NUM_COORDS + 2];
+        set->y2[i] = coords[i * NUM_COORDS + 3];
     }
 
-    fclose(data);
-    return num_lines;
+    free(coords);
+    return set;
+}
+
+struct LineSet *read_lines(char datafile[])
+{
+    size_t file_size;
+    char *input = read_file(datafile, &file_size);
+    struct LineSet *set = parse_lines(input, file_size);
+    free(input);
+    if (set == NULL) {
+        printf("Error: Lines must be \"x1,y1 -> x2,y2\", from 0 to %d.\n", INT_MAX);
+        exit(-1);
+    }
+    return set;
 }
 
 int Line_len(struct Line *ln)
@@ -143,57 +227,724 @@ int Line_len(struct Line *ln)
     return abs(len);
 }
 
-int main(int argc, char *argv[])
+/*
+* Count cells covered by two or more lines by rasterizing every line into a
+* dense grid. Memory scales with the coordinate range; kept as a reference.
+*
+* @param    set                 lines to rasterize
+* @param    include_diagonals   whether to count 45 degree lines
+* @retval   score               number of cells covered more than once
+*/
+int count_overlaps_raster(struct LineSet *set, int include_diagonals)
 {
-    // struct Line lines[50];
-    // run_tests();
-    struct Line lines[MAX_LINES];
-    int num_lines = read_data("data/5data", lines);
-    int grid[GRID_SIZE][GRID_SIZE];
-    memset(grid, 0, GRID_SIZE * GRID_SIZE * sizeof(int));
-
     int l, s, dy, dx;
     int len = 0;
-    for (l = 0; l < num_lines; l++) {
-        if (!is_horiz(&lines[l]) && !is_vert(&lines[l])
-                && !is_diag(&lines[l])) 
+    int width = 0, height = 0;
+    for (l = 0; l < set->num_lines; l++) {
+        if (set->x1[l] >= width) width = set->x1[l] + 1;
+        if (set->x2[l] >= width) width = set->x2[l] + 1;
+        if (set->y1[l] >= height) height = set->y1[l] + 1;
+        if (set->y2[l] >= height) height = set->y2[l] + 1;
+    }
+    int *grid = calloc((size_t)width * height, sizeof(int));
+    assert(grid != NULL);
+
+    for (l = 0; l < set->num_lines; l++) {
+        struct Line ln = LineSet_line(set, l);
+        if (!is_horiz(&ln) && !is_vert(&ln)
+                && !(include_diagonals && is_diag(&ln)))
             continue;
-        len = Line_len(&lines[l]);
-        dx = lines[l].dx / len;
-        dy = lines[l].dy / len;
+        len = Line_len(&ln);
+        dx = (len) ? ln.dx / len : 0;
+        dy = (len) ? ln.dy / len : 0;
         for (s = 0; s <= len; s++) {
-            grid[lines[l].p1.x + s * dx][lines[l].p1.y + s * dy] += 1;
+            grid[(size_t)(ln.p1.y + s * dy) * width + ln.p1.x + s * dx] += 1;
         }
-        // Line_print(&lines[l]);
     }
-    int x = 0;
-    int y = 0;
     int score = 0;
-    for (y = 0; y < GRID_SIZE; y++) {
-        for (x = 0; x < GRID_SIZE; x++) {
-            if (grid[x][y] > 1)
-                score++;
-            if (grid[x][y] == 0) {
-        //        printf(".");
-            } else {
-        //        printf("%d", grid[x][y]);
+    for (size_t cell = 0; cell < (size_t)width * height; cell++) {
+        if (grid[cell] > 1)
+            score++;
+    }
+    free(grid);
+    return score;
+}
+
+long Family_key(int family, long x, long y)
+{
+    return KEY_COEFFS[family][0] * x + KEY_COEFFS[family][1] * y;
+}
+
+long Family_param(int family, long x, long y)
+{
+    return (family == VERT) ? y : x;
+}
+
+/*
+* Find the cell for a given key and parameter of a family
+*/
+struct Cell Family_cell(int family, long key, long t)
+{
+    struct Cell cell;
+    switch (family) {
+        case HORIZ:     cell.x = t;     cell.y = key;       break;
+        case VERT:      cell.x = key;   cell.y = t;         break;
+        case DIAG:      cell.x = t;     cell.y = t - key;   break;
+        default:        cell.x = t;     cell.y = key - t;   break;
+    }
+    return cell;
+}
+
+/*
+* Determine the family of a line
+*
+* @retval   family      family of the line
+* @retval   -1          line is not horizontal, vertical or 45 degrees
+*/
+int Line_family(struct Line *ln)
+{
+    if (is_horiz(ln))
+        return HORIZ;
+    if (is_vert(ln))
+        return VERT;
+    if (ln->dx == ln->dy)
+        return DIAG;
+    if (ln->dx == -ln->dy)
+        return ANTI_DIAG;
+    return -1;
+}
+
+void SegmentList_push(struct SegmentList *list, long key, long start, long end)
+{
+    if (list->num_segments == list->capacity) {
+        list->capacity = (list->capacity) ? list->capacity * 2 : 64;
+        list->segments = realloc(list->segments, list->capacity * sizeof(struct Segment));
+        assert(list->segments != NULL);
+    }
+    struct Segment *seg = &list->segments[list->num_segments++];
+    seg->key = key;
+    seg->start = start;
+    seg->end = end;
+}
+
+int compare_events(const void *a, const void *b)
+{
+    const struct Event *ea = a, *eb = b;
+    if (ea->key != eb->key)
+        return (ea->key > eb->key) - (ea->key < eb->key);
+    if (ea->pos != eb->pos)
+        return (ea->pos > eb->pos) - (ea->pos < eb->pos);
+    return ea->type - eb->type;
+}
+
+int compare_cells(const void *a, const void *b)
+{
+    const struct Cell *ca = a, *cb = b;
+    if (ca->x != cb->x)
+        return (ca->x > cb->x) - (ca->x < cb->x);
+    return (ca->y > cb->y) - (ca->y < cb->y);
+}
+
+/*
+* Sweep along each line of a family, merging the segments on it into
+* the cells covered at least once (union) and at least twice (overlap).
+* Both outputs come out sorted by key, then start.
+*
+* @param    segs        segments of one family
+* @param    p_union     segments covered at least once (output)
+* @param    p_overlap   segments covered at least twice (output)
+* @retval   cells       number of cells covered at least twice
+*/
+long Family_merge(struct SegmentList *segs, struct SegmentList *p_union,
+        struct SegmentList *p_overlap)
+{
+    int num_events = 2 * segs->num_segments;
+    struct Event *events = malloc((num_events + 1) * sizeof(struct Event));
+    assert(events != NULL);
+    for (int s = 0; s < segs->num_segments; s++) {
+        struct Segment *seg = &segs->segments[s];
+        events[2*s] = (struct Event){ seg->key, seg->start, 1, 0 };
+        events[2*s + 1] = (struct Event){ seg->key, seg->end + 1, -1, 0 };
+    }
+    qsort(events, num_events, sizeof(struct Event), compare_events);
+
+    long cells = 0;
+    long union_start = 0, overlap_start = 0;
+    int depth = 0;
+    int e = 0;
+    while (e < num_events) {
+        // apply every depth change at this position before looking at depth
+        long key = events[e].key, pos = events[e].pos;
+        int prev_depth = depth;
+        for (; e < num_events && events[e].key == key && events[e].pos == pos; e++) {
+            depth += events[e].type;
+        }
+        if (prev_depth == 0 && depth > 0)
+            union_start = pos;
+        if (prev_depth > 0 && depth == 0)
+            SegmentList_push(p_union, key, union_start, pos - 1);
+        if (prev_depth < 2 && depth >= 2)
+            overlap_start = pos;
+        if (prev_depth >= 2 && depth < 2) {
+            SegmentList_push(p_overlap, key, overlap_start, pos - 1);
+            cells += pos - overlap_start;
+        }
+    }
+    free(events);
+    return cells;
+}
+
+/*
+* Determine whether a cell lies inside one of a family's segments
+*
+* @param    segs        segments of the family, sorted by key, then start
+*/
+int SegmentList_contains(struct SegmentList *segs, int family, struct Cell cell)
+{
+    long key = Family_key(family, cell.x, cell.y);
+    long t = Family_param(family, cell.x, cell.y);
+    // binary search for the last segment starting at or before (key, t)
+    int lo = 0, hi = segs->num_segments - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        struct Segment *seg = &segs->segments[mid];
+        if (seg->key < key || (seg->key == key && seg->start <= t)) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return (found >= 0 && segs->segments[found].key == key
+            && segs->segments[found].end >= t);
+}
+
+/*
+* Find every cell where a line of family f1 crosses a line of family f2.
+* In the plane of (f1 key, f2 key), lines of f1 run along the f2 key axis
+* and lines of f2 run along the f1 key axis, so this is the classic
+* orthogonal segment intersection: sweep over the f2 key, keeping the
+* f1 lines that span it in a bitset over f1 keys, and report every set
+* bit in the f1 key range of each f2 line. Cost is O((n + k) log n) for
+* n lines and k crossings, plus a word scan of the bitset per query.
+*
+* @param    u1, f1      union segments of the first family
+* @param    u2, f2      union segments of the second family
+* @param    p_cells     pointer to growable array of crossings (output)
+* @param    p_num_cells number of crossings
+* @param    p_capacity  capacity of the crossings array
+*/
+void Family_cross(struct SegmentList *u1, int f1, struct SegmentList *u2, int f2,
+        struct Cell **p_cells, long *p_num_cells, long *p_capacity)
+{
+    enum { INSERT, QUERY, REMOVE };
+    if (u1->num_segments == 0 || u2->num_segments == 0)
+        return;
+
+    // ranks of the distinct f1 keys (u1 is sorted by key)
+    long *keys = malloc(u1->num_segments * sizeof(long));
+    int *ranks = malloc(u1->num_segments * sizeof(int));
+    int num_keys = 0;
+    for (int s = 0; s < u1->num_segments; s++) {
+        if (num_keys == 0 || keys[num_keys - 1] != u1->segments[s].key)
+            keys[num_keys++] = u1->segments[s].key;
+        ranks[s] = num_keys - 1;
+    }
+    int num_words = (num_keys + 63) / 64;
+    unsigned long *active = calloc(num_words, sizeof(unsigned long));
+
+    int num_events = 2 * u1->num_segments + u2->num_segments;
+    struct Event *events = malloc(num_events * sizeof(struct Event));
+    int e = 0;
+    for (int s = 0; s < u1->num_segments; s++) {
+        struct Segment *seg = &u1->segments[s];
+        struct Cell a = Family_cell(f1, seg->key, seg->start);
+        struct Cell b = Family_cell(f1, seg->key, seg->end);
+        long ka = Family_key(f2, a.x, a.y), kb = Family_key(f2, b.x, b.y);
+        events[e++] = (struct Event){ 0, (ka < kb) ? ka : kb, INSERT, s };
+        events[e++] = (struct Event){ 0, (ka < kb) ? kb : ka, REMOVE, s };
+    }
+    for (int s = 0; s < u2->num_segments; s++) {
+        events[e++] = (struct Event){ 0, u2->segments[s].key, QUERY, s };
+    }
+    qsort(events, num_events, sizeof(struct Event), compare_events);
+
+    int det = KEY_COEFFS[f1][0] * KEY_COEFFS[f2][1] - KEY_COEFFS[f1][1] * KEY_COEFFS[f2][0];
+    for (e = 0; e < num_events; e++) {
+        struct Event *ev = &events[e];
+        if (ev->type == INSERT) {
+            active[ranks[ev->index] / 64] |= 1UL << (ranks[ev->index] % 64);
+            continue;
+        } else if (ev->type == REMOVE) {
+            active[ranks[ev->index] / 64] &= ~(1UL << (ranks[ev->index] % 64));
+            continue;
+        }
+        struct Segment *seg = &u2->segments[ev->index];
+        struct Cell a = Family_cell(f2, seg->key, seg->start);
+        struct Cell b = Family_cell(f2, seg->key, seg->end);
+        long ka = Family_key(f1, a.x, a.y), kb = Family_key(f1, b.x, b.y);
+        long lo = (ka < kb) ? ka : kb, hi = (ka < kb) ? kb : ka;
+
+        // first rank with key >= lo
+        int first = 0, last = num_keys;
+        while (first < last) {
+            int mid = (first + last) / 2;
+            if (keys[mid] < lo) first = mid + 1; else last = mid;
+        }
+        for (int r = first; r < num_keys && keys[r] <= hi; ) {
+            unsigned long word = active[r / 64] >> (r % 64);
+            if (word == 0) {
+                r = (r / 64 + 1) * 64;
+                continue;
+            }
+            r += __builtin_ctzl(word);
+            if (r >= num_keys || keys[r] > hi)
+                break;
+            // solve key_f1(x, y) = keys[r], key_f2(x, y) = seg->key
+            long c1 = keys[r], c2 = seg->key;
+            long x_num = c1 * KEY_COEFFS[f2][1] - KEY_COEFFS[f1][1] * c2;
+            long y_num = KEY_COEFFS[f1][0] * c2 - c1 * KEY_COEFFS[f2][0];
+            // diagonals only cross on a cell if their keys have the same parity
+            if (x_num % det == 0 && y_num % det == 0) {
+                if (*p_num_cells == *p_capacity) {
+                    *p_capacity = (*p_capacity) ? *p_capacity * 2 : 1024;
+                    *p_cells = realloc(*p_cells, *p_capacity * sizeof(struct Cell));
+                    assert(*p_cells != NULL);
+                }
+                (*p_cells)[(*p_num_cells)++] = (struct Cell){ x_num / det, y_num / det };
             }
+            r++;
         }
-        //printf("\n");
     }
-    printf("Final score: %d\n", score);
-    // print_grid(&grid);
-    // printf("%d %d %d\n", grid[7][2], grid[7][3], grid[7][4]);
-    /*Line_print(&lines[4]);*/
-    /*printf("Length: %d\n", Line_len(&lines[4]));*/
-    return 0;
+
+    free(events);
+    free(active);
+    free(ranks);
+    free(keys);
 }
 
-void run_tests() {
-    char test_str[] = "7, 0 -> 7, 4";
-    int coords[NUM_COORDS];
-    split_str(test_str, coords, " ->,");
-    printf("%d\n", coords[0]);
-    printf("%d\n", coords[3]);
+/*
+* Count cells covered by two or more lines directly from line geometry.
+* A cell is covered twice either by overlapping lines of the same family,
+* or by lines of two different families crossing it. Cost scales with the
+* number of lines and crossings, not with the coordinate range.
+*
+* @param    set                 lines to count
+* @param    include_diagonals   whether to count 45 degree lines
+* @retval   score               number of cells covered more than once
+*/
+long count_overlaps(struct LineSet *set, int include_diagonals)
+{
+    struct SegmentList segs[NUM_FAMILIES] = { 0 };
+    struct SegmentList unions[NUM_FAMILIES] = { 0 };
+    struct SegmentList overlaps[NUM_FAMILIES] = { 0 };
+    int num_families = (include_diagonals) ? NUM_FAMILIES : DIAG;
+
+    for (int l = 0; l < set->num_lines; l++) {
+        struct Line ln = LineSet_line(set, l);
+        int f = Line_family(&ln);
+        if (f < 0 || f >= num_families)
+            continue;
+        long key = Family_key(f, ln.p1.x, ln.p1.y);
+        long t1 = Family_param(f, ln.p1.x, ln.p1.y);
+        long t2 = Family_param(f, ln.p2.x, ln.p2.y);
+        SegmentList_push(&segs[f], key, (t1 < t2) ? t1 : t2, (t1 < t2) ? t2 : t1);
+    }
+
+    long score = 0;
+    for (int f = 0; f < num_families; f++) {
+        score += Family_merge(&segs[f], &unions[f], &overlaps[f]);
+    }
+
+    struct Cell *crossings = NULL;
+    long num_crossings = 0, capacity = 0;
+    for (int f1 = 0; f1 < num_families; f1++) {
+        for (int f2 = f1 + 1; f2 < num_families; f2++) {
+            Family_cross(&unions[f1], f1, &unions[f2], f2,
+                    &crossings, &num_crossings, &capacity);
+        }
+    }
+
+    // each crossing cell should count exactly once, but the family overlaps
+    // have already counted it once for every family it overlaps in
+    qsort(crossings, num_crossings, sizeof(struct Cell), compare_cells);
+    for (long c = 0; c < num_crossings; c++) {
+        if (c > 0 && !compare_cells(&crossings[c], &crossings[c-1]))
+            continue;
+        int counted = 0;
+        for (int f = 0; f < num_families; f++) {
+            counted += SegmentList_contains(&overlaps[f], f, crossings[c]);
+        }
+        score += 1 - counted;
+    }
+
+    free(crossings);
+    for (int f = 0; f < NUM_FAMILIES; f++) {
+        free(segs[f].segments);
+        free(unions[f].segments);
+        free(overlaps[f].segments);
+    }
+    return score;
+}
+
+struct TileGrid *TileGrid_create()
+{
+    struct TileGrid *grid = malloc(sizeof(struct TileGrid));
+    assert(grid != NULL);
+    grid->num_tiles = 0;
+    grid->tile_capacity = 64;
+    grid->tiles = malloc(grid->tile_capacity * sizeof(struct Tile));
+    grid->table_size = 128;
+    grid->table = calloc(grid->table_size, sizeof(int));
+    assert(grid->tiles != NULL && grid->table != NULL);
+    return grid;
+}
+
+void TileGrid_destroy(struct TileGrid *grid)
+{
+    free(grid->tiles);
+    free(grid->table);
+    free(grid);
+}
+
+int64_t tile_key(long tile_x, long tile_y)
+{
+    return (int64_t)((uint64_t)(uint32_t)tile_y << 32 | (uint32_t)tile_x);
+}
+
+unsigned tile_hash(int64_t key, int table_size)
+{
+    return (unsigned)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> 32) & (table_size - 1);
+}
+
+/*
+* Insert a tile index into the hash table. The key must not be present.
+*/
+void TileGrid_insert(struct TileGrid *grid, int64_t key, int index)
+{
+    unsigned slot = tile_hash(key, grid->table_size);
+    while (grid->table[slot] != 0) {
+        slot = (slot + 1) & (grid->table_size - 1);
+    }
+    grid->table[slot] = index + 1;
+}
+
+/*
+* Find a tile, allocating it if not yet touched
+*
+* @param    grid            the tile grid
+* @param    key             tile key, from tile coordinates (cell coordinates / TILE_SIZE)
+* @retval   index           index of the tile in grid->tiles
+*/
+int TileGrid_tile(struct TileGrid *grid, int64_t key)
+{
+    unsigned slot = tile_hash(key, grid->table_size);
+    while (grid->table[slot] != 0) {
+        int index = grid->table[slot] - 1;
+        if (grid->tiles[index].key == key)
+            return index;
+        slot = (slot + 1) & (grid->table_size - 1);
+    }
+
+    if (grid->num_tiles == grid->tile_capacity) {
+        grid->tile_capacity *= 2;
+        grid->tiles = realloc(grid->tiles, grid->tile_capacity * sizeof(struct Tile));
+        assert(grid->tiles != NULL);
+    }
+    int index = grid->num_tiles++;
+    struct Tile *tile = &grid->tiles[index];
+    memset(tile, 0, sizeof(struct Tile));
+    tile->key = key;
+
+    // keep the table at most half full
+    if (2 * grid->num_tiles > grid->table_size) {
+        free(grid->table);
+        grid->table_size *= 2;
+        grid->table = calloc(grid->table_size, sizeof(int));
+        assert(grid->table != NULL);
+        for (int t = 0; t < grid->num_tiles; t++) {
+            TileGrid_insert(grid, grid->tiles[t].key, t);
+        }
+    } else {
+        grid->table[slot] = index + 1;
+    }
+    return index;
+}
+
+/*
+* Add one to the counters of a run of cells in one tile row.
+* Cells already covered once saturate at "two or more".
+*/
+void Tile_mark(struct Tile *tile, int row, uint64_t mask)
+{
+    tile->twice[row] |= tile->once[row] & mask;
+    tile->once[row] |= mask;
+}
+
+/*
+* Merge the counters of one tile into another with saturating adds
+*
+* @param    into        tile to add to
+* @param    from        tile to add
+*/
+void Tile_merge(struct Tile *into, struct Tile *from)
+{
+    for (int row = 0; row < TILE_SIZE; row++) {
+        into->twice[row] |= from->twice[row] | (into->once[row] & from->once[row]);
+        into->once[row] |= from->once[row];
+    }
+}
+
+/*
+* Rasterize a line into the tile grid. Horizontal lines are marked a
+* tile row at a time, others a cell at a time.
+*/
+void TileGrid_rasterize(struct TileGrid *grid, struct Line *ln)
+{
+    int len = Line_len(ln);
+    int dx = (len) ? ln->dx / len : 0;
+    int dy = (len) ? ln->dy / len : 0;
+
+    if (dy == 0) {
+        long y = ln->p1.y;
+        long x = (dx < 0) ? ln->p2.x : ln->p1.x;
+        long x_end = x + len;
+        while (x <= x_end) {
+            long tile_end = (x | (TILE_SIZE - 1));
+            long run_end = (tile_end < x_end) ? tile_end : x_end;
+            int first = x & (TILE_SIZE - 1), last = run_end & (TILE_SIZE - 1);
+            uint64_t mask = (~0ULL >> (TILE_SIZE - 1 - last)) & (~0ULL << first);
+            int index = TileGrid_tile(grid, tile_key(x >> TILE_BITS, y >> TILE_BITS));
+            Tile_mark(&grid->tiles[index], y & (TILE_SIZE - 1), mask);
+            x = run_end + 1;
+        }
+        return;
+    }
+
+    long x = ln->p1.x, y = ln->p1.y;
+    long tile_x = x >> TILE_BITS, tile_y = y >> TILE_BITS;
+    int index = TileGrid_tile(grid, tile_key(tile_x, tile_y));
+    for (int s = 0; s <= len; s++, x += dx, y += dy) {
+        // only go back to the hash table when we cross into another tile
+        if ((x >> TILE_BITS) != tile_x || (y >> TILE_BITS) != tile_y) {
+            tile_x = x >> TILE_BITS;
+            tile_y = y >> TILE_BITS;
+            index = TileGrid_tile(grid, tile_key(tile_x, tile_y));
+        }
+        Tile_mark(&grid->tiles[index], y & (TILE_SIZE - 1), 1ULL << (x & (TILE_SIZE - 1)));
+    }
+}
+
+/*
+* Count cells covered more than once: a popcount over the "twice" bitplane
+* of every tile, which the compiler can vectorize.
+*/
+long TileGrid_count_overlaps(struct TileGrid *grid)
+{
+    long score = 0;
+    for (int t = 0; t < grid->num_tiles; t++) {
+        uint64_t *twice = grid->tiles[t].twice;
+        for (int row = 0; row < TILE_SIZE; row++) {
+            score += __builtin_popcountll(twice[row]);
+        }
+    }
+    return score;
+}
+
+/*
+* Count cells covered by two or more lines by rasterizing into a sparse
+* grid of tiles with 2 bit saturating counters.
+*
+* @param    set                 lines to rasterize
+* @param    include_diagonals   whether to count 45 degree lines
+* @retval   score               number of cells covered more than once
+*/
+long count_overlaps_tiled(struct LineSet *set, int include_diagonals)
+{
+    struct TileGrid *grid = TileGrid_create();
+    for (int l = 0; l < set->num_lines; l++) {
+        struct Line ln = LineSet_line(set, l);
+        if (!is_horiz(&ln) && !is_vert(&ln)
+                && !(include_diagonals && is_diag(&ln)))
+            continue;
+        TileGrid_rasterize(grid, &ln);
+    }
+    long score = TileGrid_count_overlaps(grid);
+    TileGrid_destroy(grid);
+    return score;
+}
+
+/* Shared state for rasterizing on a thread pool. Each task rasterizes a
+   range of lines into a private grid, then each task merges the tiles
+   of one hash partition from every private grid and counts them. */
+struct RasterJob {
+    struct LineSet *set;
+    int include_diagonals;
+    int num_parts;
+    struct TileGrid **grids;
+    long *scores;
+};
+
+/*
+* Thread pool task: rasterize one range of lines into a private tile grid
+*/
+void raster_task(void *ctx, int part)
+{
+    struct RasterJob *job = ctx;
+    struct TileGrid *grid = TileGrid_create();
+    long first = (long)job->set->num_lines * part / job->num_parts;
+    long last = (long)job->set->num_lines * (part + 1) / job->num_parts;
+    for (long l = first; l < last; l++) {
+        struct Line ln = LineSet_line(job->set, l);
+        if (!is_horiz(&ln) && !is_vert(&ln)
+                && !(job->include_diagonals && is_diag(&ln)))
+            continue;
+        TileGrid_rasterize(grid, &ln);
+    }
+    job->grids[part] = grid;
+}
+
+/*
+* Thread pool task: merge one partition of the tiles from every private
+* grid and count the cells covered more than once
+*/
+void merge_task(void *ctx, int part)
+{
+    struct RasterJob *job = ctx;
+    struct TileGrid *merged = TileGrid_create();
+    for (int g = 0; g < job->num_parts; g++) {
+        struct TileGrid *grid = job->grids[g];
+        for (int t = 0; t < grid->num_tiles; t++) {
+            int64_t key = grid->tiles[t].key;
+            if (tile_hash(key, 1 << 24) % job->num_parts != part)
+                continue;
+            int index = TileGrid_tile(merged, key);
+            Tile_merge(&merged->tiles[index], &grid->tiles[t]);
+        }
+    }
+    job->scores[part] = TileGrid_count_overlaps(merged);
+    TileGrid_destroy(merged);
+}
+
+/*
+* Count cells covered by two or more lines by rasterizing in parallel.
+* Lines are split evenly between the pool threads, each rasterizing into
+* its own sparse tile grid, and the grids are merged with saturating adds.
+*
+* @param    set                 lines to rasterize
+* @param    include_diagonals   whether to count 45 degree lines
+* @param    pool                thread pool to run on
+* @retval   score               number of cells covered more than once
+*/
+long count_overlaps_parallel(struct LineSet *set, int include_diagonals,
+        struct ThreadPool *pool)
+{
+    struct RasterJob job;
+    job.set = set;
+    job.include_diagonals = include_diagonals;
+    job.num_parts = pool->num_threads;
+    job.grids = malloc(job.num_parts * sizeof(struct TileGrid *));
+    job.scores = malloc(job.num_parts * sizeof(long));
+    assert(job.grids != NULL && job.scores != NULL);
+
+    ThreadPool_run(pool, raster_task, &job, job.num_parts);
+    ThreadPool_run(pool, merge_task, &job, job.num_parts);
+
+    long score = 0;
+    for (int part = 0; part < job.num_parts; part++) {
+        score += job.scores[part];
+        TileGrid_destroy(job.grids[part]);
+    }
+    free(job.grids);
+    free(job.scores);
+    return score;
+}
+
+/*
+* Count the overlaps with every engine, with and without diagonals, and
+* compare them with the raster reference. Used by fuzz.c.
+*
+* @param    input       the lines, zero terminated
+* @param    size        size of the input
+* @param    pool        thread pool for the parallel engine
+* @param    report      what differed (output)
+* @retval   mismatch    0 if every engine agrees, 1 if not
+*/
+int day5_check_engines(const char *input, size_t size, struct ThreadPool *pool,
+        char report[ANSWER_LEN])
+{
+    const char *names[] = { "sweep", "tiled", "parallel" };
+    struct LineSet *set = parse_lines(input, size);
+    if (set == NULL)
+        return 0; // nothing to check
+    int mismatch = 0;
+    for (int diagonals = 0; diagonals < 2 && !mismatch; diagonals++) {
+        long expected = count_overlaps_raster(set, diagonals);
+        long counts[3] = {
+            count_overlaps(set, diagonals),
+            count_overlaps_tiled(set, diagonals),
+            count_overlaps_parallel(set, diagonals, pool)
+        };
+        for (int e = 0; e < 3 && !mismatch; e++) {
+            if (counts[e] == expected)
+                continue;
+            snprintf(report, ANSWER_LEN, "%s %s diagonals: %ld overlaps, reference: %ld",
+                    names[e], diagonals ? "with" : "without", counts[e], expected);
+            mismatch = 1;
+        }
+    }
+    LineSet_destroy(set);
+    return mismatch;
+}
+
+void *day5_parse(const char *input, size_t size)
+{
+    return parse_lines(input, size);
+}
+
+void day5_part1(void *set, char answer[ANSWER_LEN])
+{
+    snprintf(answer, ANSWER_LEN, "%ld", count_overlaps(set, 0));
+}
+
+void day5_part2(void *set, char answer[ANSWER_LEN])
+{
+    snprintf(answer, ANSWER_LEN, "%ld", count_overlaps(set, 1));
+}
+
+void day5_free(void *set)
+{
+    LineSet_destroy(set);
+}
+
+const struct Solver day5_solver = {
+    "5", day5_parse, day5_part1, day5_part2, day5_free, 1
+};
+
+#ifndef AOC_DRIVER
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day5_solver, argc - 1, argv + 1);
+
+    // usage: 5 [datafile] [sweep|tiled|parallel]
+    char *datafile = (argc > 1) ? argv[1] : "data/5data";
+    struct LineSet *set = read_lines(datafile);
+
+    if (argc > 2 && !strcmp(argv[2], "parallel")) {
+        struct ThreadPool *pool = ThreadPool_create(0);
+        printf("Part 1 score: %ld\n", count_overlaps_parallel(set, 0, pool));
+        printf("Final score: %ld\n", count_overlaps_parallel(set, 1, pool));
+        ThreadPool_destroy(pool);
+    } else {
+        long (*engine)(struct LineSet *, int) = count_overlaps;
+        if (argc > 2 && !strcmp(argv[2], "tiled"))
+            engine = count_overlaps_tiled;
+        printf("Part 1 score: %ld\n", engine(set, 0));
+        printf("Final score: %ld\n", engine(set, 1));
+    }
+    LineSet_destroy(set);
+    return 0;
 }
+#endif
 
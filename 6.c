@@ -2,30 +2,103 @@
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <errno.h>
+#include "util.h"
+#include "bench.h"
 
-#define MAX_AGE 10
-#define MAX_FISH 300
+#define MAX_AGE 9       // timers run 0 through 8
+#define MAX_POWERS 64   // cached powers of the transition matrix, 2^0 .. 2^63
+#define MAX_EXACT_DAYS 900          // 128 bit counts are exact up to here
+#define FISH_MODULUS 1000000007UL   // modulus for queries past MAX_EXACT_DAYS
 
-int split_input(char str[], unsigned char fish[], char delims[])
+/* Fish counts grow by roughly 9% per day, so a 64 bit count overflows
+   a little after day 440. Counts are kept as 128 bit integers, which is
+   exact up to about day 950. Beyond that, give the engine a modulus. */
+typedef unsigned __int128 fish_count_t;
+
+/* The population on the next day is T * population, where T is the 9x9
+   transition matrix. Population after N days is T^N * population, and
+   T^N is a product of the cached squarings T^(2^k) for the bits set in N. */
+struct FishMatrix {
+    fish_count_t m[MAX_AGE][MAX_AGE];
+};
+
+struct FishEngine {
+    fish_count_t modulus;   // 0 for plain 128 bit arithmetic
+    int num_powers;         // number of cached powers
+    struct FishMatrix powers[MAX_POWERS];
+};
+
+/* The ring buffer holds the count of fish at each timer value, with the
+   fish at timer 0 stored at head. Advancing a day rotates the head, so
+   no counts are copied. */
+struct FishRing {
+    fish_count_t timers[MAX_AGE];
+    int head;
+};
+
+/* A population query, remembering its position in the caller's list */
+struct FishQuery {
+    unsigned long long day;
+    int index;
+};
+
+/*
+* Parse comma separated fish timers into a count per timer value. Only
+* the counts are kept, so there is no limit on the number of fish. A
+* timer is checked digit by digit, so a long run of digits cannot
+* overflow, and anything but digits, commas and white space (a minus
+* sign included) is an error.
+*
+* @param    input           the input, zero terminated
+* @param    size            size of the input
+* @param    sorted_fish     count of fish at each timer value (output)
+* @retval   num_fish        number of fish read, -1 if the input is not
+*                           fish timers
+*/
+long parse_fish(const char *input, size_t size, unsigned long sorted_fish[])
 {
-    int num = 0;
-    char *ptr = strtok(str, delims);
-    while(ptr != NULL) {
-        fish[num] = atoi(ptr);
-        assert(fish[num] >= 0);
-        assert(fish[num] <= 6);
-        ptr = strtok(NULL, delims);
-        num++;
+    long num_fish = 0;
+    int timer = -1;             // -1 between timers
+    memset(sorted_fish, 0, MAX_AGE * sizeof(unsigned long));
+    for (size_t i = 0; i <= size; i++) {
+        char c = (i < size) ? input[i] : ',';
+        if (IS_DIGIT(c)) {
+            timer = (timer < 0) ? c - '0' : timer * 10 + (c - '0');
+            if (timer >= MAX_AGE) {
+                printf("Error: Fish timer out of range at byte %zu.\n", i);
+                return -1;
+            }
+        } else if (c == ',' || c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            if (timer >= 0) {
+                sorted_fish[timer]++;
+                num_fish++;
+            }
+            timer = -1;
+        } else {
+            printf("Error: Unexpected '%c' in the fish timers at byte %zu.\n", c, i);
+            return -1;
+        }
     }
-    return num;
+    return num_fish;
 }
 
-void sort_fish(unsigned char fish[], unsigned long sorted_fish[], int num_fish)
+/*
+* Read fish timers from a comma separated input file
+*
+* @param    datafile        data file to read
+* @param    sorted_fish     count of fish at each timer value (output)
+* @retval   num_fish        number of fish read
+*/
+unsigned long read_fish(char datafile[], unsigned long sorted_fish[])
 {
-    int i;
-    for (i = 0; i < num_fish; i++) {
-        sorted_fish[fish[i]]++;
-    }
+    size_t file_size;
+    char *input = read_file(datafile, &file_size);
+    long num_fish = parse_fish(input, file_size, sorted_fish);
+    free(input);
+    if (num_fish < 0)
+        exit(-1);
+    return num_fish;
 }
 
 void print_fish(unsigned long fish[])
@@ -48,38 +121,398 @@ unsigned long sum_fish(unsigned long fish[])
     return sum;
 }
 
-int main(int argc, char *argv[])
+/*
+* Fill a ring buffer from counts of fish at each timer value
+*
+* @param    ring            ring buffer to fill
+* @param    sorted_fish     count of fish at each timer value
+*/
+void FishRing_fill(struct FishRing *ring, unsigned long sorted_fish[])
 {
- //   char fish_test[] = "3,4,3,1,2";
-    char fish_input[] = "1,1,3,5,1,3,2,1,5,3,1,4,4,4,1,1,1,3,1,4,3,1,2,2,2,4,1,1,5,5,4,3,1,1,1,1,1,1,3,4,1,2,2,5,1,3,5,1,3,2,5,2,2,4,1,1,1,4,3,3,3,1,1,1,1,3,1,3,3,4,4,1,1,5,4,2,2,5,4,5,2,5,1,4,2,1,5,5,5,4,3,1,1,4,1,1,3,1,3,4,1,1,2,4,2,1,1,2,3,1,1,1,4,1,3,5,5,5,5,1,2,2,1,3,1,2,5,1,4,4,5,5,4,1,1,3,3,1,5,1,1,4,1,3,3,2,4,2,4,1,5,5,1,2,5,1,5,4,3,1,1,1,5,4,1,1,4,1,2,3,1,3,5,1,1,1,2,4,5,5,5,4,1,4,1,4,1,1,1,1,1,5,2,1,1,1,1,2,3,1,4,5,5,2,4,1,5,1,3,1,4,1,1,1,4,2,3,2,3,1,5,2,1,1,4,2,1,1,5,1,4,1,1,5,5,4,3,5,1,4,3,4,4,5,1,1,1,2,1,1,2,1,1,3,2,4,5,3,5,1,2,2,2,5,1,2,5,3,5,1,1,4,5,2,1,4,1,5,2,1,1,2,5,4,1,3,5,3,1,1,3,1,4,4,2,2,4,3,1,1";
-
-    unsigned char *fish = malloc(MAX_FISH * sizeof(unsigned char));
-    memset(fish, -1, MAX_FISH * sizeof(unsigned char));
-    // look at realloc
-    unsigned long int num_fish = split_input(fish_input, fish, ",");
-    printf("Num fish: %ld\n", num_fish);
-    unsigned long int sorted_fish[MAX_AGE];
-    memset(sorted_fish, 0, (MAX_AGE) * sizeof(unsigned long int));
-    sort_fish(fish, sorted_fish, num_fish);
-    print_fish(sorted_fish);
-    int num_days = 256;
+    int i;
+    for (i = 0; i < MAX_AGE; i++) {
+        ring->timers[i] = sorted_fish[i];
+    }
+    ring->head = 0;
+}
+
+/*
+* Advance the ring buffer by one day. Fish at timer 0 stay in their slot,
+* which becomes timer 8 once the head moves past it: these are the new fish.
+* Their parents are added back in at timer 6.
+*
+* @param    ring            ring buffer to advance
+*/
+void FishRing_advance(struct FishRing *ring)
+{
+    fish_count_t spawning = ring->timers[ring->head];
+    ring->head = (ring->head == MAX_AGE - 1) ? 0 : ring->head + 1;
+    ring->timers[(ring->head + 6) % MAX_AGE] += spawning;
+}
+
+fish_count_t FishRing_sum(struct FishRing *ring)
+{
+    fish_count_t sum = 0;
+    int i;
+    for (i = 0; i < MAX_AGE; i++) {
+        sum += ring->timers[i];
+    }
+    return sum;
+}
+
+int compare_queries(const void *a, const void *b)
+{
+    unsigned long long day_a = ((struct FishQuery *)a)->day;
+    unsigned long long day_b = ((struct FishQuery *)b)->day;
+    return (day_a > day_b) - (day_a < day_b);
+}
+
+/*
+* Answer a batch of population queries in a single forward pass.
+*
+* @param    sorted_fish     initial count of fish at each timer value
+* @param    days            day numbers to query
+* @param    populations     population on each queried day (output)
+* @param    num_queries     number of queries
+*/
+void FishRing_populations(unsigned long sorted_fish[], unsigned long long days[],
+        fish_count_t populations[], int num_queries)
+{
+    struct FishQuery *queries = malloc(num_queries * sizeof(struct FishQuery));
+    assert(queries != NULL);
+    int q;
+    for (q = 0; q < num_queries; q++) {
+        queries[q].day = days[q];
+        queries[q].index = q;
+    }
+    qsort(queries, num_queries, sizeof(struct FishQuery), compare_queries);
+
+    struct FishRing ring;
+    FishRing_fill(&ring, sorted_fish);
+    unsigned long long day = 0;
+    for (q = 0; q < num_queries; q++) {
+        for (; day < queries[q].day; day++) {
+            FishRing_advance(&ring);
+        }
+        populations[queries[q].index] = FishRing_sum(&ring);
+    }
+    free(queries);
+}
+
+/*
+* Reduce a fish count by the engine modulus (if any)
+*
+* @param    eng         the fish engine
+* @param    count       count to reduce
+* @retval   count % modulus, or count if there is no modulus
+*/
+fish_count_t FishEngine_reduce(struct FishEngine *eng, fish_count_t count)
+{
+    return (eng->modulus) ? count % eng->modulus : count;
+}
+
+/*
+* Multiply two transition matrices, result = a * b
+*
+* @param    eng         the fish engine (for the modulus)
+* @param    a           left matrix
+* @param    b           right matrix
+* @param    result      product matrix, may not alias a or b
+*/
+void FishMatrix_multiply(struct FishEngine *eng, struct FishMatrix *a,
+        struct FishMatrix *b, struct FishMatrix *result)
+{
+    int i, j, k;
+    for (i = 0; i < MAX_AGE; i++) {
+        for (j = 0; j < MAX_AGE; j++) {
+            fish_count_t sum = 0;
+            for (k = 0; k < MAX_AGE; k++) {
+                sum = FishEngine_reduce(eng, sum
+                        + FishEngine_reduce(eng, a->m[i][k] * b->m[k][j]));
+            }
+            result->m[i][j] = sum;
+        }
+    }
+}
+
+/*
+* Create a fish engine and cache the first power of the transition matrix.
+*
+* @param    modulus     modulus for all counts, 0 for exact 128 bit counts.
+*                       Must be below 2^64 so products fit in 128 bits.
+* @retval   eng         pointer to the engine
+*/
+struct FishEngine *FishEngine_create(unsigned long modulus)
+{
+    struct FishEngine *eng = malloc(sizeof(struct FishEngine));
+    assert(eng != NULL);
+    eng->modulus = modulus;
+    eng->num_powers = 1;
+
+    // a fish with timer n + 1 has timer n tomorrow
+    struct FishMatrix *step = &eng->powers[0];
+    memset(step, 0, sizeof(struct FishMatrix));
     int n;
-    int day;
-    unsigned long new_fish = 0;
-
-    for (day = 0; day < num_days; day++) {
-        // all fish with timer zero make new fish at max timer
-        new_fish = sorted_fish[0];
-        for (n = 0; n < (9); n++) {
-            sorted_fish[n] = sorted_fish[n+1];
+    for (n = 0; n < MAX_AGE - 1; n++) {
+        step->m[n][n+1] = 1;
+    }
+    // a fish with timer 0 resets to 6 and spawns a new fish at 8
+    step->m[6][0] = 1;
+    step->m[MAX_AGE - 1][0] = 1;
+
+    return eng;
+}
+
+void FishEngine_destroy(struct FishEngine *eng)
+{
+    free(eng);
+}
+
+/*
+* Find the population after a number of days.
+* Squarings of the transition matrix are cached in the engine,
+* so a batch of queries only pays for the squarings once, after which
+* each query costs one matrix-vector product per bit of num_days.
+*
+* @param    eng             the fish engine
+* @param    sorted_fish     initial count of fish at each timer value
+* @param    num_days        number of days to simulate
+* @retval   population      total fish after num_days (mod the engine modulus)
+*/
+fish_count_t FishEngine_population(struct FishEngine *eng,
+        unsigned long sorted_fish[], unsigned long long num_days)
+{
+    fish_count_t fish[MAX_AGE], next[MAX_AGE];
+    int i, j, k;
+    for (i = 0; i < MAX_AGE; i++) {
+        fish[i] = FishEngine_reduce(eng, sorted_fish[i]);
+    }
+
+    for (k = 0; num_days != 0; k++, num_days >>= 1) {
+        assert(k < MAX_POWERS);
+        if (k == eng->num_powers) {
+            FishMatrix_multiply(eng, &eng->powers[k-1], &eng->powers[k-1],
+                    &eng->powers[k]);
+            eng->num_powers++;
+        }
+        if (!(num_days & 1))
+            continue;
+        for (i = 0; i < MAX_AGE; i++) {
+            next[i] = 0;
+            for (j = 0; j < MAX_AGE; j++) {
+                next[i] = FishEngine_reduce(eng, next[i]
+                        + FishEngine_reduce(eng, eng->powers[k].m[i][j] * fish[j]));
+            }
         }
-        sorted_fish[6] += new_fish;
-        sorted_fish[8] += new_fish;
-        /*}*/
-        // print_fish(sorted_fish);
-        // printf("Day %d: %ld fish\n", day + 1, sum_fish(sorted_fish));
+        memcpy(fish, next, sizeof(fish));
+    }
+
+    fish_count_t population = 0;
+    for (i = 0; i < MAX_AGE; i++) {
+        population = FishEngine_reduce(eng, population + fish[i]);
     }
+    return population;
+}
+
+/*
+* Format a 128 bit fish count (printf has no format for it)
+*
+* @param    count       the count to format
+* @param    str         string to write to, at least 40 chars
+*/
+void format_count(fish_count_t count, char str[])
+{
+    char digits[40];
+    int n = 0;
+    do {
+        digits[n++] = '0' + (count % 10);
+        count /= 10;
+    } while (count != 0);
+    while (n > 0) {
+        *str++ = digits[--n];
+    }
+    *str = '\0';
+}
+
+void print_count(fish_count_t count)
+{
+    char str[40];
+    format_count(count, str);
+    fputs(str, stdout);
+}
+
+struct School {
+    unsigned long sorted_fish[MAX_AGE];
+};
+
+void *day6_parse(const char *input, size_t size)
+{
+    struct School *school = malloc(sizeof(struct School));
+    assert(school != NULL);
+    if (parse_fish(input, size, school->sorted_fish) < 0) {
+        free(school);
+        return NULL;
+    }
+    return school;
+}
+
+void day6_population(struct School *school, unsigned long long day,
+        char answer[ANSWER_LEN])
+{
+    fish_count_t population;
+    FishRing_populations(school->sorted_fish, &day, &population, 1);
+    format_count(population, answer);
+}
+
+void day6_part1(void *school, char answer[ANSWER_LEN])
+{
+    day6_population(school, 80, answer);
+}
+
+void day6_part2(void *school, char answer[ANSWER_LEN])
+{
+    day6_population(school, 256, answer);
+}
+
+void day6_free(void *school)
+{
+    free(school);
+}
+
+/*
+* Compare the matrix engine, exact and modular, with the day by day ring
+* on a spread of days up to MAX_EXACT_DAYS. Used by fuzz.c.
+*
+* @param    input       the fish, zero terminated
+* @param    size        size of the input
+* @param    pool        unused, all the engines are serial
+* @param    report      what differed (output)
+* @retval   mismatch    0 if every engine agrees, 1 if not
+*/
+int day6_check_engines(const char *input, size_t size, struct ThreadPool *pool,
+        char report[ANSWER_LEN])
+{
+    unsigned long long days[] = { 0, 1, 2, 7, 8, 9, 18, 80, 256, 441, 700, MAX_EXACT_DAYS };
+    int num_days = sizeof(days) / sizeof(days[0]);
+    fish_count_t expected[sizeof(days) / sizeof(days[0])];
+    unsigned long sorted_fish[MAX_AGE];
+    if (parse_fish(input, size, sorted_fish) < 0)
+        return 0; // nothing to check
+    FishRing_populations(sorted_fish, days, expected, num_days);
+
+    struct FishEngine *exact = FishEngine_create(0);
+    struct FishEngine *modular = FishEngine_create(FISH_MODULUS);
+    char count[40], reference[40];
+    int mismatch = 0;
+    for (int d = 0; d < num_days && !mismatch; d++) {
+        fish_count_t population = FishEngine_population(exact, sorted_fish, days[d]);
+        fish_count_t reduced = FishEngine_population(modular, sorted_fish, days[d]);
+        if (population != expected[d]) {
+            format_count(population, count);
+            format_count(expected[d], reference);
+            snprintf(report, ANSWER_LEN, "day %llu: %s fish, reference: %s",
+                    days[d], count, reference);
+            mismatch = 1;
+        } else if (reduced != expected[d] % FISH_MODULUS) {
+            format_count(reduced, count);
+            format_count(expected[d] % FISH_MODULUS, reference);
+            snprintf(report, ANSWER_LEN, "day %llu: %s fish (mod %lu), reference: %s",
+                    days[d], count, FISH_MODULUS, reference);
+            mismatch = 1;
+        }
+    }
+    FishEngine_destroy(exact);
+    FishEngine_destroy(modular);
+    return mismatch;
+}
+
+const struct Solver day6_solver = {
+    "6", day6_parse, day6_part1, day6_part2, day6_free, 1
+};
+
+#ifndef AOC_DRIVER
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day6_solver, argc - 1, argv + 1);
+
+    // usage: 6 [datafile] [ring|matrix] [day ...]
+    char *datafile = (argc > 1) ? argv[1] : "data/6data";
+    unsigned long sorted_fish[MAX_AGE];
+    unsigned long num_fish = read_fish(datafile, sorted_fish);
+    printf("Num fish: %lu\n", num_fish);
     print_fish(sorted_fish);
-    printf("Day %d: %ld fish\n", day, sum_fish(sorted_fish));
+
+    // exact days are answered by the ring, in one forward pass, or by the
+    // exact matrix engine; anything further out by the modular engine
+    int arg = 2;
+    int use_matrix = 0;
+    if (arg < argc && !IS_DIGIT(argv[arg][0])) {
+        use_matrix = !strcmp(argv[arg], "matrix");
+        if (!use_matrix && strcmp(argv[arg], "ring") != 0) {
+            printf("Error: Unknown engine %s, expected ring or matrix.\n", argv[arg]);
+            exit(-1);
+        }
+        arg++;
+    }
+    unsigned long long default_days[] = { 80, 256 };
+    int num_queries = (arg < argc) ? argc - arg : 2;
+    unsigned long long *days = malloc(num_queries * sizeof(unsigned long long));
+    unsigned long long *exact_days = malloc(num_queries * sizeof(unsigned long long));
+    fish_count_t *populations = malloc(num_queries * sizeof(fish_count_t));
+    fish_count_t *exact_populations = malloc(num_queries * sizeof(fish_count_t));
+    assert(days != NULL && exact_days != NULL);
+    assert(populations != NULL && exact_populations != NULL);
+
+    int num_exact = 0;
+    int q;
+    for (q = 0; q < num_queries; q++) {
+        if (arg < argc) {
+            // digits only, as with the timers: strtoull would take a sign,
+            // and turn "-1" into the largest day there is
+            const char *text = argv[arg + q];
+            char *end;
+            errno = 0;
+            days[q] = IS_DIGIT(text[0]) ? strtoull(text, &end, 10) : 0;
+            if (!IS_DIGIT(text[0]) || *end != '\0' || errno == ERANGE) {
+                printf("Error: Bad day '%s', expected a number of days.\n", text);
+                exit(-1);
+            }
+        } else {
+            days[q] = default_days[q];
+        }
+        if (days[q] <= MAX_EXACT_DAYS)
+            exact_days[num_exact++] = days[q];
+    }
+    struct FishEngine *exact = FishEngine_create(0);
+    struct FishEngine *modular = FishEngine_create(FISH_MODULUS);
+    if (use_matrix) {
+        for (q = 0; q < num_exact; q++)
+            exact_populations[q] = FishEngine_population(exact, sorted_fish, exact_days[q]);
+    } else {
+        FishRing_populations(sorted_fish, exact_days, exact_populations, num_exact);
+    }
+
+    // print in the order the days were given
+    int e = 0;
+    for (q = 0; q < num_queries; q++) {
+        int is_exact = days[q] <= MAX_EXACT_DAYS;
+        populations[q] = is_exact ? exact_populations[e++]
+            : FishEngine_population(modular, sorted_fish, days[q]);
+        printf("Day %llu: ", days[q]);
+        print_count(populations[q]);
+        if (is_exact)
+            printf(" fish\n");
+        else
+            printf(" fish (mod %lu)\n", FISH_MODULUS);
+    }
+
+    FishEngine_destroy(exact);
+    FishEngine_destroy(modular);
+    free(days);
+    free(exact_days);
+    free(populations);
+    free(exact_populations);
     return 0;
 }
+#endif
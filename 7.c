@@ -14,65 +14,133 @@
 #include <string.h>
 #include <errno.h>
 #include "util.h"
+#include "bench.h"
 
-#define MAX_INPUTS 1024 // Maximum number of positions to evaluate.
-#define MAX_DIGITS 4    // maximum number of digits in data
+/* Largest crab position. Every position in between is tried, and part 2
+   costs grow with the square of the distance, so this keeps the search
+   short and the costs inside a long. */
+#define MAX_POSITION (1 << 16)
 
-int cost_fcn_p1(int dist)
+long cost_fcn_p1(int dist)
 {
     return dist;
 }
 
-int cost_fcn_p2(int dist)
+long cost_fcn_p2(int dist)
 {
     // part 2 cost function is sum of first n integers
-    return (dist * (dist + 1) / 2);
+    return ((long)dist * (dist + 1) / 2);
 }
 
-int find_min_cost(int (*cost_function)(int), int *inputs, int num_inputs)
+long find_min_cost(long (*cost_function)(int), int *inputs, int num_inputs)
 {
-    int rng = range(inputs, &num_inputs);
-    int cost[rng];
     // this is brute force method
 
     // loop through all possible positions
     // start at minimum position of all inputs
     int dist;
     int pos = *min(inputs, &num_inputs);
-    for (int p = 0; p <= rng; p++) {
-        cost[p] = 0;
+    int last = *max(inputs, &num_inputs);
+    long min_cost = -1;
+    for (; pos <= last; pos++) {
+        long cost = 0;
         // loop through all inputs
         for (int i = 0; i < num_inputs; i++) {
             dist = abs(inputs[i] - pos);
-            cost[p] += cost_function(dist);
+            cost += cost_function(dist);
         }
-        pos++; 
+        if (min_cost < 0 || cost < min_cost)
+            min_cost = cost;
     }
 
-    return *min(cost, &num_inputs);
+    return min_cost;
 }
 
+struct Crabs {
+    int *positions;
+    int num_crabs;
+    int capacity;
+};
+
+void day7_free(void *puzzle)
+{
+    struct Crabs *crabs = puzzle;
+    free(crabs->positions);
+    free(crabs);
+}
+
+/*
+* Parse the crab positions
+*
+* @param    input       the positions, comma separated
+* @param    size        size of the input
+* @retval   crabs       the crabs
+* @retval   NULL        there are no crabs, or a position is not from 0 to
+*                       MAX_POSITION
+*/
+void *day7_parse(const char *input, size_t size)
+{
+    struct Crabs *crabs = calloc(1, sizeof(struct Crabs));
+    assert(crabs != NULL);
+    int ok = parse_ints(input, size, &crabs->positions, &crabs->num_crabs,
+            &crabs->capacity) > 0;
+    for (int i = 0; ok && i < crabs->num_crabs; i++)
+        ok = crabs->positions[i] >= 0 && crabs->positions[i] <= MAX_POSITION;
+    if (!ok) {
+        day7_free(crabs);
+        return NULL;
+    }
+    return crabs;
+}
+
+void day7_part1(void *puzzle, char answer[ANSWER_LEN])
+{
+    struct Crabs *crabs = puzzle;
+    snprintf(answer, ANSWER_LEN, "%ld",
+            find_min_cost(cost_fcn_p1, crabs->positions, crabs->num_crabs));
+}
+
+void day7_part2(void *puzzle, char answer[ANSWER_LEN])
+{
+    struct Crabs *crabs = puzzle;
+    snprintf(answer, ANSWER_LEN, "%ld",
+            find_min_cost(cost_fcn_p2, crabs->positions, crabs->num_crabs));
+}
+
+const struct Solver day7_solver = {
+    "7", day7_parse, day7_part1, day7_part2, day7_free, 1
+};
+
+#ifndef AOC_DRIVER
 int main(int argc, char *argv[])
 {
-    int *input = malloc(MAX_INPUTS * sizeof(int));
-    int num_inputs;
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day7_solver, argc - 1, argv + 1);
+
+    int *input = NULL;
+    int num_inputs = 0;
+    int capacity = 0;
 
     if (argc > 1 && *argv[1] == 't') {
         // test case input
         printf("Test Mode\n");
         char test[] = "16,1,2,0,4,2,7,1,2,14";
-        num_inputs = split_input(test, input, ",");
+        parse_ints(test, strlen(test), &input, &num_inputs, &capacity);
     } else {
-        FILE *data = fopen("data/7data", "r");
-        assert(data != NULL);
-
-        // set the buffer size to be the maximum number
-        // of positions times the max digits per position
-        // plus additional char for ',' between positions
-        char buffer[MAX_INPUTS * (MAX_DIGITS + 1)];
-
-        fgets(buffer, sizeof(buffer), data);
-        num_inputs = split_input(buffer, input, ",");
+        // any number of positions, from any data file
+        char *datafile = (argc > 1) ? argv[1] : "data/7data";
+        size_t file_size;
+        char *buffer = read_file(datafile, &file_size);
+        struct Crabs *crabs = day7_parse(buffer, file_size);
+        free(buffer);
+        if (crabs == NULL) {
+            printf("Error: Crab positions must be from 0 to %d, and there must be some.\n",
+                    MAX_POSITION);
+            exit(-1);
+        }
+        input = crabs->positions;
+        num_inputs = crabs->num_crabs;
+        free(crabs);
     }
     // print_array(input, num_inputs);
     printf("num elements: %d\n", num_inputs);
@@ -82,15 +150,17 @@ int main(int argc, char *argv[])
     printf("Number of cost functions evaluated: %d\n", num_costs);
 
     // some practice for function pointers
-    int (*cost_function)(int) = NULL;
+    long (*cost_function)(int) = NULL;
 
     cost_function = cost_fcn_p1;
-    printf("Cost for Part 1: %d\n",
+    printf("Cost for Part 1: %ld\n",
             find_min_cost(cost_function, input, num_inputs));
 
     cost_function = cost_fcn_p2;
-    printf("Cost for Part 2: %d\n",
+    printf("Cost for Part 2: %ld\n",
             find_min_cost(cost_function, input, num_inputs));
 
+    free(input);
     return 0;
 }
+#endif
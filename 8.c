@@ -12,6 +12,7 @@
 
 #include <stdio.h>
 #include "util.h"
+#include "bench.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -102,7 +103,7 @@ void find_lengths(char *str, int *lengths)
     for (int i = 0; i < NUM_WORDS; i++) {
         lengths[i] = 0;
         while(*str != '\0') {
-            if (*str == ' ' || *str == '\n') {
+            if (*str == ' ' || *str == '\n' || *str == '\r') {
                 str++;
                 break;
             }
@@ -192,6 +193,7 @@ char *segment_missing_from(char **from, int l_f, char **not_in, int l_n)
   * Given an encoded string, find the digit corresponding
   * to each word
   *
+  * @param      arena       arena to allocate the decoded words from
   * @param      str         string to search
   * @param      lengths     lengths of words in string
   * @param      words       array of strings to populate once decoded.
@@ -200,7 +202,7 @@ char *segment_missing_from(char **from, int l_f, char **not_in, int l_n)
   *                         words[3] corresponds to the digit 3.
   * @retval     0           success
   */
-int decode(char *str, int *lengths, char **words)
+int decode(struct Arena *arena, char *str, int *lengths, char **words)
 {    
     // loop through first 10 words in str
     // we already know the length of each word
@@ -215,8 +217,7 @@ int decode(char *str, int *lengths, char **words)
             int len = lengths[i]; // refactor for easier to read code
 
             // assign the word to be analyzed
-            word = malloc(len * sizeof(char*));
-            memset(word, '\0', len * sizeof(char*));
+            word = Arena_calloc(arena, len + 1, sizeof(char));
             for (int w = 0; w < len; w++) 
                 word[w] = *str_tmp++;
 
@@ -341,10 +342,6 @@ int decode(char *str, int *lengths, char **words)
             if (i >= NUM_INPUTS)
                 words[i] = (char *)word;
 
-            // cleanup
-            word = NULL;
-            free(word);
-
             // advance the pointer past the space
             str_tmp++;
         }
@@ -395,70 +392,230 @@ int find_duplicates(char *words[], const int *num_segments)
     return dupes; // 0 for success orno duplicates found
 }
 
-int main(int argc, char *argv[])
+// number of segments corresponding to 7-segment display:
+const int num_segments[] = { 6, 2, 5, 5, 4, 5, 6, 3, 7, 6 };
+// corresponding digits == { 0  1  2  3  4  5  6  7  8  9 };
+
+/* The digits as segment masks, segment A in bit 0 to G in bit 6 */
+const uint8_t DIGIT_SEGMENTS[NUM_INPUTS] = {
+    0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F
+};
+
+/**
+  * Check an entry of the notes: ten patterns, "|" and four outputs,
+  * separated by single spaces, each pattern 2 to 7 distinct letters
+  * from a to g, then the end of the line or input. The ten patterns must be the ten digits under one
+  * wiring, as decode() depends on that to finish. Across the ten digits
+  * segments E, F and C are lit 4, 6 and 9 times, A and B 8 times (B is
+  * in 1) and D and G 7 times (G is in 4), which gives the wiring.
+  *
+  * @param      line        the entry
+  * @param      end         end of the input
+  * @retval     1           the entry is valid
+  * @retval     0           it is not
+  */
+int entry_valid(const char *line, const char *end)
 {
-    // number of segments corresponding to 7-segment display:
-    const int num_segments[] = { 6, 2, 5, 5, 4, 5, 6, 3, 7, 6 };
-    // corresponding digits == { 0  1  2  3  4  5  6  7  8  9 };
-    char datafile[] = "data/8data";
-    if (argc > 1 && *argv[1] == 't') {
-        printf("Test Mode!\n");
-        strcpy(datafile, "data/8test");
+    uint8_t patterns[NUM_WORDS];
+    const char *p = line;
+    for (int i = 0; i < NUM_WORDS; i++) {
+        if (i == NUM_INPUTS) {
+            if (p >= end || *p++ != '|')
+                return 0;
+        } else {
+            int len = 0;
+            patterns[i] = 0;
+            for (; p < end && *p >= 'a' && *p <= 'g'; p++, len++) {
+                if (patterns[i] & (1 << (*p - 'a')))
+                    return 0;
+                patterns[i] |= 1 << (*p - 'a');
+            }
+            if (len < 2)
+                return 0;
+        }
+        if (i < NUM_WORDS - 1 && (p >= end || *p++ != ' '))
+            return 0;
     }
-    FILE *data = fopen(datafile, "r");
-    char buffer[MAX_LEN];
+    // a line may end in "\r\n"
+    if (p < end && *p == '\r')
+        p++;
+    if (p < end && *p != '\n')
+        return 0;
+
+    uint8_t one = 0, four = 0;
+    int counts[NUM_SEGMENTS] = { 0 };
+    for (int i = 0; i < NUM_INPUTS; i++) {
+        int len = __builtin_popcount(patterns[i]);
+        if (len == 2)
+            one = patterns[i];
+        if (len == 4)
+            four = patterns[i];
+        for (int s = 0; s < NUM_SEGMENTS; s++)
+            counts[s] += (patterns[i] >> s) & 1;
+    }
+    uint8_t wiring[NUM_SEGMENTS];   // letter to segment bit
+    uint8_t wired = 0;
+    for (int s = 0; s < NUM_SEGMENTS; s++) {
+        switch (counts[s]) {
+            case 4: wiring[s] = 1 << 4; break;
+            case 6: wiring[s] = 1 << 5; break;
+            case 9: wiring[s] = 1 << 2; break;
+            case 8: wiring[s] = (one & (1 << s)) ? 1 << 1 : 1 << 0; break;
+            case 7: wiring[s] = (four & (1 << s)) ? 1 << 6 : 1 << 3; break;
+            default: return 0;
+        }
+        wired |= wiring[s];
+    }
+    if (wired != 0x7F)
+        return 0;
+    int digits_seen = 0;
+    for (int i = 0; i < NUM_INPUTS; i++) {
+        uint8_t segments = 0;
+        for (int s = 0; s < NUM_SEGMENTS; s++) {
+            if (patterns[i] & (1 << s))
+                segments |= wiring[s];
+        }
+        int d;
+        for (d = 0; d < NUM_INPUTS && DIGIT_SEGMENTS[d] != segments; d++)
+            ;
+        if (d == NUM_INPUTS || digits_seen & (1 << d))
+            return 0;
+        digits_seen |= 1 << d;
+    }
+    return 1;
+}
+
+/* The notes, one entry per line: ten patterns, "|" and four outputs.
+   Entries point into the input. */
+struct Notes {
+    int num_entries;
+    char **entries;
+    int (*lengths)[NUM_WORDS];  // lengths of words, in order of appearance
+};
 
-    // lengths of words, in order of appearance
-    int *lengths = malloc(NUM_WORDS * sizeof(int));
+void day8_free(void *puzzle)
+{
+    struct Notes *notes = puzzle;
+    free(notes->entries);
+    free(notes->lengths);
+    free(notes);
+}
 
-    // words, to be ordered by number value
-    char **words = NULL;
+/*
+* Parse the notes
+*
+* @param    input       the notes, zero terminated
+* @param    size        size of the input
+* @retval   notes       the notes
+* @retval   NULL        an entry is not valid, see entry_valid()
+*/
+void *day8_parse(const char *input, size_t size)
+{
+    struct Notes *notes = calloc(1, sizeof(struct Notes));
+    assert(notes != NULL);
+    int capacity = 0;
+    const char *line = input, *end = input + size;
+    while (line < end) {
+        line += strspn(line, "\r\n");
+        if (line >= end)
+            break;
+        if (!entry_valid(line, end)) {
+            day8_free(notes);
+            return NULL;
+        }
+        if (notes->num_entries == capacity) {
+            capacity = (capacity > 0) ? 2 * capacity : 256;
+            notes->entries = realloc(notes->entries, capacity * sizeof(char *));
+            notes->lengths = realloc(notes->lengths, capacity * sizeof(*notes->lengths));
+            assert(notes->entries != NULL && notes->lengths != NULL);
+        }
+        notes->entries[notes->num_entries] = (char *)line;
+        find_lengths((char *)line, notes->lengths[notes->num_entries]);
+        notes->num_entries++;
+        line += strcspn(line, "\n");
+    }
+    return notes;
+}
 
+void day8_part1(void *puzzle, char answer[ANSWER_LEN])
+{
+    struct Notes *notes = puzzle;
     const int nums_to_count[NUM_OUTPUTS] = { 2, 3, 4, 7 };
     int part_1_count = 0;
-    int part_2_sum = 0;
-    while(fgets(buffer, sizeof(buffer), data) != NULL) {
-        words = malloc(NUM_WORDS * sizeof(char *));
-        memset(words, 0, NUM_WORDS * sizeof(char *));
-        find_lengths(buffer, lengths);
-        // print_array(lengths, NUM_WORDS);
+    for (int e = 0; e < notes->num_entries; e++) {
+        for (int i = NUM_INPUTS + 1; i < NUM_WORDS; i++) { // start after |
+            if (is_in(notes->lengths[e][i], nums_to_count, NUM_OUTPUTS))
+                part_1_count++;
+        }
+    }
+    snprintf(answer, ANSWER_LEN, "%d", part_1_count);
+}
 
-        decode(buffer, lengths, words);
+void day8_part2(void *puzzle, char answer[ANSWER_LEN])
+{
+    struct Notes *notes = puzzle;
+    // everything decoded from a line is released before the next line
+    struct Arena *arena = Arena_create(0);
+    struct ArenaMark line_start = Arena_mark(arena);
+    int part_2_sum = 0;
+    for (int e = 0; e < notes->num_entries; e++) {
+        Arena_reset(arena, line_start);
+        int *lengths = notes->lengths[e];
+        // words, to be ordered by number value
+        char **words = Arena_calloc(arena, NUM_WORDS, sizeof(char *));
+        decode(arena, notes->entries[e], lengths, words);
         if (find_duplicates(words, num_segments)) {
             print_words(words, lengths, NUM_WORDS);
-            printf("%s", buffer);
+            printf("%.*s\n", (int)strcspn(notes->entries[e], "\n"), notes->entries[e]);
         }
 
         int power = 0;
         for (int i = NUM_INPUTS + 1; i < NUM_WORDS; i++) { // start after |
-            // part 1 solution
-            if (is_in(lengths[i], nums_to_count, NUM_OUTPUTS))
-                part_1_count++;
             for (int j = 0; j < NUM_INPUTS; j++) {
                 if (lengths[i] == num_segments[j] && words_equal(words[j], words[i], lengths[i])) {
                     power = NUM_WORDS - i - 1;
-                    //printf("%s =? %s\n", words[i], words[j]);
                     part_2_sum += exponent_base_10(j, power);
-                    // printf("%d * 10^%d = %d\n",j,power,pwr(j,power));
                 }
             }
         }
     }
-    // clear words
-    /*for (int i = 0; i < NUM_WORDS; i++) {*/
-        /*words[i] = NULL;*/
-        /*free(words[i]);*/
-    /*}*/
-    words = NULL;
-    free(words);
+    // the words of every line, and the word lists
+    Arena_destroy(arena);
+    snprintf(answer, ANSWER_LEN, "%d", part_2_sum);
+}
+
+const struct Solver day8_solver = {
+    "8", day8_parse, day8_part1, day8_part2, day8_free, 1
+};
+
+#ifndef AOC_DRIVER
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day8_solver, argc - 1, argv + 1);
 
-    printf("Total count for Part I: %d\n", part_1_count);
+    char datafile[] = "data/8data";
+    if (argc > 1 && *argv[1] == 't') {
+        printf("Test Mode!\n");
+        strcpy(datafile, "data/8test");
+    }
+    size_t file_size;
+    char *input = read_file(datafile, &file_size);
+    struct Notes *notes = day8_parse(input, file_size);
+    if (notes == NULL) {
+        printf("Error: Every line must be ten digit patterns, '|' and four outputs.\n");
+        exit(-1);
+    }
 
-    printf("Total sum for Part II: %d\n", part_2_sum);
+    char answer[ANSWER_LEN];
+    day8_part1(notes, answer);
+    printf("Total count for Part I: %s\n", answer);
 
-    // clean up
-    lengths = NULL;
-    free(lengths);
+    day8_part2(notes, answer);
+    printf("Total sum for Part II: %s\n", answer);
 
+    day8_free(notes);
+    free(input);
     return 0;
 }
+#endif
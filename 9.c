@@ -33,10 +33,12 @@
 #include <string.h>
 #include <stdint.h>
 #include "util.h"
+#include "bench.h"
 
 #define MAX_NEIGHBORS 4 // maximum neighboring points on a heightmap (no diagonals)
 
 struct Heightmap {
+    struct Arena *arena;    // the map and its heights live here
     unsigned num_rows;
     unsigned num_cols;
     unsigned num_elements;
@@ -44,6 +46,7 @@ struct Heightmap {
     unsigned num_low_points;
     unsigned risk;
     unsigned basin_score;
+    int top_basins[3];
 };
 
 /*
@@ -58,68 +61,70 @@ int low_point_risk(int low_point_height)
 }
 
 /*
-* Create a heightmap given an input file.
+* Parse a heightmap: rows of digits, one digit per point. The row size
+* comes from the first line, and anything that is not a digit is skipped.
 *
-* @param    file_handle     input file to read
+* @param    input           the input, zero terminated
+* @param    file_size       size of the input
 * @retval   map             pointer to height map
+* @retval   NULL            the rows are not all as long as the first
 */
-struct Heightmap *Heightmap_create(char *file_name)
+struct Heightmap *Heightmap_parse(const char *input, size_t file_size)
 {
-    FILE* input_file_handle = fopen(file_name, "r");
-    if (input_file_handle == NULL) {
-        printf("Error: reading input file %s: %s\n", file_name, strerror(errno));
-        exit(-1);
+    // the map and its heights come from one block
+    struct Arena *arena = Arena_create(sizeof(struct Heightmap) + file_size + 2 * ARENA_ALIGN);
+    struct Heightmap *map = Arena_calloc(arena, 1, sizeof(struct Heightmap));
+    map->arena = arena;
+    size_t row_size = strcspn(input, "\r\n");
+    map->heights = Arena_alloc(arena, file_size + 1);
+
+    // populate the heightmap, a last row without a newline counts too
+    unsigned num_elements = 0;
+    for (size_t i = 0; i < file_size; i++) {
+        uint8_t next_height = input[i] - '0';
+        // skip anything that's not 0 thru 9
+        if (next_height <= 9)
+            map->heights[num_elements++] = next_height;
     }
+    if (row_size == 0 || num_elements % row_size != 0) {
+        Arena_destroy(arena);
+        return NULL;
+    }
+    map->num_cols = row_size;
+    map->num_rows = num_elements / row_size;
+    map->num_elements = num_elements;
+    return map;
+}
 
-    // allocate memory for the height map object
-    struct Heightmap *map = malloc(sizeof(struct Heightmap));
-
-    // search for the first newline to get the row size
-    while (fgetc(input_file_handle) != '\n');
-    size_t row_size = ftell(input_file_handle) - 1; // ignore the newline
-
-    fseek(input_file_handle, -1, SEEK_END);
-    /*printf("Last Character: %c", fgetc(input_file_handle));*/
-    size_t file_size = ftell(input_file_handle);
-    rewind(input_file_handle);
-
+/*
+* Create a heightmap given an input file.
+*
+* @param    file_name       input file to read
+* @retval   map             pointer to height map
+*/
+struct Heightmap *Heightmap_create(char *file_name)
+{
+    size_t file_size;
+    char *input = read_file(file_name, &file_size);
     printf("Reading file %s...\n", file_name);
     printf("File size: %lu bytes\n", file_size);
-    printf("Row size: %lu bytes\n", row_size);
+    printf("Row size: %lu bytes\n", strcspn(input, "\r\n"));
 
-    map->num_cols = row_size / sizeof(char);
-    // TODO: Fix case where this not a newline at the end
-    map->num_rows = (file_size + 2) / (row_size + 1); // add 1 to rowsize to count newlines
-    map->num_elements = map->num_cols * map->num_rows;
-
-    // allocate array for heightmap
-    map->heights = (uint8_t *)malloc(map->num_elements * sizeof(uint8_t));
-
-    // populate the heightmap
-    int height_index = 0;
-    while (height_index < map->num_elements) {
-        uint8_t next_height = fgetc(input_file_handle) - '0'; 
-        // skip anything that's not 0 thru 9
-        if (next_height >= 0 && next_height <= 9) {
-            map->heights[height_index] = next_height;
-            height_index++;
-        }
+    struct Heightmap *map = Heightmap_parse(input, file_size);
+    free(input);
+    if (map == NULL) {
+        printf("Error: Heightmap rows are not all the same length.\n");
+        exit(-1);
     }
-
-    fclose(input_file_handle);
-    map->risk = 0; // initialize risk
-    map->num_low_points = 0; // initialize low points
-    map->basin_score = 0;
-
     return map;
 }
 
 /*
-* Free the memory associated with a Heightmap
+* Free a Heightmap and everything in it
 */
 void Heightmap_destroy(struct Heightmap *map)
 {
-    free(map->heights);
+    Arena_destroy(map->arena);
 }
 
 /* 
@@ -194,12 +199,11 @@ int col_index (struct Heightmap *map, int index)
 * 
 * @param    map             heightmap to search
 * @param    index           index within heightmap
-* @param    neighbors       array to populate with neighboring indices
-* @param    num_neighbors   pointer to array size for neighbors
+* @param    neighbors       vector to push neighboring indices onto
 * @retval   1               error with parameters
 * @retval   0               succeeded
 */
-int Heightmap_neighbors(struct Heightmap *map, int index, int *neighbors, int *num_neighbors)
+int Heightmap_neighbors(struct Heightmap *map, int index, struct IntVector *neighbors)
 {
     if (map == NULL || neighbors == NULL) {
         printf("Error: Bad access to heightmap.\n");
@@ -216,19 +220,19 @@ int Heightmap_neighbors(struct Heightmap *map, int index, int *neighbors, int *n
 
     // check above
     if (row != 0)  // skip if on top row
-        push_unique(neighbors, num_neighbors, rc_index(map, row - 1, col));
+        IntVector_push_unique(neighbors, rc_index(map, row - 1, col));
 
     // check in front
     if (col != (map->num_cols - 1))  // skip if last column
-        push_unique(neighbors, num_neighbors, rc_index(map, row, col + 1));
+        IntVector_push_unique(neighbors, rc_index(map, row, col + 1));
 
     // check below
     if (row != (map->num_rows - 1))  // skip if last row
-        push_unique(neighbors, num_neighbors, rc_index(map, row + 1, col));
+        IntVector_push_unique(neighbors, rc_index(map, row + 1, col));
 
     // check behind
     if (col != 0)  // skip if first column
-        push_unique(neighbors, num_neighbors, rc_index(map, row, col - 1));
+        IntVector_push_unique(neighbors, rc_index(map, row, col - 1));
 
     return 0; // success
 }
@@ -244,16 +248,18 @@ int Heightmap_neighbors(struct Heightmap *map, int index, int *neighbors, int *n
 */
 int is_low_point(struct Heightmap *map, int index)
 {
-    int neighbors[MAX_NEIGHBORS];
-    int num_neighbors = 0;
+    // there are never more than MAX_NEIGHBORS, so the vector
+    // can use a local array and never grows (or needs freeing)
+    int neighbor_buffer[MAX_NEIGHBORS];
+    struct IntVector neighbors = { neighbor_buffer, 0, MAX_NEIGHBORS };
 
-    if (Heightmap_neighbors(map, index, neighbors, &num_neighbors)) {
+    if (Heightmap_neighbors(map, index, &neighbors)) {
         printf("Error in Heightmap_neighbors called from low_point().\n");
         exit(-1);
     }
 
-    for (int neighbor_index = 0; neighbor_index < num_neighbors; neighbor_index++) {
-        if (map->heights[index] >= map->heights[neighbors[neighbor_index]]) // not a low point
+    for (int neighbor_index = 0; neighbor_index < neighbors.size; neighbor_index++) {
+        if (map->heights[index] >= map->heights[neighbors.data[neighbor_index]]) // not a low point
             return 0;
     }
 
@@ -364,45 +370,41 @@ int search_basin(struct Heightmap *map, int low_point_index)
 {
     if (map == NULL) 
         printf("Error: heightmap not found.\n");
-    int basin[map->num_elements];               // worst case, basin is entire map
-    basin[0] = low_point_index;                 // first point in basin is always the low point
-    int basin_size = 1;                         // low_point counts as part of basin
+    struct IntVector basin = { 0 };
+    IntVector_push(&basin, low_point_index);    // first point in basin is always the low point
 
-    int points_to_search[map->num_elements];    // worst case, need to search entire map
-    int num_to_search = 0;                      // number of points left to search
+    struct IntVector points_to_search = { 0 };  // stack of points left to search
 
     // find valid neighbors of the low point, and add them to the points to search
-    if (Heightmap_neighbors(map, low_point_index, points_to_search, &num_to_search)) {
+    if (Heightmap_neighbors(map, low_point_index, &points_to_search)) {
         printf("Error with Heightmap_neighbors() called in search_basin().\n");
         exit(-1);
     }
-    while(num_to_search > 0) { // keep going until we've exhausted our options
+    while(points_to_search.size > 0) { // keep going until we've exhausted our options
         // grab the next thing on top of the points_to_search stack
-        int current_index = pop(points_to_search, &num_to_search);
+        int current_index = IntVector_pop(&points_to_search);
 
         if (map->heights[current_index] == 9) // we've reached a ridge
             continue;
-        if (is_in(current_index, basin, basin_size)) // already in the basin
+        if (is_in(current_index, basin.data, basin.size)) // already in the basin
             continue;
 
         // if not a ridge or already in the basin, add it to the basin
-        push(basin, &basin_size, current_index);
+        IntVector_push(&basin, current_index);
 
         // Search valid neighbors and add them to points to search.
-        // Heightmap_neighbors calls push_unique() to ensure we never search the same
+        // Heightmap_neighbors calls IntVector_push_unique() to ensure we never search the same
         // point twice.
         // TODO: Rewrite so we don't add points already in the basin to the search stack.
-        if (Heightmap_neighbors(map, current_index, points_to_search, &num_to_search)) {
+        if (Heightmap_neighbors(map, current_index, &points_to_search)) {
             printf("Error with Heightmap_neighbors() called in search_basin() main loop.\n");
             exit(-1);
         }
-
-        /*printf("Basin: ");*/
-        /*print_array(basin, basin_size);*/
-        /*printf("Points to Search: ");*/
-        /*print_array(points_to_search, num_to_search);*/
     }
 
+    int basin_size = basin.size;
+    IntVector_free(&basin);
+    IntVector_free(&points_to_search);
     return basin_size;
 }
 
@@ -435,8 +437,7 @@ int evaluate_basins(struct Heightmap *map)
         }
     }
     array_sort_descending(basin_sizes, map->num_low_points, 3);
-    printf("Top 3 Basins: ");
-    print_array(basin_sizes, 3);
+    memcpy(map->top_basins, basin_sizes, sizeof(map->top_basins));
 
     map->basin_score = basin_sizes[0] * basin_sizes[1] * basin_sizes[2];
 
@@ -457,21 +458,52 @@ void Heightmap_info(struct Heightmap *map)
     if (!evaluate_risk(map))
         printf("RISK RATING: %u\n", map->risk);
     evaluate_basins(map);
+    printf("Top 3 Basins: ");
+    print_array(map->top_basins, 3);
     printf("BASIN SCORE: %d\n", map->basin_score);
     printf("-------\n");
 }
 
+void *day9_parse(const char *input, size_t size)
+{
+    return Heightmap_parse(input, size);
+}
+
+void day9_part1(void *map, char answer[ANSWER_LEN])
+{
+    evaluate_risk(map);
+    snprintf(answer, ANSWER_LEN, "%u", ((struct Heightmap *)map)->risk);
+}
+
+void day9_part2(void *map, char answer[ANSWER_LEN])
+{
+    evaluate_basins(map);
+    snprintf(answer, ANSWER_LEN, "%u", ((struct Heightmap *)map)->basin_score);
+}
+
+void day9_free(void *map)
+{
+    Heightmap_destroy(map);
+}
+
+const struct Solver day9_solver = {
+    "9", day9_parse, day9_part1, day9_part2, day9_free, 1
+};
+
+#ifndef AOC_DRIVER
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench_main(&day9_solver, argc - 1, argv + 1);
+
     struct Heightmap *test_map = Heightmap_create("data/9test");
     Heightmap_info(test_map);
     Heightmap_destroy(test_map);
-    free(test_map);
     
     struct Heightmap *data_map = Heightmap_create("data/9data");
     Heightmap_info(data_map);
     Heightmap_destroy(data_map);
-    free(data_map);
 
     return 0;
 }
+#endif
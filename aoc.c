@@ -0,0 +1,211 @@
+/* One binary for every day
+
+Every day registers its parse, part 1 and part 2 functions as a struct
+Solver, and the days are built with AOC_DRIVER so that their own main()
+is left out and they can all be linked together. Solving hundreds of
+inputs then takes one process rather than hundreds: the inputs are
+solved in parallel on one thread pool and the answers are printed in
+the order the files were given. Answers can be cached on disk, see
+cache.h, so that inputs solved before cost only a hash.
+
+usage: aoc [-j N] [--cache | --verify] <day> file...
+       aoc <day> --bench [options] file...
+       aoc --clear-cache [day]
+
+    -j N            number of threads, default one per processor
+    --cache         use cached answers and cache new ones
+    --verify        solve every input and check the answers against the
+                    cache, exiting with 1 if any differ
+
+Inputs that cannot be read, or that the day cannot parse, are reported
+and skipped, and aoc exits with 1.
+    --bench         time the day's phases instead, see bench.h
+    --clear-cache   delete the cached answers of one or every day
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util.h"
+#include "bench.h"
+#include "cache.h"
+#include "solvers.h"
+
+enum CacheMode { CACHE_OFF, CACHE_USE, CACHE_VERIFY };
+
+struct Run {
+    const char *path;
+    uint64_t ns[BENCH_NUM_PHASES];
+    char answers[2][ANSWER_LEN];
+    int cached;                 // answers came from the cache
+    int invalid;                // the day could not parse the input
+    int read_error;             // errno if the input could not be read
+    int mismatch;               // verify found different cached answers
+    char cached_answers[2][ANSWER_LEN];
+};
+
+struct Batch {
+    const struct Solver *solver;
+    enum CacheMode cache;
+    struct Run *runs;
+};
+
+void solve_task(void *ctx, int task)
+{
+    struct Batch *batch = ctx;
+    const struct Solver *solver = batch->solver;
+    struct Run *run = &batch->runs[task];
+    int num_parts = (solver->part2 != NULL) ? 2 : 1;
+    size_t size;
+    char *input = try_read_file(run->path, &size);
+    if (input == NULL) {
+        run->read_error = errno;
+        return;
+    }
+
+    uint64_t hash = 0;
+    int found = 0;
+    if (batch->cache != CACHE_OFF) {
+        hash = xxh64(input, size, 0);
+        run->cached_answers[1][0] = '\0';
+        for (found = 0; found < num_parts; found++) {
+            if (!cache_load(solver, found + 1, hash, run->cached_answers[found]))
+                break;
+        }
+    }
+    if (batch->cache == CACHE_USE && found == num_parts) {
+        memcpy(run->answers, run->cached_answers, sizeof(run->answers));
+        run->cached = 1;
+        free(input);
+        return;
+    }
+
+    run->invalid = bench_run_once(solver, input, size, run->ns, run->answers) < 0;
+    free(input);
+    if (batch->cache == CACHE_OFF || run->invalid)
+        return;
+    for (int part = 0; part < num_parts; part++) {
+        if (part >= found)
+            cache_store(solver, part + 1, hash, run->answers[part]);
+        else if (strcmp(run->answers[part], run->cached_answers[part]) != 0)
+            run->mismatch = 1;
+    }
+}
+
+/*
+* Print an answer after its label, starting multi line answers on a line
+* of their own
+*/
+void print_answer(int part, const char *answer)
+{
+    printf("Part %d:%s%s\n", part, strchr(answer, '\n') ? "\n" : " ", answer);
+}
+
+void usage(void)
+{
+    printf("usage: aoc [-j N] [--cache | --verify] <day> file...\n"
+           "       aoc <day> --bench [options] file...\n"
+           "       aoc --clear-cache [day]\n"
+           "days:");
+    for (int i = 0; i < NUM_SOLVERS; i++)
+        printf(" %s", solvers[i]->day);
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int num_threads = 0;
+    enum CacheMode cache = CACHE_OFF;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--clear-cache") == 0) {
+        const char *day = NULL;
+        if (arg + 1 < argc) {
+            const struct Solver *solver = find_solver(argv[arg + 1]);
+            if (solver == NULL) {
+                printf("Error: No solution for day %s.\n", argv[arg + 1]);
+                return 1;
+            }
+            day = solver->day;
+        }
+        printf("Removed %d cached answers from %s.\n", cache_clear(day), cache_dir());
+        return 0;
+    }
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (strcmp(argv[arg], "-j") == 0 && arg + 1 < argc) {
+            num_threads = atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "--cache") == 0) {
+            cache = CACHE_USE;
+        } else if (strcmp(argv[arg], "--verify") == 0) {
+            cache = CACHE_VERIFY;
+        } else {
+            printf("Error: Unknown option %s.\n", argv[arg]);
+            usage();
+            return 1;
+        }
+    }
+    if (arg >= argc) {
+        usage();
+        return 1;
+    }
+    const struct Solver *solver = find_solver(argv[arg]);
+    if (solver == NULL) {
+        printf("Error: No solution for day %s.\n", argv[arg]);
+        usage();
+        return 1;
+    }
+    arg++;
+    if (arg < argc && strcmp(argv[arg], "--bench") == 0)
+        return bench_main(solver, argc - arg, argv + arg);
+    if (arg >= argc) {
+        usage();
+        return 1;
+    }
+
+    int num_runs = argc - arg;
+    struct Batch batch = { solver, cache, calloc(num_runs, sizeof(struct Run)) };
+    if (batch.runs == NULL) {
+        printf("Error: Out of memory for %d inputs.\n", num_runs);
+        exit(-1);
+    }
+    for (int i = 0; i < num_runs; i++)
+        batch.runs[i].path = argv[arg + i];
+
+    struct ThreadPool *pool = ThreadPool_create(num_threads);
+    ThreadPool_run(pool, solve_task, &batch, num_runs);
+    ThreadPool_destroy(pool);
+
+    int num_mismatches = 0, num_invalid = 0;
+    for (int i = 0; i < num_runs; i++) {
+        struct Run *run = &batch.runs[i];
+        uint64_t total = run->ns[0] + run->ns[1] + run->ns[2];
+        if (run->read_error) {
+            printf("%s: Error: Could not read it: %s.\n", run->path,
+                    strerror(run->read_error));
+            num_invalid++;
+            continue;
+        }
+        if (run->invalid) {
+            printf("%s: Error: Not a day %s input.\n", run->path, solver->day);
+            num_invalid++;
+            continue;
+        }
+        if (run->cached)
+            printf("%s (day %s, cached)\n", run->path, solver->day);
+        else
+            printf("%s (day %s, %.3f ms)\n", run->path, solver->day, total / 1e6);
+        print_answer(1, run->answers[0]);
+        if (solver->part2 != NULL)
+            print_answer(2, run->answers[1]);
+        if (run->mismatch) {
+            printf("Error: The cache has different answers:\n");
+            print_answer(1, run->cached_answers[0]);
+            if (solver->part2 != NULL)
+                print_answer(2, run->cached_answers[1]);
+            num_mismatches++;
+        }
+    }
+    if (cache == CACHE_VERIFY)
+        printf("Verified %d inputs, %d differ from the cache.\n", num_runs,
+                num_mismatches);
+    free(batch.runs);
+    return (num_mismatches > 0 || num_invalid > 0) ? 1 : 0;
+}
@@ -0,0 +1,811 @@
+/* Solver daemon
+
+Every run of a day's binary, or of aoc, pays for exec, page faults and
+stdio before it parses a single line, which is most of the time spent on
+a small input. aocd pays for that once: it links every day like aoc,
+starts its thread pool and then solves inputs sent to it over a local
+Unix socket until it is stopped, so a request costs little more than
+the solve itself.
+
+usage: aocd [-j N] [--socket PATH]
+       aocd [--socket PATH] --send [--part N] <day> file...
+
+    -j N            number of threads, default one per processor
+    --socket PATH   socket to listen on or connect to, default $AOC_SOCKET
+                    or .aoc-socket in the current directory
+    --send          solve the files with the running daemon, sending every
+                    request before reading any answer
+    --part N        solve part 1 or part 2 only, default both
+
+Both ends are on the same machine, so frames are in its byte order. A
+request is a struct AocdRequest followed by size bytes of input. Its
+response is a struct AocdResponse followed by the answers to part 1 and
+part 2, lengths[0] and lengths[1] bytes long and not zero terminated.
+Part 2 alone still runs part 1 first, as some days carry on from it.
+
+A client may send any number of requests without waiting for answers.
+Each connection is answered in the order its requests were sent, with
+their ids echoed. Requests are solved in parallel on worker threads as
+they arrive, while the main thread keeps reading and writing, so a slow
+request only holds up the answers after it on its own connection. The
+requests still waiting for a worker when their client hangs up are
+dropped. A request for a day that is not solved gets AOCD_UNKNOWN_DAY,
+and an input the day's parser rejects gets AOCD_BAD_REQUEST; the
+connection carries on with its next request in both cases. Parsers
+reject inputs they cannot read and values their engines have no room
+for, such as day 4 numbers above its MAX_NUMBER, but a solve that runs
+out of memory still stops the daemon, and one that never finishes holds
+its worker until it is stopped. A frame with
+the wrong magic number, an unknown part or more than AOCD_MAX_INPUT
+bytes also gets AOCD_BAD_REQUEST, but the connection is closed, since
+the rest of the stream can no longer be framed. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "util.h"
+#include "bench.h"
+#include "solvers.h"
+
+#define AOCD_MAGIC 0x31434f41u          // "AOC1" on a little endian machine
+#define AOCD_MAX_INPUT (64u << 20)
+#define AOCD_SOCKET ".aoc-socket"
+#define AOCD_MAX_DAY 25
+#define AOCD_READ_SIZE 65536
+
+enum AocdStatus { AOCD_OK, AOCD_UNKNOWN_DAY, AOCD_BAD_REQUEST };
+
+struct AocdRequest {
+    uint32_t magic;
+    uint32_t id;                // echoed in the response
+    uint8_t day;
+    uint8_t part;               // 1 or 2, 0 for both
+    uint16_t reserved;
+    uint32_t size;              // bytes of input that follow
+};
+
+struct AocdResponse {
+    uint32_t magic;
+    uint32_t id;
+    uint32_t status;            // enum AocdStatus
+    uint32_t lengths[2];        // bytes of each answer that follow
+    uint32_t reserved;
+    uint64_t ns[BENCH_NUM_PHASES];  // time to parse and solve each part
+    uint64_t latency_ns;        // from the request arriving to its answer
+};
+
+DEFINE_VECTOR(ByteVector, char)
+
+/* A request being solved. Jobs are owned by the main thread, apart from
+   the time between being queued and being marked done, when a worker
+   has them. Their input buffers are kept for later requests. */
+struct Job {
+    struct Job *next;           // next job of the same client
+    struct Job *next_queued;    // next job waiting for a worker
+    struct AocdRequest request;
+    char *input;                // zero terminated copy of the input
+    size_t input_capacity;
+    uint64_t arrived;
+    int done;                   // solved, under Workers.lock
+    int cancelled;              // client gone, under Workers.lock
+    struct AocdResponse response;
+    char answers[2][ANSWER_LEN];
+};
+
+struct Client {
+    int fd;
+    struct ByteVector in;       // received, framed up to in_start
+    size_t in_start;
+    struct ByteVector out;      // to send, sent up to out_start
+    size_t out_start;
+    struct Job *first;          // jobs not yet answered, in request order
+    struct Job *last;
+    int closing;                // nothing more to read, close once sent
+    int dead;                   // close once no worker has its jobs
+};
+
+DEFINE_VECTOR(ClientVector, struct Client)
+DEFINE_VECTOR(PollVector, struct pollfd)
+
+/* Jobs waiting for a worker, linked by next_queued, oldest first */
+struct JobQueue {
+    struct Job *first;
+    struct Job *last;
+};
+
+/* Threads that solve jobs from a queue and wake the main thread through
+   a pipe whenever one is done */
+struct Workers {
+    int num_threads;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t job_ready;
+    struct JobQueue queue;
+    int shutdown;
+    int wake[2];                // pipe, read end polled by the main thread
+};
+
+// solvers by day number, NULL for days not solved
+static const struct Solver *day_solvers[AOCD_MAX_DAY + 1];
+
+static volatile sig_atomic_t stopping = 0;
+
+static void stop(int signal)
+{
+    (void)signal;
+    stopping = 1;
+}
+
+static void bytes_append(struct ByteVector *bytes, const void *data, size_t len)
+{
+    if (bytes->size + len > bytes->capacity)
+        ByteVector_reserve(bytes, CONTAINER_GROW(bytes->capacity, bytes->size + len));
+    memcpy(bytes->data + bytes->size, data, len);
+    bytes->size += len;
+}
+
+/*
+* Drop the first bytes of a buffer
+*
+* @param    bytes       the buffer
+* @param    start       number of bytes to drop, set to 0
+*/
+static void bytes_consume(struct ByteVector *bytes, size_t *start)
+{
+    if (*start == 0)
+        return;
+    bytes->size -= *start;
+    memmove(bytes->data, bytes->data + *start, bytes->size);
+    *start = 0;
+}
+
+/*
+* Add a job to the end of a client's jobs, reusing a spare one
+*
+* @param    client      the client
+* @param    spare       answered jobs, kept for their input buffers
+* @retval   job         the job
+*/
+static struct Job *next_job(struct Client *client, struct Job **spare)
+{
+    struct Job *job = *spare;
+    if (job != NULL) {
+        *spare = job->next;
+    } else {
+        job = calloc(1, sizeof(struct Job));
+        if (job == NULL) {
+            printf("Error: Out of memory for a job.\n");
+            exit(-1);
+        }
+    }
+    job->next = job->next_queued = NULL;
+    job->done = job->cancelled = 0;
+    if (client->last != NULL)
+        client->last->next = job;
+    else
+        client->first = job;
+    client->last = job;
+    return job;
+}
+
+static const char *socket_path(const char *path)
+{
+    if (path == NULL)
+        path = getenv("AOC_SOCKET");
+    return (path != NULL && *path) ? path : AOCD_SOCKET;
+}
+
+static struct sockaddr_un socket_address(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("Error: Socket path %s is too long.\n", path);
+        exit(-1);
+    }
+    strcpy(addr.sun_path, path);
+    return addr;
+}
+
+/*
+* Connect to a daemon
+*
+* @param    path        the daemon's socket
+* @retval   fd          the connection, -1 with errno set on failure
+*/
+static int connect_to(const char *path)
+{
+    struct sockaddr_un addr = socket_address(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+/*
+* Listen on a socket, replacing the socket file of a daemon that is no
+* longer running
+*
+* @param    path        the socket
+* @retval   fd          the listening socket, non-blocking
+*/
+static int listen_on(const char *path)
+{
+    struct sockaddr_un addr = socket_address(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        printf("Error: Could not create a socket: %s\n", strerror(errno));
+        exit(-1);
+    }
+    int bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    if (!bound && errno == EADDRINUSE) {
+        int other = connect_to(path);
+        if (other >= 0) {
+            printf("Error: A daemon is already listening on %s.\n", path);
+            exit(-1);
+        }
+        if (errno == ECONNREFUSED)
+            unlink(path);
+        bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    }
+    if (!bound || listen(fd, SOMAXCONN) != 0) {
+        printf("Error: Could not listen on %s: %s\n", path, strerror(errno));
+        exit(-1);
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+/*
+* Read what a client has sent, without blocking
+*
+* @param    client      the client, marked closing at end of stream and
+*                       dead on an error
+*/
+static void client_read(struct Client *client)
+{
+    while (!client->closing) {
+        ByteVector_reserve(&client->in, client->in.size + AOCD_READ_SIZE);
+        ssize_t len = read(client->fd, client->in.data + client->in.size,
+                client->in.capacity - client->in.size);
+        if (len > 0)
+            client->in.size += len;
+        else if (len == 0)
+            client->closing = 1;
+        else if (errno == EINTR)
+            continue;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return;
+        else
+            client->dead = 1;
+        if (len <= 0)
+            return;
+    }
+}
+
+/* Send what is waiting for a client, without blocking */
+static void client_write(struct Client *client)
+{
+    while (client->out_start < client->out.size) {
+        ssize_t len = write(client->fd, client->out.data + client->out_start,
+                client->out.size - client->out_start);
+        if (len > 0) {
+            client->out_start += len;
+        } else if (len < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                client->dead = 1;
+            break;
+        }
+    }
+    bytes_consume(&client->out, &client->out_start);
+}
+
+static void JobQueue_append(struct JobQueue *queue, struct JobQueue *jobs)
+{
+    if (jobs->first == NULL)
+        return;
+    if (queue->last != NULL)
+        queue->last->next_queued = jobs->first;
+    else
+        queue->first = jobs->first;
+    queue->last = jobs->last;
+}
+
+/*
+* Turn the complete requests a client has sent into jobs. Jobs to solve
+* are queued for the workers, the others are done already.
+*
+* @param    client      the client
+* @param    spare       answered jobs to reuse
+* @param    queued      queue to add the jobs to solve to
+* @param    now         time the requests are taken to have arrived
+*/
+static void frame_requests(struct Client *client, struct Job **spare,
+        struct JobQueue *queued, uint64_t now)
+{
+    struct AocdRequest request;
+    while (client->in.size - client->in_start >= sizeof(request)) {
+        memcpy(&request, client->in.data + client->in_start, sizeof(request));
+        int bad = request.magic != AOCD_MAGIC || request.part > 2
+            || request.size > AOCD_MAX_INPUT;
+        if (!bad && client->in.size - client->in_start < sizeof(request) + request.size)
+            break;
+
+        struct Job *job = next_job(client, spare);
+        job->request = request;
+        job->arrived = now;
+        memset(&job->response, 0, sizeof(job->response));
+        job->response.magic = AOCD_MAGIC;
+        job->response.id = request.id;
+        if (bad) {
+            job->response.status = AOCD_BAD_REQUEST;
+            job->done = 1;
+            client->closing = 1;
+            client->in.size = client->in_start = 0;
+            return;
+        }
+        if (request.day > AOCD_MAX_DAY || day_solvers[request.day] == NULL) {
+            job->response.status = AOCD_UNKNOWN_DAY;
+            job->done = 1;
+            client->in_start += sizeof(request) + request.size;
+            continue;
+        }
+
+        if (request.size + 1 > job->input_capacity) {
+            free(job->input);
+            job->input_capacity = request.size + 1;
+            job->input = malloc(job->input_capacity);
+            if (job->input == NULL) {
+                printf("Error: Out of memory for a %u byte input.\n", request.size);
+                exit(-1);
+            }
+        }
+        memcpy(job->input, client->in.data + client->in_start + sizeof(request),
+                request.size);
+        job->input[request.size] = '\0';
+        client->in_start += sizeof(request) + request.size;
+        struct JobQueue one = { job, job };
+        JobQueue_append(queued, &one);
+    }
+    bytes_consume(&client->in, &client->in_start);
+}
+
+void solve_job(struct Job *job)
+{
+    struct AocdResponse *response = &job->response;
+    const struct Solver *solver = day_solvers[job->request.day];
+    job->answers[0][0] = job->answers[1][0] = '\0';
+    uint64_t start = bench_now();
+    void *puzzle = solver->parse(job->input, job->request.size);
+    uint64_t parsed = bench_now();
+    if (puzzle == NULL) {
+        response->status = AOCD_BAD_REQUEST;
+        response->latency_ns = bench_now() - job->arrived;
+        return;
+    }
+    solver->part1(puzzle, job->answers[0]);
+    uint64_t solved1 = bench_now(), solved2 = solved1;
+    if (job->request.part != 1 && solver->part2 != NULL) {
+        solver->part2(puzzle, job->answers[1]);
+        solved2 = bench_now();
+    }
+    solver->free_puzzle(puzzle);
+
+    if (job->request.part == 2)
+        job->answers[0][0] = '\0';
+    response->ns[0] = parsed - start;
+    response->ns[1] = solved1 - parsed;
+    response->ns[2] = solved2 - solved1;
+    response->lengths[0] = strlen(job->answers[0]);
+    response->lengths[1] = strlen(job->answers[1]);
+    response->latency_ns = bench_now() - job->arrived;
+}
+
+static void *Workers_run(void *arg)
+{
+    struct Workers *workers = arg;
+    pthread_mutex_lock(&workers->lock);
+    while (1) {
+        while (workers->queue.first == NULL && !workers->shutdown)
+            pthread_cond_wait(&workers->job_ready, &workers->lock);
+        if (workers->shutdown)
+            break;
+        struct Job *job = workers->queue.first;
+        workers->queue.first = job->next_queued;
+        if (workers->queue.first == NULL)
+            workers->queue.last = NULL;
+        if (!job->cancelled) {
+            pthread_mutex_unlock(&workers->lock);
+            solve_job(job);
+            pthread_mutex_lock(&workers->lock);
+        }
+        job->done = 1;
+        // a full pipe already has a wakeup waiting
+        char byte = 0;
+        if (write(workers->wake[1], &byte, 1) < 0 && errno != EAGAIN)
+            printf("Error: Could not wake the main thread: %s\n", strerror(errno));
+    }
+    pthread_mutex_unlock(&workers->lock);
+    return NULL;
+}
+
+/*
+* Start the worker threads. They do not take SIGINT or SIGTERM, which
+* leaves those to interrupt the main thread's poll().
+*
+* @param    workers     the workers to start
+* @param    num_threads number of threads, 0 for one per processor
+*/
+static void Workers_start(struct Workers *workers, int num_threads)
+{
+    if (num_threads <= 0)
+        num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads <= 0)
+        num_threads = 1;
+    memset(workers, 0, sizeof(*workers));
+    workers->num_threads = num_threads;
+    pthread_mutex_init(&workers->lock, NULL);
+    pthread_cond_init(&workers->job_ready, NULL);
+    if (pipe(workers->wake) != 0) {
+        printf("Error: Could not create a pipe: %s\n", strerror(errno));
+        exit(-1);
+    }
+    fcntl(workers->wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(workers->wake[1], F_SETFL, O_NONBLOCK);
+
+    sigset_t blocked, old;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &blocked, &old);
+    workers->threads = malloc(num_threads * sizeof(pthread_t));
+    assert(workers->threads != NULL);
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_create(&workers->threads[i], NULL, Workers_run, workers) != 0) {
+            printf("Error: Could not start worker thread %d.\n", i);
+            exit(-1);
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+/* Stop the workers once they have finished the jobs they are solving */
+static void Workers_stop(struct Workers *workers)
+{
+    pthread_mutex_lock(&workers->lock);
+    workers->shutdown = 1;
+    pthread_cond_broadcast(&workers->job_ready);
+    pthread_mutex_unlock(&workers->lock);
+    for (int i = 0; i < workers->num_threads; i++)
+        pthread_join(workers->threads[i], NULL);
+    pthread_mutex_destroy(&workers->lock);
+    pthread_cond_destroy(&workers->job_ready);
+    close(workers->wake[0]);
+    close(workers->wake[1]);
+    free(workers->threads);
+}
+
+static void Workers_queue(struct Workers *workers, struct JobQueue *jobs)
+{
+    if (jobs->first == NULL)
+        return;
+    pthread_mutex_lock(&workers->lock);
+    JobQueue_append(&workers->queue, jobs);
+    pthread_cond_broadcast(&workers->job_ready);
+    pthread_mutex_unlock(&workers->lock);
+}
+
+/*
+* Answer a client's jobs that are done, up to the first that is not, and
+* keep them as spares. The queued jobs of a dead client are cancelled.
+* Called with the workers' lock held.
+*
+* @param    client      the client
+* @param    spare       answered jobs to add to
+* @retval   count       number of jobs answered
+*/
+static int answer_jobs(struct Client *client, struct Job **spare)
+{
+    int count = 0;
+    struct Job *job;
+    if (client->dead) {
+        for (job = client->first; job != NULL; job = job->next)
+            job->cancelled = 1;
+    }
+    while ((job = client->first) != NULL && job->done) {
+        if (!client->dead) {
+            bytes_append(&client->out, &job->response, sizeof(job->response));
+            bytes_append(&client->out, job->answers[0], job->response.lengths[0]);
+            bytes_append(&client->out, job->answers[1], job->response.lengths[1]);
+        }
+        client->first = job->next;
+        if (client->first == NULL)
+            client->last = NULL;
+        job->next = *spare;
+        *spare = job;
+        count++;
+    }
+    return count;
+}
+
+static void free_jobs(struct Job *job)
+{
+    while (job != NULL) {
+        struct Job *next = job->next;
+        free(job->input);
+        free(job);
+        job = next;
+    }
+}
+
+/*
+* Serve requests until SIGINT or SIGTERM
+*
+* @param    path        socket to listen on
+* @param    num_threads threads to solve on, 0 for one per processor
+* @retval   status      exit status
+*/
+int serve(const char *path, int num_threads)
+{
+    for (int i = 0; i < NUM_SOLVERS; i++)
+        day_solvers[atoi(solvers[i]->day)] = solvers[i];
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listener = listen_on(path);
+    struct Workers workers;
+    Workers_start(&workers, num_threads);
+    printf("Listening on %s with %d threads.\n", path, workers.num_threads);
+    fflush(stdout);
+
+    struct ClientVector clients = { 0 };
+    struct PollVector polls = { 0 };
+    struct Job *spare = NULL;
+    unsigned long long num_requests = 0;
+    while (!stopping) {
+        polls.size = 0;
+        PollVector_push(&polls, (struct pollfd){ listener, POLLIN, 0 });
+        PollVector_push(&polls, (struct pollfd){ workers.wake[0], POLLIN, 0 });
+        for (size_t c = 0; c < clients.size; c++) {
+            struct Client *client = &clients.data[c];
+            short events = client->closing ? 0 : POLLIN;
+            if (client->out.size > 0)
+                events |= POLLOUT;
+            // dead clients are only kept until their jobs are done
+            int fd = client->dead ? -1 : client->fd;
+            PollVector_push(&polls, (struct pollfd){ fd, events, 0 });
+        }
+        if (poll(polls.data, polls.size, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            printf("Error: poll() failed: %s\n", strerror(errno));
+            exit(-1);
+        }
+
+        uint64_t now = bench_now();
+        struct JobQueue queued = { 0 };
+        for (size_t c = 0; c < clients.size; c++) {
+            struct Client *client = &clients.data[c];
+            short revents = polls.data[c + 2].revents;
+            if (revents & (POLLIN | POLLHUP | POLLERR))
+                client_read(client);
+            // the other end is closed, so no answer would arrive
+            if (revents & POLLHUP)
+                client->dead = 1;
+            if (!client->dead)
+                frame_requests(client, &spare, &queued, now);
+        }
+        Workers_queue(&workers, &queued);
+        if (polls.data[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listener, NULL, NULL)) >= 0) {
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                ClientVector_push(&clients, (struct Client){ .fd = fd });
+            }
+        }
+
+        char drain[64];
+        if (polls.data[1].revents & POLLIN)
+            while (read(workers.wake[0], drain, sizeof(drain)) > 0)
+                ;
+        pthread_mutex_lock(&workers.lock);
+        for (size_t c = 0; c < clients.size; c++)
+            num_requests += answer_jobs(&clients.data[c], &spare);
+        pthread_mutex_unlock(&workers.lock);
+
+        size_t kept = 0;
+        for (size_t c = 0; c < clients.size; c++) {
+            struct Client *client = &clients.data[c];
+            if (!client->dead)
+                client_write(client);
+            int finished = client->dead
+                || (client->closing && client->first == NULL && client->out.size == 0);
+            if (finished && client->first == NULL) {
+                close(client->fd);
+                ByteVector_free(&client->in);
+                ByteVector_free(&client->out);
+            } else {
+                clients.data[kept++] = *client;
+            }
+        }
+        clients.size = kept;
+    }
+
+    Workers_stop(&workers);
+    for (size_t c = 0; c < clients.size; c++) {
+        close(clients.data[c].fd);
+        ByteVector_free(&clients.data[c].in);
+        ByteVector_free(&clients.data[c].out);
+        free_jobs(clients.data[c].first);
+    }
+    free_jobs(spare);
+    ClientVector_free(&clients);
+    PollVector_free(&polls);
+    close(listener);
+    unlink(path);
+    printf("Stopped after %llu requests.\n", num_requests);
+    return 0;
+}
+
+/*
+* Read or write all of a buffer
+*
+* @param    fd          blocking socket
+* @param    data        the buffer
+* @param    len         bytes to transfer
+* @param    writing     1 to write, 0 to read
+* @retval   done        1 if every byte was transferred, 0 if not
+*/
+static int transfer_all(int fd, void *data, size_t len, int writing)
+{
+    char *p = data;
+    while (len > 0) {
+        ssize_t n = writing ? write(fd, p, len) : read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+/*
+* Print an answer after its label, starting multi line answers on a line
+* of their own
+*/
+void print_answer(int part, const char *answer)
+{
+    printf("Part %d:%s%s\n", part, strchr(answer, '\n') ? "\n" : " ", answer);
+}
+
+/*
+* Solve files with a running daemon. Every request is sent before any
+* answer is read, which the daemon's buffering allows.
+*
+* @param    path        the daemon's socket
+* @param    day         day to solve
+* @param    part        1 or 2, 0 for both
+* @param    num_files   number of files
+* @param    files       the input files
+* @retval   status      exit status, 1 if any request failed
+*/
+int send_files(const char *path, int day, int part, int num_files, char *files[])
+{
+    int fd = connect_to(path);
+    if (fd < 0) {
+        printf("Error: Could not connect to %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    uint64_t start = bench_now();
+    for (int i = 0; i < num_files; i++) {
+        size_t size;
+        char *input = read_file(files[i], &size);
+        struct AocdRequest request = { AOCD_MAGIC, i, day, part, 0, size };
+        int sent = transfer_all(fd, &request, sizeof(request), 1)
+            && transfer_all(fd, input, size, 1);
+        free(input);
+        if (!sent) {
+            printf("Error: Could not send %s: %s\n", files[i], strerror(errno));
+            close(fd);
+            return 1;
+        }
+    }
+
+    int num_failed = 0;
+    char answers[2][ANSWER_LEN];
+    for (int i = 0; i < num_files; i++) {
+        struct AocdResponse response;
+        if (!transfer_all(fd, &response, sizeof(response), 0)
+                || response.magic != AOCD_MAGIC || response.id != (uint32_t)i
+                || response.lengths[0] >= ANSWER_LEN || response.lengths[1] >= ANSWER_LEN
+                || !transfer_all(fd, answers[0], response.lengths[0], 0)
+                || !transfer_all(fd, answers[1], response.lengths[1], 0)) {
+            printf("Error: Lost the daemon's answers after %d of %d inputs.\n", i,
+                    num_files);
+            close(fd);
+            return 1;
+        }
+        if (response.status != AOCD_OK) {
+            printf("%s: Error: %s.\n", files[i], response.status == AOCD_UNKNOWN_DAY
+                    ? "No solution for that day" : "Bad request");
+            num_failed++;
+            continue;
+        }
+        answers[0][response.lengths[0]] = '\0';
+        answers[1][response.lengths[1]] = '\0';
+        uint64_t total = response.ns[0] + response.ns[1] + response.ns[2];
+        printf("%s (day %d, %.1f us, %.1f us in the daemon)\n", files[i], day,
+                total / 1e3, response.latency_ns / 1e3);
+        if (part != 2)
+            print_answer(1, answers[0]);
+        if (part != 1 && response.lengths[1] > 0)
+            print_answer(2, answers[1]);
+    }
+    uint64_t elapsed = bench_now() - start;
+    printf("%d inputs in %.3f ms, %.1f us each.\n", num_files, elapsed / 1e6,
+            elapsed / 1e3 / num_files);
+    close(fd);
+    return num_failed > 0;
+}
+
+void usage(void)
+{
+    printf("usage: aocd [-j N] [--socket PATH]\n"
+           "       aocd [--socket PATH] --send [--part N] <day> file...\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int num_threads = 0, part = 0, sending = 0;
+    const char *path = NULL;
+    int arg;
+    for (arg = 1; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (strcmp(argv[arg], "-j") == 0 && arg + 1 < argc) {
+            num_threads = atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "--socket") == 0 && arg + 1 < argc) {
+            path = argv[++arg];
+        } else if (strcmp(argv[arg], "--send") == 0) {
+            sending = 1;
+        } else if (strcmp(argv[arg], "--part") == 0 && arg + 1 < argc) {
+            part = atoi(argv[++arg]);
+        } else {
+            printf("Error: Unknown option %s.\n", argv[arg]);
+            usage();
+            return 1;
+        }
+    }
+    path = socket_path(path);
+    if (!sending) {
+        if (arg < argc) {
+            usage();
+            return 1;
+        }
+        return serve(path, num_threads);
+    }
+    if (arg + 1 >= argc || part < 0 || part > 2) {
+        usage();
+        return 1;
+    }
+    return send_files(path, atoi(argv[arg]), part, argc - arg - 1, argv + arg + 1);
+}
@@ -0,0 +1,551 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "util.h"
+#ifdef BENCH_PERF
+#include "perf.h"
+#endif
+
+/* Benchmark harness shared by every day. A day describes its solution
+   as a struct Solver, split into the phases that get timed separately:
+   parse turns the raw input into the day's puzzle state, part1 and part2
+   write their answers as text (part2 is NULL for a day that is only half
+   solved). Each run parses a fresh copy of the input and then solves both
+   parts in order on that state, so days whose second part carries on from
+   the first (the octopuses, the polymer) work as-is.
+
+   A day hands its command line to bench_main() when it is started with
+   --bench:
+
+       ./11 --bench [--warmup N] [--repeat N] [--format table|csv|json]
+                    [--build NAME] [--no-header] file...
+
+   Warmup runs are not recorded. --build labels the rows with the build
+   they came from and --no-header leaves out the table or csv header, so
+   the output of several days and builds adds up to one table. json is
+   written as JSON Lines, one object per phase and no enclosing array, so
+   it also adds up across runs. For each phase the harness reports the
+   fastest, the median and the 99th percentile run, in nanoseconds for
+   csv and json.
+
+   Built with -DBENCH_PERF, each phase is also wrapped in the hardware
+   counters of perf.h, and the median cycles, instructions, L1 and last
+   level cache misses, branch misses and page faults of each phase are
+   reported next to its times. Without it the counters cost nothing, as
+   there is no code for them.
+
+   Built with -DTRACK_ALLOC, each phase also reports the median number of
+   allocations and bytes allocated, the peak of the tracked heap and the
+   peak resident set size (see util.h), and a solver that does not free
+   all it allocated is reported. These figures, like the counters, are
+   kept for one run at a time, so they are only right when the runs do
+   not overlap, as under bench_main(). */
+
+#define ANSWER_LEN 4096
+#define BENCH_NUM_PHASES 3
+#define BENCH_WARMUP 1
+#define BENCH_REPEAT 10
+#define BENCH_NUM_ALLOC 4
+
+/*
+* A day's solution. The input passed to parse is zero terminated and
+* stays valid until free_puzzle is called, so the puzzle may point into it.
+* parse returns NULL for an input it cannot solve, rather than exiting,
+* and the caller reports it; free_puzzle is not called on NULL.
+* The version goes up whenever a change could alter the day's answers,
+* which throws away any answers cached by an older version (see cache.h).
+*/
+struct Solver {
+    const char *day;
+    void *(*parse)(const char *input, size_t size);
+    void (*part1)(void *puzzle, char answer[ANSWER_LEN]);
+    void (*part2)(void *puzzle, char answer[ANSWER_LEN]);
+    void (*free_puzzle)(void *puzzle);
+    int version;
+};
+
+enum BenchFormat { BENCH_TABLE, BENCH_CSV, BENCH_JSON };
+
+struct BenchOptions {
+    int warmup;
+    int repeat;
+    enum BenchFormat format;
+    const char *build;          // label for the build being measured
+    int header;                 // 0 to leave out the header
+};
+
+static const char *const bench_phase_names[BENCH_NUM_PHASES] = {
+    "parse", "part1", "part2"
+};
+
+struct BenchStats {
+    uint64_t min;
+    uint64_t median;
+    uint64_t p99;
+};
+
+struct BenchResult {
+    const char *build;
+    const char *day;
+    const char *input;
+    int runs;
+    struct BenchStats phases[BENCH_NUM_PHASES];
+    char answers[2][ANSWER_LEN];
+#ifdef BENCH_PERF
+    uint64_t counts[BENCH_NUM_PHASES][PERF_NUM_COUNTERS];  // medians
+#endif
+#ifdef TRACK_ALLOC
+    uint64_t alloc[BENCH_NUM_PHASES][BENCH_NUM_ALLOC];      // medians
+    long long leaked;           // blocks a run left allocated
+#endif
+};
+
+#ifdef BENCH_PERF
+/* The counters are opened by bench_main(), so only its runs are counted,
+   and hold the counts of the phases of the last run */
+static struct PerfCounters bench_perf = { { -1, -1, -1, -1, -1, -1 } };
+static uint64_t bench_perf_counts[BENCH_NUM_PHASES][PERF_NUM_COUNTERS];
+#endif
+
+#ifdef TRACK_ALLOC
+static const char *const bench_alloc_names[BENCH_NUM_ALLOC] = {
+    "allocs", "alloc_bytes", "peak_heap", "peak_rss"
+};
+
+/* The allocation figures of the phases of the last run, and the blocks
+   it did not free */
+static struct AllocStats bench_alloc_before;
+static uint64_t bench_alloc[BENCH_NUM_PHASES][BENCH_NUM_ALLOC];
+static long long bench_alloc_leaked;
+#endif
+
+static inline void bench_phase_start(void)
+{
+#ifdef TRACK_ALLOC
+    alloc_reset_peak();
+    bench_alloc_before = alloc_stats;
+#endif
+#ifdef BENCH_PERF
+    PerfCounters_start(&bench_perf);
+#endif
+}
+
+static inline void bench_phase_stop(int phase)
+{
+#ifdef BENCH_PERF
+    PerfCounters_stop(&bench_perf, bench_perf_counts[phase]);
+#endif
+#ifdef TRACK_ALLOC
+    bench_alloc[phase][0] = alloc_stats.allocs - bench_alloc_before.allocs;
+    bench_alloc[phase][1] = alloc_stats.bytes - bench_alloc_before.bytes;
+    bench_alloc[phase][2] = alloc_stats.peak;
+    bench_alloc[phase][3] = alloc_peak_rss();
+#endif
+    (void)phase;
+}
+
+/*
+* Read the monotonic clock
+*
+* @retval   ns          nanoseconds since an arbitrary fixed point
+*/
+static inline uint64_t bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline int bench_compare_samples(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+* Summarise a set of samples. The percentile is the nearest rank, so with
+* fewer than 100 runs the 99th percentile is the slowest run.
+*
+* @param    samples     the samples (sorted in place)
+* @param    n           number of samples (> 0)
+* @retval   stats       min, median and 99th percentile
+*/
+static inline struct BenchStats bench_stats(uint64_t samples[], int n)
+{
+    qsort(samples, n, sizeof(uint64_t), bench_compare_samples);
+    struct BenchStats stats;
+    stats.min = samples[0];
+    stats.median = (n % 2) ? samples[n / 2]
+        : samples[n / 2 - 1] + (samples[n / 2] - samples[n / 2 - 1]) / 2;
+    int rank = (99 * n + 99) / 100;
+    stats.p99 = samples[rank - 1];
+    return stats;
+}
+
+/*
+* Parse an input, solve both parts and free the puzzle, timing each phase
+*
+* @param    solver      the day to run
+* @param    input       the input file contents
+* @param    size        size of the input
+* @param    ns          time taken by each phase (output)
+* @param    answers     the answers to part 1 and 2 (output)
+* @retval   0           success
+* @retval   -1          the day could not parse the input, nothing was solved
+*/
+static inline int bench_run_once(const struct Solver *solver, const char *input, size_t size,
+        uint64_t ns[BENCH_NUM_PHASES], char answers[2][ANSWER_LEN])
+{
+    answers[0][0] = answers[1][0] = '\0';
+#ifdef TRACK_ALLOC
+    long long blocks = alloc_stats.live_blocks;
+#endif
+    bench_phase_start();
+    uint64_t start = bench_now();
+    void *puzzle = solver->parse(input, size);
+    uint64_t parsed = bench_now();
+    bench_phase_stop(0);
+    if (puzzle == NULL) {
+        ns[0] = parsed - start;
+        ns[1] = ns[2] = 0;
+        return -1;
+    }
+
+    bench_phase_start();
+    uint64_t solving1 = bench_now();
+    solver->part1(puzzle, answers[0]);
+    uint64_t solved1 = bench_now();
+    bench_phase_stop(1);
+
+    bench_phase_start();
+    uint64_t solving2 = bench_now();
+    if (solver->part2 != NULL)
+        solver->part2(puzzle, answers[1]);
+    uint64_t solved2 = bench_now();
+    bench_phase_stop(2);
+    solver->free_puzzle(puzzle);
+#ifdef TRACK_ALLOC
+    bench_alloc_leaked = alloc_stats.live_blocks - blocks;
+#endif
+
+    ns[0] = parsed - start;
+    ns[1] = solved1 - solving1;
+    ns[2] = solved2 - solving2;
+    return 0;
+}
+
+/*
+* Benchmark a day on one input file
+*
+* @param    solver      the day to run
+* @param    path        input file
+* @param    options     warmup and repeat counts
+* @param    result      timings and answers (output)
+*/
+static inline void bench_solver(const struct Solver *solver, const char *path,
+        const struct BenchOptions *options, struct BenchResult *result)
+{
+    size_t size;
+    char *input = read_file(path, &size);
+    int repeat = (options->repeat > 0) ? options->repeat : 1;
+    uint64_t *samples = malloc(BENCH_NUM_PHASES * repeat * sizeof(uint64_t));
+#ifdef BENCH_PERF
+    uint64_t *count_samples = malloc(BENCH_NUM_PHASES * PERF_NUM_COUNTERS
+            * repeat * sizeof(uint64_t));
+    assert(count_samples != NULL);
+#endif
+#ifdef TRACK_ALLOC
+    uint64_t *alloc_samples = malloc(BENCH_NUM_PHASES * BENCH_NUM_ALLOC * repeat
+            * sizeof(uint64_t));
+    assert(alloc_samples != NULL);
+#endif
+    if (samples == NULL) {
+        printf("Error: Out of memory for %d benchmark runs.\n", repeat);
+        exit(-1);
+    }
+
+    uint64_t ns[BENCH_NUM_PHASES];
+    int run, phase;
+    // warmup runs count up to 0 and are not recorded
+    for (run = -options->warmup; run < repeat; run++) {
+        if (bench_run_once(solver, input, size, ns, result->answers) < 0) {
+            printf("Error: %s is not a day %s input.\n", path, solver->day);
+            exit(-1);
+        }
+        if (run < 0)
+            continue;
+        for (phase = 0; phase < BENCH_NUM_PHASES; phase++) {
+            samples[phase * repeat + run] = ns[phase];
+#ifdef BENCH_PERF
+            for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+                count_samples[(phase * PERF_NUM_COUNTERS + c) * repeat + run]
+                    = bench_perf_counts[phase][c];
+#endif
+#ifdef TRACK_ALLOC
+            for (int c = 0; c < BENCH_NUM_ALLOC; c++)
+                alloc_samples[(phase * BENCH_NUM_ALLOC + c) * repeat + run]
+                    = bench_alloc[phase][c];
+#endif
+        }
+    }
+
+    result->build = options->build;
+    result->day = solver->day;
+    result->input = path;
+    result->runs = repeat;
+    for (phase = 0; phase < BENCH_NUM_PHASES; phase++)
+        result->phases[phase] = bench_stats(samples + phase * repeat, repeat);
+    free(samples);
+#ifdef BENCH_PERF
+    for (phase = 0; phase < BENCH_NUM_PHASES; phase++) {
+        for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+            result->counts[phase][c] = bench_stats(count_samples
+                    + (phase * PERF_NUM_COUNTERS + c) * repeat, repeat).median;
+    }
+    free(count_samples);
+#endif
+#ifdef TRACK_ALLOC
+    for (phase = 0; phase < BENCH_NUM_PHASES; phase++) {
+        for (int c = 0; c < BENCH_NUM_ALLOC; c++)
+            result->alloc[phase][c] = bench_stats(alloc_samples
+                    + (phase * BENCH_NUM_ALLOC + c) * repeat, repeat).median;
+    }
+    free(alloc_samples);
+    result->leaked = bench_alloc_leaked;
+    if (result->leaked != 0)
+        fprintf(stderr, "Warning: Day %s left %lld blocks allocated after a run "
+                "on %s.\n", solver->day, result->leaked, path);
+#endif
+    free(input);
+}
+
+/*
+* Write a string as a double quoted csv or json field. Answers such as
+* the day 13 letters span several lines.
+*
+* @param    out         output stream
+* @param    str         string to write
+* @param    json        1 for json escapes, 0 for csv
+*/
+static inline void bench_print_quoted(FILE *out, const char *str, int json)
+{
+    fputc('"', out);
+    for (; *str; str++) {
+        if (json && (*str == '"' || *str == '\\'))
+            fprintf(out, "\\%c", *str);
+        else if (json && *str == '\n')
+            fputs("\\n", out);
+        else if (!json && *str == '"')
+            fputs("\"\"", out);
+        else
+            fputc(*str, out);
+    }
+    fputc('"', out);
+}
+
+#if defined(BENCH_PERF) || defined(TRACK_ALLOC)
+/*
+* Write extra columns of a row, or their names for the header
+*
+* @param    out         output stream
+* @param    names       column names
+* @param    num_counts  number of columns
+* @param    counts      value of each column, UINT64_MAX if it is not known,
+*                       NULL for the header
+* @param    format      table, csv or json
+*/
+static inline void bench_print_counts(FILE *out, const char *const *names,
+        int num_counts, const uint64_t *counts, enum BenchFormat format)
+{
+    for (int c = 0; c < num_counts; c++) {
+        const char *name = names[c];
+        int known = counts != NULL && counts[c] != UINT64_MAX;
+        unsigned long long count = known ? counts[c] : 0;
+        if (format == BENCH_JSON && known)
+            fprintf(out, ", \"%s\": %llu", name, count);
+        else if (format == BENCH_JSON)
+            fprintf(out, ", \"%s\": null", name);
+        else if (format == BENCH_CSV && counts == NULL)
+            fprintf(out, "%s,", name);
+        else if (format == BENCH_CSV && known)
+            fprintf(out, "%llu,", count);
+        else if (format == BENCH_CSV)
+            fprintf(out, ",");
+        else if (counts == NULL)
+            fprintf(out, " %13s", name);
+        else if (known)
+            fprintf(out, " %13llu", count);
+        else
+            fprintf(out, " %13s", "-");
+    }
+}
+#endif
+
+static inline void bench_print_header(FILE *out, enum BenchFormat format)
+{
+    if (format == BENCH_CSV) {
+        fprintf(out, "build,day,input,phase,runs,min_ns,median_ns,p99_ns,");
+#ifdef BENCH_PERF
+        bench_print_counts(out, perf_counter_names, PERF_NUM_COUNTERS, NULL, format);
+#endif
+#ifdef TRACK_ALLOC
+        bench_print_counts(out, bench_alloc_names, BENCH_NUM_ALLOC, NULL, format);
+#endif
+        fprintf(out, "answer\n");
+    } else if (format == BENCH_TABLE) {
+        fprintf(out, "%-8s %-4s %-24s %-6s %5s %12s %12s %12s", "build",
+                "day", "input", "phase", "runs", "min (us)", "median (us)",
+                "p99 (us)");
+#ifdef BENCH_PERF
+        bench_print_counts(out, perf_counter_names, PERF_NUM_COUNTERS, NULL, format);
+#endif
+#ifdef TRACK_ALLOC
+        bench_print_counts(out, bench_alloc_names, BENCH_NUM_ALLOC, NULL, format);
+#endif
+        fprintf(out, "  answer\n");
+    }
+}
+
+/*
+* Write one result, a row per phase. The parse phase has no answer.
+*
+* @param    out         output stream
+* @param    result      result to write
+* @param    format      table, csv or json
+*/
+static inline void bench_print_result(FILE *out, const struct BenchResult *result,
+        enum BenchFormat format)
+{
+    int phase;
+    for (phase = 0; phase < BENCH_NUM_PHASES; phase++) {
+        const struct BenchStats *stats = &result->phases[phase];
+        const char *answer = (phase > 0) ? result->answers[phase - 1] : "";
+        switch (format) {
+        case BENCH_CSV:
+            fprintf(out, "%s,%s,%s,%s,%d,%llu,%llu,%llu,", result->build, result->day,
+                    result->input, bench_phase_names[phase], result->runs,
+                    (unsigned long long)stats->min,
+                    (unsigned long long)stats->median,
+                    (unsigned long long)stats->p99);
+#ifdef BENCH_PERF
+            bench_print_counts(out, perf_counter_names, PERF_NUM_COUNTERS,
+                    result->counts[phase], format);
+#endif
+#ifdef TRACK_ALLOC
+            bench_print_counts(out, bench_alloc_names, BENCH_NUM_ALLOC,
+                    result->alloc[phase], format);
+#endif
+            bench_print_quoted(out, answer, 0);
+            fputc('\n', out);
+            break;
+        case BENCH_JSON:
+            fprintf(out, "{\"build\": \"%s\", \"day\": \"%s\", \"input\": ",
+                    result->build, result->day);
+            bench_print_quoted(out, result->input, 1);
+            fprintf(out, ", \"phase\": \"%s\", \"runs\": %d, \"min_ns\": %llu, "
+                    "\"median_ns\": %llu, \"p99_ns\": %llu",
+                    bench_phase_names[phase], result->runs,
+                    (unsigned long long)stats->min,
+                    (unsigned long long)stats->median,
+                    (unsigned long long)stats->p99);
+#ifdef BENCH_PERF
+            bench_print_counts(out, perf_counter_names, PERF_NUM_COUNTERS,
+                    result->counts[phase], format);
+#endif
+#ifdef TRACK_ALLOC
+            bench_print_counts(out, bench_alloc_names, BENCH_NUM_ALLOC,
+                    result->alloc[phase], format);
+#endif
+            fprintf(out, ", \"answer\": ");
+            bench_print_quoted(out, answer, 1);
+            fputs("}\n", out);
+            break;
+        default:
+            // multi line answers only show their first line in the table
+            fprintf(out, "%-8s %-4s %-24s %-6s %5d %12.1f %12.1f %12.1f",
+                    result->build, result->day, result->input, bench_phase_names[phase],
+                    result->runs, stats->min / 1e3, stats->median / 1e3,
+                    stats->p99 / 1e3);
+#ifdef BENCH_PERF
+            bench_print_counts(out, perf_counter_names, PERF_NUM_COUNTERS,
+                    result->counts[phase], format);
+#endif
+#ifdef TRACK_ALLOC
+            bench_print_counts(out, bench_alloc_names, BENCH_NUM_ALLOC,
+                    result->alloc[phase], format);
+#endif
+            fprintf(out, "  %.*s\n", (int)strcspn(answer, "\n"), answer);
+        }
+    }
+}
+
+/*
+* Entry point for a day started with --bench
+*
+* @param    solver      the day to run
+* @param    argc        argument count, argv[0] being "--bench"
+* @param    argv        options followed by the input files
+* @retval   status      0 on success
+*/
+static inline int bench_main(const struct Solver *solver, int argc, char *argv[])
+{
+    struct BenchOptions options = { BENCH_WARMUP, BENCH_REPEAT, BENCH_TABLE, "-", 1 };
+    int i;
+    for (i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+        if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            options.repeat = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "csv") == 0)
+                options.format = BENCH_CSV;
+            else if (strcmp(argv[i], "json") == 0)
+                options.format = BENCH_JSON;
+            else if (strcmp(argv[i], "table") == 0)
+                options.format = BENCH_TABLE;
+            else {
+                printf("Error: Unknown format %s.\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--build") == 0 && i + 1 < argc) {
+            options.build = argv[++i];
+        } else if (strcmp(argv[i], "--no-header") == 0) {
+            options.header = 0;
+        } else {
+            printf("Error: Unknown benchmark option %s.\n", argv[i]);
+            return 1;
+        }
+    }
+    if (i == argc) {
+        printf("usage: --bench [--warmup N] [--repeat N] "
+                "[--format table|csv|json] [--build NAME] [--no-header] file...\n");
+        return 1;
+    }
+
+    struct BenchResult *result = malloc(sizeof(struct BenchResult));
+    assert(result != NULL);
+#ifdef BENCH_PERF
+    if (PerfCounters_open(&bench_perf) < PERF_NUM_COUNTERS)
+        fprintf(stderr, "Warning: Some performance counters are not available "
+                "(see /proc/sys/kernel/perf_event_paranoid).\n");
+#endif
+    if (options.header)
+        bench_print_header(stdout, options.format);
+    for (; i < argc; i++) {
+        bench_solver(solver, argv[i], &options, result);
+        bench_print_result(stdout, result, options.format);
+    }
+#ifdef BENCH_PERF
+    PerfCounters_close(&bench_perf);
+#endif
+    free(result);
+    return 0;
+}
+
+#endif
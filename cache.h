@@ -0,0 +1,132 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "util.h"
+#include "bench.h"
+
+/* On-disk cache of answers, so that inputs that have been solved before
+   are not solved again. An answer is keyed by the day, the part, the
+   day's solver version and the XXH64 hash of the input bytes, and is kept
+   as a small text file named after its key:
+
+       <cache dir>/<day>-<part>-v<version>-<hash>
+
+   The cache lives in $AOC_CACHE, or .aoc-cache in the current directory.
+   Changing an input changes its hash and bumping a solver's version
+   changes its keys, so stale answers are never read back; cache_clear()
+   deletes them. Entries are written to a temporary file and renamed into
+   place, so threads and processes can share a cache. */
+
+#define CACHE_DIR ".aoc-cache"
+#define CACHE_PATH_LEN 4096
+
+static inline const char *cache_dir(void)
+{
+    const char *dir = getenv("AOC_CACHE");
+    return (dir != NULL && *dir) ? dir : CACHE_DIR;
+}
+
+static inline void cache_path(char path[CACHE_PATH_LEN], const struct Solver *solver,
+        int part, uint64_t hash)
+{
+    snprintf(path, CACHE_PATH_LEN, "%s/%s-%d-v%d-%016llx", cache_dir(),
+            solver->day, part, solver->version, (unsigned long long)hash);
+}
+
+/*
+* Look up a cached answer
+*
+* @param    solver      the day
+* @param    part        1 or 2
+* @param    hash        xxh64() of the input
+* @param    answer      the cached answer (output)
+* @retval   found       1 if the answer was cached, 0 if not
+*/
+static inline int cache_load(const struct Solver *solver, int part, uint64_t hash,
+        char answer[ANSWER_LEN])
+{
+    char path[CACHE_PATH_LEN];
+    cache_path(path, solver, part, hash);
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return 0;
+    size_t len = fread(answer, 1, ANSWER_LEN - 1, file);
+    int failed = ferror(file);
+    fclose(file);
+    answer[len] = '\0';
+    return !failed;
+}
+
+/*
+* Cache an answer. The cache is only an optimization, so failing to write
+* it is a warning rather than an error.
+*
+* @param    solver      the day
+* @param    part        1 or 2
+* @param    hash        xxh64() of the input
+* @param    answer      the answer to cache
+*/
+static inline void cache_store(const struct Solver *solver, int part, uint64_t hash,
+        const char *answer)
+{
+    char path[CACHE_PATH_LEN], tmp_path[CACHE_PATH_LEN];
+    if (mkdir(cache_dir(), 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Warning: Could not create cache %s: %s\n", cache_dir(),
+                strerror(errno));
+        return;
+    }
+    cache_path(path, solver, part, hash);
+    snprintf(tmp_path, CACHE_PATH_LEN, "%s/.tmp-XXXXXX", cache_dir());
+    int fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        fprintf(stderr, "Warning: Could not write to cache %s: %s\n", cache_dir(),
+                strerror(errno));
+        return;
+    }
+    size_t len = strlen(answer);
+    int failed = write(fd, answer, len) != (ssize_t)len;
+    failed |= close(fd) != 0;
+    if (failed || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Warning: Could not write %s: %s\n", path, strerror(errno));
+        unlink(tmp_path);
+    }
+}
+
+/*
+* Delete cached answers
+*
+* @param    day         day to delete the answers of, NULL for every day
+* @retval   removed     number of answers deleted
+*/
+static inline int cache_clear(const char *day)
+{
+    DIR *dir = opendir(cache_dir());
+    if (dir == NULL)
+        return 0;
+    char path[CACHE_PATH_LEN];
+    size_t day_len = (day != NULL) ? strlen(day) : 0;
+    int removed = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name;
+        if (name[0] == '.' && strncmp(name, ".tmp-", 5) != 0)
+            continue;
+        if (day != NULL && (strncmp(name, day, day_len) != 0 || name[day_len] != '-'))
+            continue;
+        snprintf(path, CACHE_PATH_LEN, "%s/%s", cache_dir(), name);
+        if (unlink(path) == 0)
+            removed++;
+    }
+    closedir(dir);
+    return removed;
+}
+
+#endif
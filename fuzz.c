@@ -0,0 +1,515 @@
+/* Differential fuzzing
+
+The days with more than one engine keep the simplest one as a reference
+and expose a check that runs every engine on an input and reports the
+first disagreement (dayN_check_engines()). This generates small random
+inputs for those days and runs the checks. A failing input is shrunk by
+deleting pieces of it (rows, boards, lines, fish) for as long as the
+engines still disagree, and the smallest input found is printed and saved.
+
+usage: fuzz [--day N] [--runs N] [--seed S] [--max-units N]
+       fuzz --day N --replay file...
+
+    --day N         only fuzz day N (default every day in turn)
+    --runs N        inputs to try per day (default 1000)
+    --seed S        first seed (default 1), each run uses the next one
+    --max-units N   largest input, in rows, boards, lines or fish
+                    (default 40, day 15 never goes past 6 rows)
+    --replay        check saved inputs, such as fuzz-4-17.txt
+
+Built with -DFUZZ_LIBFUZZER, the same generators and checks are driven by
+libFuzzer instead: the first byte of the fuzzer's data picks the day and
+the rest is the randomness the generator draws from, so every byte string
+is a valid input and libFuzzer's mutations explore the inputs of each day.
+A mismatch prints the shrunk input and aborts, so libFuzzer saves it.
+
+    make fuzz-libfuzzer && ./fuzz-libfuzzer -max_total_time=60
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include "util.h"
+#include "bench.h"
+
+#define FUZZ_RUNS 1000
+#define FUZZ_MAX_UNITS 40
+#define CAVE_MAX_SIDE 6
+
+typedef int (*check_fn)(const char *input, size_t size, struct ThreadPool *pool,
+        char report[ANSWER_LEN]);
+
+int day3_check_engines(const char *input, size_t size, struct ThreadPool *pool,
+        char report[ANSWER_LEN]);
+int day4_check_engines(const char *input, size_t size, struct ThreadPool *pool,
+        char report[ANSWER_LEN]);
+int day5_check_engines(const char *input, size_t size, struct ThreadPool *pool,
+        char report[ANSWER_LEN]);
+int day6_check_engines(const char *input, size_t size, struct ThreadPool *pool,
+        char report[ANSWER_LEN]);
+int day15_check_engines(const char *input, size_t size, struct ThreadPool *pool,
+        char report[ANSWER_LEN]);
+
+/* Random numbers come from the fuzzer's data while it lasts and from
+   splitmix64 after that (or from the start, when running standalone). */
+struct FuzzRng {
+    const uint8_t *data;
+    size_t size;
+    uint64_t state;
+};
+
+uint64_t FuzzRng_next(struct FuzzRng *rng)
+{
+    if (rng->size > 0) {
+        uint64_t val = 0;
+        size_t n = (rng->size < 8) ? rng->size : 8;
+        memcpy(&val, rng->data, n);
+        rng->data += n;
+        rng->size -= n;
+        return val;
+    }
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/* A number in lo .. hi */
+int FuzzRng_range(struct FuzzRng *rng, int lo, int hi)
+{
+    return lo + (int)(FuzzRng_next(rng) % (uint64_t)(hi - lo + 1));
+}
+
+DEFINE_VECTOR(StringVector, char *)
+
+/* An input is a header followed by units joined by a separator. Units
+   are what the shrinker deletes, so an input without some of its units
+   must still be valid. */
+struct FuzzCase {
+    char header[1024];
+    const char *separator;
+    struct StringVector units;
+};
+
+void FuzzCase_add(struct FuzzCase *fc, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+void FuzzCase_add(struct FuzzCase *fc, const char *format, ...)
+{
+    char unit[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(unit, sizeof(unit), format, args);
+    va_end(args);
+    char *copy = strdup(unit);
+    assert(copy != NULL);
+    StringVector_push(&fc->units, copy);
+}
+
+void FuzzCase_free(struct FuzzCase *fc)
+{
+    for (size_t i = 0; i < fc->units.size; i++)
+        free(fc->units.data[i]);
+    StringVector_free(&fc->units);
+}
+
+/*
+* Write out an input, or only some of its units
+*
+* @param    fc          the input
+* @param    keep        1 for each unit to write, NULL for every unit
+* @param    p_size      size of the text (output)
+* @retval   text        the input, zero terminated, to be freed
+*/
+char *FuzzCase_render(struct FuzzCase *fc, const char *keep, size_t *p_size)
+{
+    size_t sep_len = strlen(fc->separator);
+    size_t size = strlen(fc->header);
+    for (size_t i = 0; i < fc->units.size; i++)
+        size += strlen(fc->units.data[i]) + sep_len;
+    char *text = malloc(size + 1);
+    assert(text != NULL);
+    char *p = text + sprintf(text, "%s", fc->header);
+    int first = 1;
+    for (size_t i = 0; i < fc->units.size; i++) {
+        if (keep != NULL && !keep[i])
+            continue;
+        p += sprintf(p, "%s%s", first ? "" : fc->separator, fc->units.data[i]);
+        first = 0;
+    }
+    *p = '\0';
+    *p_size = p - text;
+    return text;
+}
+
+/* Day 3: rows of bits, all as wide as each other */
+void gen_diagnostic(struct FuzzRng *rng, struct FuzzCase *fc, int max_units)
+{
+    int width = FuzzRng_range(rng, 1, 12);
+    int num_rows = FuzzRng_range(rng, 1, max_units);
+    char row[16];
+    fc->separator = "\n";
+    for (int r = 0; r < num_rows; r++) {
+        uint64_t bits = FuzzRng_next(rng);
+        for (int b = 0; b < width; b++)
+            row[b] = '0' + ((bits >> b) & 1);
+        row[width] = '\0';
+        FuzzCase_add(fc, "%s", row);
+    }
+}
+
+/* Day 4: distinct calls, some numbers never called, boards of distinct
+   numbers that may repeat between boards */
+void gen_bingo(struct FuzzRng *rng, struct FuzzCase *fc, int max_units)
+{
+    int range = FuzzRng_range(rng, 25, 99);
+    int numbers[100];
+    for (int i = 0; i < range; i++)
+        numbers[i] = i;
+    int num_calls = FuzzRng_range(rng, 1, range);
+    char *p = fc->header;
+    for (int i = 0; i < num_calls; i++) {
+        int j = FuzzRng_range(rng, i, range - 1);
+        int swap = numbers[i]; numbers[i] = numbers[j]; numbers[j] = swap;
+        p += sprintf(p, "%s%d", i ? "," : "", numbers[i]);
+    }
+    sprintf(p, "\n\n");
+
+    int num_boards = FuzzRng_range(rng, 1, (max_units + 3) / 4);
+    fc->separator = "\n\n";
+    for (int b = 0; b < num_boards; b++) {
+        char board[256];
+        char *q = board;
+        for (int i = 0; i < 25; i++) {
+            int j = FuzzRng_range(rng, i, range - 1);
+            int swap = numbers[i]; numbers[i] = numbers[j]; numbers[j] = swap;
+            q += sprintf(q, "%2d%s", numbers[i], (i % 5 == 4) ? (i < 24 ? "\n" : "") : " ");
+        }
+        FuzzCase_add(fc, "%s", board);
+    }
+}
+
+/* Day 5: horizontal, vertical and 45 degree lines in a small box, so
+   that they overlap a lot */
+void gen_vents(struct FuzzRng *rng, struct FuzzCase *fc, int max_units)
+{
+    int side = FuzzRng_range(rng, 2, 64);
+    int num_lines = FuzzRng_range(rng, 1, max_units);
+    fc->separator = "\n";
+    for (int l = 0; l < num_lines; l++) {
+        int x1 = FuzzRng_range(rng, 0, side - 1);
+        int y1 = FuzzRng_range(rng, 0, side - 1);
+        int x2 = x1, y2 = y1;
+        while (x2 == x1 && y2 == y1) {
+            int len = FuzzRng_range(rng, 1, side - 1);
+            switch (FuzzRng_range(rng, 0, 2)) {
+            case 0:
+                x2 = FuzzRng_range(rng, 0, side - 1);
+                break;
+            case 1:
+                y2 = FuzzRng_range(rng, 0, side - 1);
+                break;
+            default:
+                x2 = x1 + (FuzzRng_range(rng, 0, 1) ? len : -len);
+                y2 = y1 + (FuzzRng_range(rng, 0, 1) ? len : -len);
+                if (x2 < 0 || y2 < 0) {
+                    x2 = x1;
+                    y2 = y1;
+                }
+            }
+        }
+        FuzzCase_add(fc, "%d,%d -> %d,%d", x1, y1, x2, y2);
+    }
+}
+
+/* Day 6: fish timers, 0 .. 8 rather than only the 1 .. 5 of the puzzle */
+void gen_fish(struct FuzzRng *rng, struct FuzzCase *fc, int max_units)
+{
+    int num_fish = FuzzRng_range(rng, 1, max_units);
+    fc->separator = ",";
+    for (int f = 0; f < num_fish; f++)
+        FuzzCase_add(fc, "%d", FuzzRng_range(rng, 0, 8));
+}
+
+/* Day 15: rows of risk digits, 0 .. 9 rather than only the 1 .. 9 of the
+   puzzle, all as wide as each other. Kept to 6x6 at most, since the
+   reference search is exponential in the size of the map. */
+void gen_cave(struct FuzzRng *rng, struct FuzzCase *fc, int max_units)
+{
+    int width = FuzzRng_range(rng, 1, CAVE_MAX_SIDE);
+    int num_rows = FuzzRng_range(rng, 1,
+            (max_units < CAVE_MAX_SIDE) ? max_units : CAVE_MAX_SIDE);
+    char row[CAVE_MAX_SIDE + 1];
+    fc->separator = "\n";
+    for (int r = 0; r < num_rows; r++) {
+        for (int c = 0; c < width; c++)
+            row[c] = '0' + FuzzRng_range(rng, 0, 9);
+        row[width] = '\0';
+        FuzzCase_add(fc, "%s", row);
+    }
+}
+
+struct FuzzTarget {
+    int day;
+    void (*generate)(struct FuzzRng *rng, struct FuzzCase *fc, int max_units);
+    check_fn check;
+};
+
+static const struct FuzzTarget targets[] = {
+    { 3, gen_diagnostic, day3_check_engines },
+    { 4, gen_bingo, day4_check_engines },
+    { 5, gen_vents, day5_check_engines },
+    { 6, gen_fish, day6_check_engines },
+    { 15, gen_cave, day15_check_engines },
+};
+#define NUM_TARGETS (int)(sizeof(targets) / sizeof(targets[0]))
+
+int run_check(const struct FuzzTarget *target, struct FuzzCase *fc, const char *keep,
+        struct ThreadPool *pool, char report[ANSWER_LEN])
+{
+    size_t size;
+    char *text = FuzzCase_render(fc, keep, &size);
+    int mismatch = target->check(text, size, pool, report);
+    free(text);
+    return mismatch;
+}
+
+/*
+* Shrink a failing input by delta debugging: delete chunks of units,
+* halves first and then smaller ones, keeping any deletion after which
+* the engines still disagree. At least one unit is always kept.
+*
+* @param    target      the day
+* @param    fc          the failing input, shrunk in place
+* @param    pool        thread pool for the check
+* @param    report      what differed on the shrunk input (output)
+*/
+void shrink(const struct FuzzTarget *target, struct FuzzCase *fc,
+        struct ThreadPool *pool, char report[ANSWER_LEN])
+{
+    size_t n = fc->units.size;
+    char *keep = malloc(n + 1);
+    assert(keep != NULL);
+    memset(keep, 1, n);
+    size_t num_kept = n;
+    size_t chunks = 2;
+    while (num_kept > 1) {
+        size_t chunk = (num_kept + chunks - 1) / chunks;
+        int shrunk = 0;
+        // walk the kept units in chunks, trying to delete each chunk
+        size_t start = 0;
+        while (start < n && num_kept > 1) {
+            size_t end = start, count = 0;
+            while (end < n && count < chunk) {
+                count += keep[end];
+                end++;
+            }
+            if (count == 0 || count == num_kept) {
+                start = end;
+                continue;
+            }
+            char *saved = malloc(end - start);
+            assert(saved != NULL);
+            memcpy(saved, keep + start, end - start);
+            memset(keep + start, 0, end - start);
+            if (run_check(target, fc, keep, pool, report)) {
+                num_kept -= count;
+                shrunk = 1;
+            } else {
+                memcpy(keep + start, saved, end - start);
+            }
+            free(saved);
+            start = end;
+        }
+        if (shrunk)
+            chunks = (chunks > 2) ? chunks - 1 : 2;
+        else if (chunk == 1)
+            break;
+        else
+            chunks = (chunks * 2 < num_kept) ? chunks * 2 : num_kept;
+    }
+
+    // drop the deleted units for good
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (keep[i])
+            fc->units.data[kept++] = fc->units.data[i];
+        else
+            free(fc->units.data[i]);
+    }
+    fc->units.size = kept;
+    free(keep);
+    run_check(target, fc, NULL, pool, report);
+}
+
+/*
+* Generate an input, check it and shrink it if the engines disagree
+*
+* @param    target      the day
+* @param    rng         randomness for the generator
+* @param    max_units   largest input
+* @param    pool        thread pool for the check
+* @param    fc          the input, shrunk if it failed (output)
+* @param    report      what differed (output)
+* @retval   mismatch    1 if the engines disagree
+*/
+int fuzz_one(const struct FuzzTarget *target, struct FuzzRng *rng, int max_units,
+        struct ThreadPool *pool, struct FuzzCase *fc, char report[ANSWER_LEN])
+{
+    target->generate(rng, fc, max_units);
+    if (!run_check(target, fc, NULL, pool, report))
+        return 0;
+    shrink(target, fc, pool, report);
+    return 1;
+}
+
+void print_mismatch(const struct FuzzTarget *target, struct FuzzCase *fc,
+        const char *report, FILE *out)
+{
+    size_t size;
+    char *text = FuzzCase_render(fc, NULL, &size);
+    fprintf(out, "Day %d engines disagree: %s\nOn this input (%zu units):\n%s\n",
+            target->day, report, fc->units.size, text);
+    free(text);
+}
+
+#ifdef FUZZ_LIBFUZZER
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static struct ThreadPool *pool = NULL;
+    if (pool == NULL)
+        pool = ThreadPool_create(2);
+    if (size < 1)
+        return 0;
+    const struct FuzzTarget *target = &targets[data[0] % NUM_TARGETS];
+    struct FuzzRng rng = { data + 1, size - 1, 0 };
+    struct FuzzCase fc = { .separator = "\n" };
+    char report[ANSWER_LEN];
+    if (fuzz_one(target, &rng, FUZZ_MAX_UNITS, pool, &fc, report)) {
+        print_mismatch(target, &fc, report, stderr);
+        abort();
+    }
+    FuzzCase_free(&fc);
+    return 0;
+}
+
+#else
+
+/*
+* Check saved inputs
+*
+* @retval   failed      number of inputs the engines disagree on
+*/
+int replay(const struct FuzzTarget *target, char *paths[], int num_paths,
+        struct ThreadPool *pool)
+{
+    int failed = 0;
+    char report[ANSWER_LEN];
+    for (int i = 0; i < num_paths; i++) {
+        size_t size;
+        char *input = read_file(paths[i], &size);
+        if (target->check(input, size, pool, report)) {
+            printf("%s: day %d engines disagree: %s\n", paths[i], target->day, report);
+            failed++;
+        } else {
+            printf("%s: day %d engines agree\n", paths[i], target->day);
+        }
+        free(input);
+    }
+    return failed;
+}
+
+void usage(void)
+{
+    printf("usage: fuzz [--day N] [--runs N] [--seed S] [--max-units N]\n"
+           "       fuzz --day N --replay file...\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int day = 0, runs = FUZZ_RUNS, max_units = FUZZ_MAX_UNITS;
+    uint64_t seed = 1;
+    int arg;
+    for (arg = 1; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (strcmp(argv[arg], "--help") == 0 || strcmp(argv[arg], "-h") == 0) {
+            usage();
+            return 0;
+        }
+        if (strcmp(argv[arg], "--replay") == 0)
+            break;
+        if (arg + 1 >= argc) {
+            printf("Error: %s needs a value.\n", argv[arg]);
+            return 1;
+        }
+        if (strcmp(argv[arg], "--day") == 0)
+            day = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "--runs") == 0)
+            runs = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "--seed") == 0)
+            seed = strtoull(argv[++arg], NULL, 10);
+        else if (strcmp(argv[arg], "--max-units") == 0)
+            max_units = atoi(argv[++arg]);
+        else {
+            printf("Error: Unknown option %s.\n", argv[arg]);
+            usage();
+            return 1;
+        }
+    }
+    if (max_units < 1)
+        max_units = 1;
+
+    struct ThreadPool *pool = ThreadPool_create(0);
+    int failed = 0;
+    if (arg < argc && strcmp(argv[arg], "--replay") == 0) {
+        const struct FuzzTarget *target = NULL;
+        for (int t = 0; t < NUM_TARGETS; t++) {
+            if (targets[t].day == day)
+                target = &targets[t];
+        }
+        if (target == NULL) {
+            printf("Error: --replay needs the --day of a day with engines to check.\n");
+            return 1;
+        }
+        failed = replay(target, argv + arg + 1, argc - arg - 1, pool);
+        ThreadPool_destroy(pool);
+        return failed > 0;
+    }
+
+    char report[ANSWER_LEN];
+    for (int t = 0; t < NUM_TARGETS; t++) {
+        const struct FuzzTarget *target = &targets[t];
+        if (day != 0 && target->day != day)
+            continue;
+        int day_failed = 0, run;
+        for (run = 0; run < runs && !day_failed; run++) {
+            struct FuzzRng rng = { NULL, 0, seed + run };
+            struct FuzzCase fc = { .separator = "\n" };
+            if (fuzz_one(target, &rng, max_units, pool, &fc, report)) {
+                char path[64];
+                snprintf(path, sizeof(path), "fuzz-%d-%llu.txt", target->day,
+                        (unsigned long long)(seed + run));
+                print_mismatch(target, &fc, report, stdout);
+                FILE *out = fopen(path, "w");
+                if (out != NULL) {
+                    size_t size;
+                    char *text = FuzzCase_render(&fc, NULL, &size);
+                    fwrite(text, 1, size, out);
+                    fclose(out);
+                    free(text);
+                    printf("Saved as %s.\n", path);
+                }
+                day_failed = 1;
+            }
+            FuzzCase_free(&fc);
+        }
+        printf("Day %d: %s after %d inputs.\n", target->day,
+                day_failed ? "MISMATCH" : "all engines agree", run);
+        failed += day_failed;
+    }
+    ThreadPool_destroy(pool);
+    return failed > 0;
+}
+
+#endif
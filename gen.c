@@ -0,0 +1,573 @@
+/* Synthetic puzzle inputs
+
+Writes a valid input for any day to stdout, from a seed, at any multiple
+of the real puzzle size. The same day, scale and seed always give the
+same bytes, so generated inputs can stand in for big downloads and be
+thrown away and rebuilt at will.
+
+usage: gen <day> [--scale X] [--seed S] [--width W] [--small-caves K]
+
+    --scale X       multiply the size of the puzzle input by X (default 1).
+                    For grids this is the number of cells, so --scale 100
+                    turns a 100x100 heightmap into 1000x1000.
+    --seed S        seed for the random numbers (default 1)
+    --width W       bits per diagnostic number (day 3, default 12)
+    --small-caves K small caves per cluster (day 12, default 8). The number
+                    of paths grows exponentially with it, so day 12 scales
+                    by adding clusters of caves instead.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "util.h"
+
+#define MAX_BRACKET_DEPTH 20    // keeps day 10 scores inside 64 bits
+#define OCTOPUS_SPREAD 5        // see gen_octopuses()
+
+struct GenOptions {
+    double scale;
+    uint64_t seed;
+    int width;
+    int small_caves;
+};
+
+/* splitmix64: small, fast and the same on every platform */
+struct Rng {
+    uint64_t state;
+};
+
+uint64_t Rng_next(struct Rng *rng)
+{
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/*
+* Draw a number below a bound, without modulo bias
+*
+* @param    rng         the generator
+* @param    bound       upper bound (> 0)
+* @retval   n           0 <= n < bound
+*/
+uint64_t Rng_below(struct Rng *rng, uint64_t bound)
+{
+    return (uint64_t)(((unsigned __int128)Rng_next(rng) * bound) >> 64);
+}
+
+int Rng_range(struct Rng *rng, int lo, int hi)
+{
+    return lo + (int)Rng_below(rng, hi - lo + 1);
+}
+
+void shuffle(struct Rng *rng, int array[], int n)
+{
+    for (int i = n - 1; i > 0; i--) {
+        int j = Rng_below(rng, i + 1);
+        int tmp = array[i];
+        array[i] = array[j];
+        array[j] = tmp;
+    }
+}
+
+/*
+* Scale a count from the puzzle input
+*
+* @param    base        count in the puzzle input
+* @param    scale       multiplier
+* @retval   count       base * scale, at least 1
+*/
+long scaled(long base, double scale)
+{
+    long count = llround(base * scale);
+    return (count > 0) ? count : 1;
+}
+
+/* Side of a square grid with base * base * scale cells */
+int scaled_side(int base, double scale)
+{
+    int side = lround(base * sqrt(scale));
+    return (side > 1) ? side : 2;
+}
+
+/* Day 1: sonar depths, a random walk that trends deeper */
+void gen_depths(struct Rng *rng, struct GenOptions *opt)
+{
+    long depth = 150;
+    for (long i = scaled(2000, opt->scale); i > 0; i--) {
+        depth += Rng_range(rng, -12, 20);
+        if (depth < 1)
+            depth = 1;
+        printf("%ld\n", depth);
+    }
+}
+
+/* Day 3: binary diagnostic numbers */
+void gen_diagnostic(struct Rng *rng, struct GenOptions *opt)
+{
+    char row[66];
+    for (long i = scaled(1000, opt->scale); i > 0; i--) {
+        for (int b = 0; b < opt->width; b++)
+            row[b] = '0' + (Rng_next(rng) >> 63);
+        row[opt->width] = '\0';
+        puts(row);
+    }
+}
+
+/* Day 4: every number is called once, in random order, and every board
+   holds 25 different numbers */
+void gen_bingo(struct Rng *rng, struct GenOptions *opt)
+{
+    long num_boards = scaled(100, opt->scale);
+    int num_numbers = scaled(100, opt->scale);
+    int *numbers = malloc(num_numbers * sizeof(int));
+    assert(numbers != NULL);
+    for (int i = 0; i < num_numbers; i++)
+        numbers[i] = i;
+    shuffle(rng, numbers, num_numbers);
+    for (int i = 0; i < num_numbers; i++)
+        printf((i > 0) ? ",%d" : "%d", numbers[i]);
+    printf("\n");
+
+    for (long b = 0; b < num_boards; b++) {
+        // a partial shuffle picks the 25 cells
+        for (int c = 0; c < 25; c++) {
+            int j = c + Rng_below(rng, num_numbers - c);
+            int tmp = numbers[c];
+            numbers[c] = numbers[j];
+            numbers[j] = tmp;
+        }
+        printf("\n");
+        for (int c = 0; c < 25; c++)
+            printf((c % 5 == 4) ? "%2d\n" : "%2d ", numbers[c]);
+    }
+    free(numbers);
+}
+
+/* Day 5: horizontal, vertical and 45 degree vent lines, at the puzzle's
+   density of lines */
+void gen_vents(struct Rng *rng, struct GenOptions *opt)
+{
+    int side = scaled_side(1000, opt->scale);
+    for (long i = scaled(500, opt->scale); i > 0; i--) {
+        int x1 = Rng_below(rng, side), y1 = Rng_below(rng, side);
+        int dx = 0, dy = 0;
+        switch (Rng_below(rng, 3)) {
+        case 0: dx = 1; break;
+        case 1: dy = 1; break;
+        default: dx = 1; dy = (Rng_next(rng) >> 63) ? 1 : -1;
+        }
+        if (Rng_next(rng) >> 63) {
+            dx = -dx;
+            dy = -dy;
+        }
+        // as long as it stays on the grid
+        int len = Rng_range(rng, 1, side / 2);
+        if (dx > 0 && x1 + len >= side) len = side - 1 - x1;
+        if (dx < 0 && x1 - len < 0) len = x1;
+        if (dy > 0 && y1 + len >= side) len = side - 1 - y1;
+        if (dy < 0 && y1 - len < 0) len = y1;
+        printf("%d,%d -> %d,%d\n", x1, y1, x1 + dx * len, y1 + dy * len);
+    }
+}
+
+/* Day 6: lanternfish timers */
+void gen_fish(struct Rng *rng, struct GenOptions *opt)
+{
+    for (long i = scaled(300, opt->scale); i > 0; i--)
+        printf((i > 1) ? "%d," : "%d\n", Rng_range(rng, 1, 5));
+}
+
+/* Day 7: crab positions, over a range that grows with the square root
+   of the number of crabs */
+void gen_crabs(struct Rng *rng, struct GenOptions *opt)
+{
+    int range = scaled_side(2000, opt->scale);
+    for (long i = scaled(1000, opt->scale); i > 0; i--) {
+        // two draws bunch the crabs towards the middle
+        int pos = (Rng_below(rng, range) + Rng_below(rng, range)) / 2;
+        printf((i > 1) ? "%d," : "%d\n", pos);
+    }
+}
+
+/* Day 8: every entry is the ten digits under a random wiring, then four
+   output digits, with the segments of each pattern in random order */
+void gen_displays(struct Rng *rng, struct GenOptions *opt)
+{
+    static const char *digits[10] = {
+        "abcefg", "cf", "acdeg", "acdfg", "bcdf",
+        "abdfg", "abdefg", "acf", "abcdefg", "abcdfg"
+    };
+    int wiring[7], order[10], letters[7];
+    for (long i = scaled(200, opt->scale); i > 0; i--) {
+        for (int s = 0; s < 7; s++)
+            wiring[s] = s;
+        shuffle(rng, wiring, 7);
+        for (int d = 0; d < 10; d++)
+            order[d] = d;
+        shuffle(rng, order, 10);
+        for (int w = 0; w < 15; w++) {
+            if (w == 10) {
+                printf(" |");
+                continue;
+            }
+            int d = (w < 10) ? order[w] : (int)Rng_below(rng, 10);
+            int len = strlen(digits[d]);
+            for (int s = 0; s < len; s++)
+                letters[s] = 'a' + wiring[digits[d][s] - 'a'];
+            shuffle(rng, letters, len);
+            if (w > 0)
+                putchar(' ');
+            for (int s = 0; s < len; s++)
+                putchar(letters[s]);
+        }
+        printf("\n");
+    }
+}
+
+/* Day 9: the map is cut into rectangles by rows and columns of 9s, and
+   each rectangle is one basin around a single low point, with heights
+   rising with the distance from it */
+void gen_heightmap(struct Rng *rng, struct GenOptions *opt)
+{
+    int side = scaled_side(100, opt->scale);
+    char *row = malloc(side + 2);
+    int *col_start = malloc((side + 1) * sizeof(int));  // basin column ranges
+    int *col_low = malloc((side + 1) * sizeof(int));    // low point columns
+    assert(row != NULL && col_start != NULL && col_low != NULL);
+
+    int r = 0;
+    while (r < side) {
+        // one band of basins, then a wall row
+        int height = Rng_range(rng, 2, 10);
+        if (r + height > side)
+            height = side - r;
+        int num_basins = 0, c = 0;
+        while (c < side) {
+            int width = Rng_range(rng, 2, 10);
+            if (c + width > side)
+                width = side - c;
+            col_start[num_basins] = c;
+            col_low[num_basins] = c + Rng_below(rng, width);
+            num_basins++;
+            c += width + 1;         // and a wall column
+        }
+        col_start[num_basins] = side + 1;
+        int low_row = r + Rng_below(rng, height);
+        for (int y = r; y < r + height; y++) {
+            int basin = 0;
+            for (int x = 0; x < side; x++) {
+                if (x + 1 == col_start[basin + 1]) {
+                    row[x] = '9';
+                    basin++;
+                    continue;
+                }
+                int d = abs(x - col_low[basin]) + abs(y - low_row);
+                row[x] = '0' + ((d < 8) ? d : 8);
+            }
+            row[side] = '\0';
+            puts(row);
+        }
+        r += height;
+        if (r < side) {
+            memset(row, '9', side);
+            puts(row);
+            r++;
+        }
+    }
+    free(row);
+    free(col_start);
+    free(col_low);
+}
+
+/* Day 10: bracket lines, each either corrupted or incomplete. There is
+   always an odd number of incomplete lines, so there is a middle score. */
+void gen_brackets(struct Rng *rng, struct GenOptions *opt)
+{
+    static const char openers[] = "([{<", closers[] = ")]}>";
+    char stack[MAX_BRACKET_DEPTH];
+    char line[256];
+    long num_lines = scaled(100, opt->scale);
+    long num_incomplete = 0;
+    for (long i = 0; i < num_lines; i++) {
+        int incomplete = (i == num_lines - 1) ? (num_incomplete % 2 == 0)
+            : (int)(Rng_next(rng) >> 63);
+        int len = Rng_range(rng, 90, 110);
+        int depth = 0, n = 0;
+        while (n < len) {
+            // open more often when the stack is shallow
+            int open = (depth == 0) || (depth < MAX_BRACKET_DEPTH
+                    && (int)Rng_below(rng, MAX_BRACKET_DEPTH) >= depth);
+            if (open) {
+                int b = Rng_below(rng, 4);
+                stack[depth++] = b;
+                line[n++] = openers[b];
+            } else {
+                line[n++] = closers[(int)stack[--depth]];
+            }
+        }
+        if (incomplete) {
+            // an incomplete line has to leave something open
+            if (depth == 0)
+                line[n++] = openers[Rng_below(rng, 4)];
+            num_incomplete++;
+        } else {
+            // swap in a closer that does not match
+            if (depth == 0)
+                stack[depth++] = Rng_below(rng, 4);
+            int wrong = (stack[depth - 1] + Rng_range(rng, 1, 3)) % 4;
+            line[n++] = closers[wrong];
+            // the rest of the line does not matter
+            while (n < len + 10)
+                line[n++] = openers[Rng_below(rng, 4)];
+        }
+        line[n] = '\0';
+        puts(line);
+    }
+}
+
+/* Day 11: octopus energy levels. Levels spread over all of 0-9 settle
+   into cycles that never synchronize once the grid is much bigger than
+   10x10, so levels are drawn from 0 .. OCTOPUS_SPREAD - 1, which
+   synchronizes within a few dozen steps at any size. */
+void gen_octopuses(struct Rng *rng, struct GenOptions *opt)
+{
+    int side = scaled_side(10, opt->scale);
+    char *row = malloc(side + 1);
+    assert(row != NULL);
+    for (int r = 0; r < side; r++) {
+        for (int c = 0; c < side; c++)
+            row[c] = '0' + Rng_below(rng, OCTOPUS_SPREAD);
+        row[side] = '\0';
+        puts(row);
+    }
+    free(row);
+}
+
+/*
+* Name a cave: small caves are lower case, big caves upper case
+*
+* @param    name        string for the name, at least 8 chars
+* @param    index       cave number
+* @param    big         1 for a big cave
+*/
+void cave_name(char name[], int index, int big)
+{
+    char first = big ? 'A' : 'a';
+    int n = 0;
+    // two letters at least, like the puzzle's caves
+    do {
+        name[n++] = first + index % 26;
+        index /= 26;
+    } while ((index > 0 || n < 2) && n < 7);
+    name[n] = '\0';
+}
+
+/* Day 12: start and end, small caves and big caves. Big caves only ever
+   connect to small caves, or there would be endless paths. The graph is
+   made of clusters of caves like the puzzle's that only meet at start and
+   end, so the number of paths grows with the scale rather than
+   exponentially. --small-caves sets the small caves in each cluster. */
+void gen_caves(struct Rng *rng, struct GenOptions *opt)
+{
+    int num_small = opt->small_caves;
+    long num_clusters = scaled(1, opt->scale);
+    char a[8], b[8];
+    if (num_small < 2) {
+        printf("Error: Need at least 2 small caves.\n");
+        exit(-1);
+    }
+    for (long cluster = 0; cluster < num_clusters; cluster++) {
+        int base = cluster * num_small;
+        // start and end each lead to two small caves
+        for (int i = 0; i < 2; i++) {
+            int first = Rng_below(rng, num_small);
+            int second = (first + Rng_range(rng, 1, num_small - 1)) % num_small;
+            cave_name(a, base + first, 0);
+            cave_name(b, base + second, 0);
+            printf((i == 0) ? "start-%s\nstart-%s\n" : "%s-end\n%s-end\n", a, b);
+        }
+        // every big cave leads to a few small caves
+        for (int big = 0; big < 2; big++) {
+            cave_name(a, 2 * cluster + big, 1);
+            for (int i = Rng_range(rng, 2, 4); i > 0; i--) {
+                cave_name(b, base + Rng_below(rng, num_small), 0);
+                printf((Rng_next(rng) >> 63) ? "%s-%s\n" : "%2$s-%1$s\n", a, b);
+            }
+        }
+        // and the small caves are chained together
+        for (int small = 1; small < num_small; small++) {
+            cave_name(a, base + small, 0);
+            cave_name(b, base + Rng_below(rng, small), 0);
+            printf("%s-%s\n", a, b);
+        }
+    }
+}
+
+/* Day 13: the dots are placed by unfolding a random pattern, so no dot
+   is ever on a fold line. The sheet gets more folds as it gets more dots. */
+void gen_folds(struct Rng *rng, struct GenOptions *opt)
+{
+    // the letters take up 40 x 6 once folded; a fold of a sheet w wide
+    // is along x = w, leaving it 2w + 1 wide before the fold
+    int fold_x[32], fold_y[32];
+    int num_x = 0, num_y = 0;
+    long width = 40, height = 6;
+    long num_dots = scaled(800, opt->scale);
+    while (num_x < 5 || num_y < 7 || width * height < 4 * num_dots) {
+        if (num_x < 31 && (num_y >= 31 || width <= height || num_x < 5)) {
+            fold_x[num_x++] = width;
+            width = 2 * width + 1;
+        } else {
+            fold_y[num_y++] = height;
+            height = 2 * height + 1;
+        }
+    }
+
+    unsigned char pattern[40 * 6];
+    for (int i = 0; i < 40 * 6; i++)
+        pattern[i] = Rng_next(rng) >> 63;
+    pattern[0] = 1;
+    for (long i = 0; i < num_dots; i++) {
+        long x, y;
+        do {
+            x = Rng_below(rng, 40);
+            y = Rng_below(rng, 6);
+        } while (!pattern[y * 40 + x]);
+        // unfold from the smallest fold out
+        for (int f = 0; f < num_x; f++)
+            if (Rng_next(rng) >> 63)
+                x = 2 * fold_x[f] - x;
+        for (int f = 0; f < num_y; f++)
+            if (Rng_next(rng) >> 63)
+                y = 2 * fold_y[f] - y;
+        printf("%ld,%ld\n", x, y);
+    }
+
+    // the folds are made from the largest in, alternating the axes
+    printf("\n");
+    while (num_x > 0 || num_y > 0) {
+        if (num_x > 0)
+            printf("fold along x=%d\n", fold_x[--num_x]);
+        if (num_y > 0)
+            printf("fold along y=%d\n", fold_y[--num_y]);
+    }
+}
+
+/*
+* Write a code point as UTF-8
+*
+* @param    code        code point below 0x10000
+*/
+void put_code_point(uint32_t code)
+{
+    if (code < 0x80) {
+        putchar(code);
+    } else if (code < 0x800) {
+        putchar(0xC0 | (code >> 6));
+        putchar(0x80 | (code & 0x3F));
+    } else {
+        putchar(0xE0 | (code >> 12));
+        putchar(0x80 | ((code >> 6) & 0x3F));
+        putchar(0x80 | (code & 0x3F));
+    }
+}
+
+/* Day 14 elements: A to Z, then CJK ideographs for as many more as needed */
+uint32_t element_code(int index)
+{
+    return (index < 26) ? 'A' + index : 0x4E00 + (index - 26);
+}
+
+/* Day 14: a template and an insertion rule for every pair of elements.
+   The rules grow with the scale, so the elements grow with its root. */
+void gen_polymer(struct Rng *rng, struct GenOptions *opt)
+{
+    int num_elements = scaled_side(10, opt->scale);
+    if (num_elements > 20000)
+        num_elements = 20000;
+    for (long i = scaled(20, opt->scale); i > 0; i--)
+        put_code_point(element_code(Rng_below(rng, num_elements)));
+    printf("\n\n");
+    for (int first = 0; first < num_elements; first++) {
+        for (int second = 0; second < num_elements; second++) {
+            put_code_point(element_code(first));
+            put_code_point(element_code(second));
+            printf(" -> ");
+            put_code_point(element_code(Rng_below(rng, num_elements)));
+            printf("\n");
+        }
+    }
+}
+
+/* Day 15: risk levels 1-9 */
+void gen_risk(struct Rng *rng, struct GenOptions *opt)
+{
+    int side = scaled_side(100, opt->scale);
+    char *row = malloc(side + 1);
+    assert(row != NULL);
+    for (int r = 0; r < side; r++) {
+        for (int c = 0; c < side; c++)
+            row[c] = '1' + Rng_below(rng, 9);
+        row[side] = '\0';
+        puts(row);
+    }
+    free(row);
+}
+
+struct Generator {
+    int day;
+    void (*generate)(struct Rng *rng, struct GenOptions *opt);
+};
+
+const struct Generator generators[] = {
+    { 1, gen_depths }, { 3, gen_diagnostic }, { 4, gen_bingo },
+    { 5, gen_vents }, { 6, gen_fish }, { 7, gen_crabs },
+    { 8, gen_displays }, { 9, gen_heightmap }, { 10, gen_brackets },
+    { 11, gen_octopuses }, { 12, gen_caves }, { 13, gen_folds },
+    { 14, gen_polymer }, { 15, gen_risk },
+};
+
+int main(int argc, char *argv[])
+{
+    struct GenOptions opt = { 1.0, 1, 12, 8 };
+    if (argc < 2) {
+        printf("usage: gen <day> [--scale X] [--seed S] [--width W] "
+                "[--small-caves K]\n");
+        return 1;
+    }
+    int day = atoi(argv[1]);
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            opt.scale = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            opt.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            opt.width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--small-caves") == 0 && i + 1 < argc) {
+            opt.small_caves = atoi(argv[++i]);
+        } else {
+            printf("Error: Unknown option %s.\n", argv[i]);
+            return 1;
+        }
+    }
+    if (opt.scale <= 0 || opt.width < 1 || opt.width > 64) {
+        printf("Error: Scale must be positive and width 1 to 64 bits.\n");
+        return 1;
+    }
+
+    struct Rng rng = { opt.seed };
+    static char out_buffer[1 << 16];
+    setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+    for (int g = 0; g < sizeof(generators) / sizeof(generators[0]); g++) {
+        if (generators[g].day == day) {
+            generators[g].generate(&rng, &opt);
+            return 0;
+        }
+    }
+    printf("Error: No generator for day %d.\n", day);
+    return 1;
+}
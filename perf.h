@@ -0,0 +1,125 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/* Hardware performance counters through perf_event_open(2), Linux only.
+   Each counter is opened on its own so that a machine (or a VM, or a
+   perf_event_paranoid setting) that lacks some of them still counts the
+   rest; a counter that could not be opened reads as PERF_UNAVAILABLE.
+   Only user space is counted, which perf_event_paranoid 2 allows.
+   Counters are inherited by threads created while they are open, but
+   a thread's counts only reach its creator's once the thread exits. */
+
+#define PERF_UNAVAILABLE UINT64_MAX
+
+enum PerfCounter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_PAGE_FAULTS,
+    PERF_NUM_COUNTERS
+};
+
+static const char *const perf_counter_names[PERF_NUM_COUNTERS] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses",
+    "page_faults"
+};
+
+struct PerfCounters {
+    int fds[PERF_NUM_COUNTERS];     // -1 for a counter that is not available
+};
+
+static inline int perf_open_counter(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+* Open every counter for the calling thread, stopped
+*
+* @param    perf        the counters
+* @retval   num_open    number of counters available
+*/
+static inline int PerfCounters_open(struct PerfCounters *perf)
+{
+    const uint64_t cache_miss = PERF_COUNT_HW_CACHE_OP_READ << 8
+        | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    perf->fds[PERF_CYCLES] = perf_open_counter(PERF_TYPE_HARDWARE,
+            PERF_COUNT_HW_CPU_CYCLES);
+    perf->fds[PERF_INSTRUCTIONS] = perf_open_counter(PERF_TYPE_HARDWARE,
+            PERF_COUNT_HW_INSTRUCTIONS);
+    perf->fds[PERF_L1D_MISSES] = perf_open_counter(PERF_TYPE_HW_CACHE,
+            PERF_COUNT_HW_CACHE_L1D | cache_miss);
+    perf->fds[PERF_LLC_MISSES] = perf_open_counter(PERF_TYPE_HW_CACHE,
+            PERF_COUNT_HW_CACHE_LL | cache_miss);
+    perf->fds[PERF_BRANCH_MISSES] = perf_open_counter(PERF_TYPE_HARDWARE,
+            PERF_COUNT_HW_BRANCH_MISSES);
+    perf->fds[PERF_PAGE_FAULTS] = perf_open_counter(PERF_TYPE_SOFTWARE,
+            PERF_COUNT_SW_PAGE_FAULTS);
+
+    int num_open = 0;
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+        num_open += perf->fds[c] >= 0;
+    return num_open;
+}
+
+/* Zero the counters and start counting */
+static inline void PerfCounters_start(struct PerfCounters *perf)
+{
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++) {
+        if (perf->fds[c] < 0)
+            continue;
+        ioctl(perf->fds[c], PERF_EVENT_IOC_RESET, 0);
+        ioctl(perf->fds[c], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+/*
+* Stop counting and read the counts since PerfCounters_start()
+*
+* @param    perf        the counters
+* @param    counts      count of each counter, PERF_UNAVAILABLE if it is
+*                       not available (output)
+*/
+static inline void PerfCounters_stop(struct PerfCounters *perf,
+        uint64_t counts[PERF_NUM_COUNTERS])
+{
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++) {
+        counts[c] = PERF_UNAVAILABLE;
+        if (perf->fds[c] < 0)
+            continue;
+        ioctl(perf->fds[c], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t count;
+        if (read(perf->fds[c], &count, sizeof(count)) == sizeof(count))
+            counts[c] = count;
+    }
+}
+
+static inline void PerfCounters_close(struct PerfCounters *perf)
+{
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++) {
+        if (perf->fds[c] >= 0)
+            close(perf->fds[c]);
+        perf->fds[c] = -1;
+    }
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef SOLVERS_H
+#define SOLVERS_H
+
+#include <stdlib.h>
+#include "bench.h"
+
+/* Every solved day, for the programs that link all the days together
+   (see the obj/%.o rule in the Makefile) */
+
+extern const struct Solver day1_solver, day3_solver, day4_solver, day5_solver,
+       day6_solver, day7_solver, day8_solver, day9_solver, day10_solver,
+       day11_solver, day12_solver, day13_solver, day14_solver, day15_solver;
+
+static const struct Solver *const solvers[] = {
+    &day1_solver, &day3_solver, &day4_solver, &day5_solver, &day6_solver,
+    &day7_solver, &day8_solver, &day9_solver, &day10_solver, &day11_solver,
+    &day12_solver, &day13_solver, &day14_solver, &day15_solver
+};
+#define NUM_SOLVERS (int)(sizeof(solvers) / sizeof(solvers[0]))
+
+/*
+* Find a day's solver. Days may be given with their file suffix, as in 3b.
+*
+* @param    day         day number
+* @retval   solver      the day's solver, NULL if the day is not solved
+*/
+static inline const struct Solver *find_solver(const char *day)
+{
+    int n = atoi(day);
+    for (int i = 0; i < NUM_SOLVERS; i++) {
+        if (atoi(solvers[i]->day) == n)
+            return solvers[i];
+    }
+    return NULL;
+}
+
+#endif
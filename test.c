@@ -1,15 +1,144 @@
 #include "util.h"
+#include "bench.h"
 #include <stdio.h>
-#include <errno.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 
-/*#define AssertEq(left, right) test_assert_eq(#left " == " #right, left, right)*/
-#define CreateTest(left, right) tests[num_tests] = *Test_create(#left " == " #right, left, right); num_tests++;
+/* Test runner. A test is a function that makes any number of checks; the
+   tests are registered in main() and not run until Tests_run(), which
+   runs them in parallel on a thread pool and times each one. A test only
+   reports through the struct TestContext it is given and its return
+   value, the number of failed checks, so tests can run on any thread.
+   (errnum is thread local for the same reason.)
 
-//#define CTA(fcn, args, res) tests[num_tests] = *Test_create_args(fcn, args, res); num_tests++;
+   usage: test [-j N] [name...]
 
-#define MAX_TESTS 1024
+   Runs the tests whose names contain any of the given names, or every
+   test, on N threads (default one per processor). */
+
+/* Check that left == right and that nothing set errnum on the way */
+#define Check(left, right) Test_check(ctx, #left " == " #right, (left), (right))
+
+struct TestContext {
+    int checks;
+    int failures;
+    char *log;                  // failure messages, NULL if none
+    size_t log_len;
+};
+
+typedef int (*test_fn)(struct TestContext *ctx);
+
+struct Test {
+    const char *name;
+    test_fn fn;
+    int failures;               // return value of fn
+    uint64_t ns;
+    struct TestContext ctx;
+};
+
+DEFINE_VECTOR(TestVector, struct Test)
+
+/*
+* Append a message to a test's log
+*
+* @param    ctx         the running test
+* @param    format      printf format
+*/
+void Test_log(struct TestContext *ctx, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    char *log = realloc(ctx->log, ctx->log_len + len + 1);
+    if (log == NULL) {
+        printf("Error: Out of memory for a test log.\n");
+        exit(-1);
+    }
+    va_start(args, format);
+    vsnprintf(log + ctx->log_len, len + 1, format, args);
+    va_end(args);
+    ctx->log = log;
+    ctx->log_len += len;
+}
+
+/*
+* Record one check
+*
+* @param    ctx         the running test
+* @param    check       text of the check
+* @param    left        value computed
+* @param    right       value expected
+* @retval   failed      1 if the check failed, 0 if it passed
+*/
+int Test_check(struct TestContext *ctx, const char *check, long long left,
+        long long right)
+{
+    int err = errnum;
+    errnum = 0;
+    ctx->checks++;
+    if (err == 0 && left == right)
+        return 0;
+    ctx->failures++;
+    if (err != 0)
+        Test_log(ctx, "    %s: FAIL: Errnum = %d\n", check, err);
+    else
+        Test_log(ctx, "    %s: FAIL. Expected: %lld; Received: %lld\n", check,
+                right, left);
+    return 1;
+}
+
+void Tests_add(struct TestVector *tests, const char *name, test_fn fn)
+{
+    TestVector_push(tests, (struct Test){ .name = name, .fn = fn });
+}
+
+void Test_task(void *ctx, int task)
+{
+    struct Test *test = &((struct Test *)ctx)[task];
+    errnum = 0;
+    uint64_t start = bench_now();
+    test->failures = test->fn(&test->ctx);
+    test->ns = bench_now() - start;
+}
+
+/*
+* Run tests in parallel and print their results in the order they were
+* added
+*
+* @param    tests       the tests to run
+* @param    num_threads number of threads, 0 for one per processor
+* @retval   failed      number of tests that failed
+*/
+int Tests_run(struct TestVector *tests, int num_threads)
+{
+    struct ThreadPool *pool = ThreadPool_create(num_threads);
+    uint64_t start = bench_now();
+    ThreadPool_run(pool, Test_task, tests->data, tests->size);
+    uint64_t elapsed = bench_now() - start;
+    ThreadPool_destroy(pool);
+
+    int num_passed = 0, num_checks = 0, num_failed_checks = 0;
+    for (size_t i = 0; i < tests->size; i++) {
+        struct Test *test = &tests->data[i];
+        // a test may fail without a failed check, by returning nonzero
+        int pass = test->failures == 0 && test->ctx.failures == 0;
+        printf("%s %-24s %4d checks %10.1f us\n", pass ? "PASS" : "FAIL",
+                test->name, test->ctx.checks, test->ns / 1e3);
+        if (test->ctx.log != NULL)
+            printf("%s", test->ctx.log);
+        num_passed += pass;
+        num_checks += test->ctx.checks;
+        num_failed_checks += test->ctx.failures;
+        free(test->ctx.log);
+        test->ctx.log = NULL;
+    }
+    printf("----------\n");
+    printf("%d/%zu Tests Passed, %d/%d checks, in %.3f ms.\n", num_passed,
+            tests->size, num_checks - num_failed_checks, num_checks, elapsed / 1e6);
+    return tests->size - num_passed;
+}
 
 // Tests for integer array functions
 int test_arr_1[] = { -1, -2, -1, -5, -4, -10 };
@@ -24,130 +153,215 @@ int test_arr_4[] = { 3437, 432, 3, 29, 20, -1024 };
 int test_arr_5[] = { 5 };
 int test_arr_6[] = { 0, 0, 0, 0, 0, 0 }; // array of zeroes
 
-//int errnum = 0;
+int test_min(struct TestContext *ctx)
+{
+    int failed = 0;
+    failed += Check(*min(test_arr_1, &n1), -10);
+    failed += Check(*min(test_arr_2, &n1), -3432);
+    failed += Check(*min(test_arr_3, &n1), -77);
+    failed += Check(*min(test_arr_4, &n1), -1024);
+    failed += Check(*min(test_arr_6, &n1), 0);
+    failed += Check(*min(test_arr_5, &n2), 5);
+    return failed;
+}
 
-struct Test {
-    int input;
-    int output;
-    int pass;
-    int errnum;
-    char *function;
-};
+int test_max(struct TestContext *ctx)
+{
+    int failed = 0;
+    failed += Check(*max(test_arr_1, &n1), -1);
+    failed += Check(*max(test_arr_2, &n1), 0);
+    failed += Check(*max(test_arr_3, &n1), 1024);
+    failed += Check(*max(test_arr_4, &n1), 3437);
+    failed += Check(*max(test_arr_5, &n2), 5);
+    failed += Check(*max(test_arr_6, &n1), 0);
+    return failed;
+}
+
+int test_is_in(struct TestContext *ctx)
+{
+    int failed = 0;
+    failed += Check(is_in(0, test_arr_2, n1), 1);
+    failed += Check(is_in(1777, test_arr_2, n1), 0);
+    failed += Check(is_in(1777, test_arr_5, n2), 0);
+    failed += Check(is_in(5, test_arr_5, n2), 1);
+    return failed;
+}
 
-struct Test *Test_create(char function[], int input, int output)
+int test_range(struct TestContext *ctx)
 {
-    /* As written, this function RUNS the test case immediately.
-       Goal is to have it only point to a function, and then
-       run that function on command. */
-    struct Test *ts = malloc(sizeof(struct Test));
-    ts->function = strdup(function);
-    ts->input = input;
-    ts->output = output;
-    ts->errnum = errnum;
+    int failed = 0;
+    failed += Check(range(test_arr_5, &n2), 0);
+    failed += Check(range(test_arr_6, &n2), 0);
+    failed += Check(range(test_arr_1, &n1), 9);
+    failed += Check(range(test_arr_4, &n1), 4461);
+    return failed;
+}
+
+int test_sum(struct TestContext *ctx)
+{
+    int failed = 0;
+    failed += Check(sum(test_arr_5, &n2), 5);
+    failed += Check(sum(test_arr_6, &n2), 0);
+    failed += Check(sum(test_arr_1, &n1), -23);
+    failed += Check(sum(test_arr_4, &n1), 2902);
+    return failed;
+}
+
+int test_mean(struct TestContext *ctx)
+{
+    int failed = 0;
+    failed += Check(mean(test_arr_5, &n2), 5);
+    failed += Check(mean(test_arr_6, &n2), 0);
+    failed += Check(mean(test_arr_1, &n1), -3);
+    failed += Check(mean(test_arr_4, &n1), 483);
+    return failed;
+}
+
+int test_parse_ints(struct TestContext *ctx)
+{
+    char text[] = "16,1,2,0,4,2,7,1,2,14\n-2147483648,5";
+    char too_big[] = "3,123456789012,5";
+    int *values = NULL;
+    int n = 0, capacity = 0;
+    int failed = 0;
+    failed += Check(parse_ints(text, strlen(text), &values, &n, &capacity), 12);
+    failed += Check(values[0], 16);
+    failed += Check(values[9], 14);
+    failed += Check(values[10], -2147483648LL);
+    failed += Check(values[11], 5);
+    // out of range: an error, keeping the numbers before it
+    n = 0;
+    int added = parse_ints(too_big, strlen(too_big), &values, &n, &capacity);
+    int err = errnum;
     errnum = 0;
-    if (ts->input != ts->output) {
-        ts->pass = 0;
-    } else {
-        ts->pass = 1;
-    }
+    failed += Check(added, -1);
+    failed += Check(err, 1);
+    failed += Check(n, 1);
+    free(values);
+    return failed;
+}
 
-    return ts;
+int test_split_input(struct TestContext *ctx)
+{
+    char text[] = "7,-3,0";
+    char bad[] = "7,x,0";
+    int values[3];
+    int failed = 0;
+    failed += Check(split_input(text, values, ","), 3);
+    failed += Check(values[1], -3);
+    int num = split_input(bad, values, ",");
+    int err = errnum;
+    errnum = 0;
+    failed += Check(num, -1);
+    failed += Check(err, 1);
+    return failed;
 }
 
-void Test_print(struct Test *ts)
+// reference hashes
+int test_xxh64(struct TestContext *ctx)
 {
-    printf("Test is: %s\n", ts->function);
+    char test_text[] = "Nobody inspects the spammish repetition, "
+        "or the 64 bit hashes of it either";
+    int failed = 0;
+    failed += Check(xxh64("", 0, 0) == 0xEF46DB3751D8E999ull, 1);
+    failed += Check(xxh64("abc", 3, 0) == 0x44BC2CF5AD770999ull, 1);
+    failed += Check(xxh64(test_text, 40, 0) == 0xF2995CA6B96DAB88ull, 1);
+    failed += Check(xxh64(test_text, 40, 0) != xxh64(test_text, 40, 1), 1);
+    return failed;
 }
 
-void Test_assert_eq(struct Test *ts)
+int test_try_read_file(struct TestContext *ctx)
 {
-    printf("Test assertion: ");
-    printf("%s: ", ts->function);
-    if (ts->errnum != 0) {
-        printf("FAIL: Errnum = %d\n", ts->errnum);
-        ts->pass = 0;
-    } else if (ts->input == ts->output) {
-        printf("PASS\n");
-        ts->pass = 1;
-    } else {
-        printf("FAIL. errno = %d\n", errno);
-        printf("Expected: %d; Received: %d\n", ts->input, ts->output);
-    }
-    errnum = 0; // reset for next function
+    char path[] = "/tmp/test_read_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return Check(fd >= 0, 1);
+    int failed = Check(write(fd, "1,2\n", 4), 4);
+    close(fd);
+    size_t size = 0;
+    char *text = try_read_file(path, &size);
+    failed += Check(text != NULL && strcmp(text, "1,2\n") == 0, 1);
+    failed += Check(size, 4);
+    free(text);
+    unlink(path);
+
+    // a missing file and a directory fail without exiting
+    char *missing = try_read_file(path, &size);
+    int missing_errno = errno;
+    char *dir = try_read_file("/tmp", &size);
+    int dir_errno = errno;
+    int err = errnum;
+    errnum = 0;
+    failed += Check(missing == NULL && dir == NULL, 1);
+    failed += Check(missing_errno, ENOENT);
+    failed += Check(dir_errno, EISDIR);
+    failed += Check(err, 1);
+    return failed;
+}
+
+#define STRESS_MAX_TASKS 8
+
+struct StressBatch {
+    int runs[STRESS_MAX_TASKS];
+};
+
+void stress_task(void *ctx, int task)
+{
+    struct StressBatch *batch = ctx;
+    __atomic_add_fetch(&batch->runs[task], 1, __ATOMIC_RELAXED);
 }
 
-void Tests_run(struct Test *tests, int *num_tests)
+/* Many small batches back to back on one pool, each with its context on
+   the stack, so a worker that runs a task of a finished batch, or a task
+   twice, shows up as a wrong count */
+int test_thread_pool(struct TestContext *ctx)
 {
-    int num_passed = 0;
-    for(int i = 0; i < *num_tests; i++) {
-        Test_assert_eq(&tests[i]);
-        if (tests[i].pass)
-            num_passed++;
+    struct ThreadPool *pool = ThreadPool_create(STRESS_MAX_TASKS);
+    int num_wrong = 0;
+    for (int run = 0; run < 200000; run++) {
+        struct StressBatch batch = { { 0 } };
+        int num_tasks = 1 + run % STRESS_MAX_TASKS;
+        ThreadPool_run(pool, stress_task, &batch, num_tasks);
+        for (int task = 0; task < STRESS_MAX_TASKS; task++)
+            num_wrong += batch.runs[task] != (task < num_tasks);
     }
-    printf("----------\n");
-    printf("%d/%d Tests Passed.\n", num_passed, *num_tests);
+    ThreadPool_destroy(pool);
+    return Check(num_wrong, 0);
 }
 
 int main(int argc, char *argv[])
 {
-    int num_tests = 0;
-    struct Test tests[MAX_TESTS];
-
-    // "util.h/min"
-    CreateTest(*min(test_arr_1, &n1), -10);
-    CreateTest(*min(test_arr_2, &n1), -3432);
-    CreateTest(*min(test_arr_3, &n1), -77);
-    CreateTest(*min(test_arr_4, &n1), -1024);
-    CreateTest(*min(test_arr_6, &n1), 0);
-    CreateTest(*min(test_arr_5, &n2), 5);
-
-    // "util.h/max"
-    CreateTest(*max(test_arr_1, &n1), -1);
-    CreateTest(*max(test_arr_2, &n1), 0);
-    CreateTest(*max(test_arr_3, &n1), 1024);
-    CreateTest(*max(test_arr_4, &n1), 3437);
-    CreateTest(*max(test_arr_5, &n2), 5);
-    CreateTest(*max(test_arr_6, &n1), 0);
-
-    // "util.h/is_in"
-    CreateTest(is_in(0, test_arr_2, n1), 1);
-    CreateTest(is_in(1777, test_arr_2, n1), 0);
-    CreateTest(is_in(1777, test_arr_5, n2), 0);
-    CreateTest(is_in(5, test_arr_5, n2), 1);
-
-    // "util.h/range"
-    CreateTest(range(test_arr_5, &n2), 0);
-    CreateTest(range(test_arr_6, &n2), 0);
-    CreateTest(range(test_arr_1, &n1), 9);
-    CreateTest(range(test_arr_4, &n1), 4461);
-
-    // "util.h/sum"
-    CreateTest(sum(test_arr_5, &n2), 5);
-    CreateTest(sum(test_arr_6, &n2), 0);
-    CreateTest(sum(test_arr_1, &n1), -23);
-    CreateTest(sum(test_arr_4, &n1), 2902);
-
-    // "util.h/mean"
-    CreateTest(mean(test_arr_5, &n2), 5);
-    CreateTest(mean(test_arr_6, &n2), 0);
-    CreateTest(mean(test_arr_1, &n1), -3);
-    CreateTest(mean(test_arr_4, &n1), 483);
-
-    Tests_run(tests, &num_tests);
-
-    return 0;
-}
-
-int test_assert_eq(char function[], int left, int right)
-{
-    printf("Test assertion: ");
-    printf("%s: ", function);
-    if (left == right) {
-        printf("PASS\n");
-        return 0;
-    } else {
-        printf("FAIL. errno = %d\n", errno);
-        printf("Expected: %d; Received: %d\n", right, left);
-        return 1;
+    int num_threads = 0;
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "-j") == 0) {
+        num_threads = atoi(argv[arg + 1]);
+        arg += 2;
     }
+
+    struct TestVector all = { 0 };
+    Tests_add(&all, "util.h/min", test_min);
+    Tests_add(&all, "util.h/max", test_max);
+    Tests_add(&all, "util.h/is_in", test_is_in);
+    Tests_add(&all, "util.h/range", test_range);
+    Tests_add(&all, "util.h/sum", test_sum);
+    Tests_add(&all, "util.h/mean", test_mean);
+    Tests_add(&all, "util.h/parse_ints", test_parse_ints);
+    Tests_add(&all, "util.h/split_input", test_split_input);
+    Tests_add(&all, "util.h/xxh64", test_xxh64);
+    Tests_add(&all, "util.h/try_read_file", test_try_read_file);
+    Tests_add(&all, "util.h/ThreadPool", test_thread_pool);
+
+    struct TestVector tests = { 0 };
+    for (size_t i = 0; i < all.size; i++) {
+        int selected = (arg == argc);
+        for (int a = arg; a < argc && !selected; a++)
+            selected = strstr(all.data[i].name, argv[a]) != NULL;
+        if (selected)
+            TestVector_push(&tests, all.data[i]);
+    }
+
+    int failed = Tests_run(&tests, num_threads);
+    TestVector_free(&tests);
+    TestVector_free(&all);
+    return failed > 0;
 }
@@ -1,23 +1,175 @@
+#ifndef UTIL_H
+#define UTIL_H
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef TRACK_ALLOC
+#include <malloc.h>
+#include <sys/resource.h>
+
+/* Allocation tracking, opt in with -DTRACK_ALLOC. Every malloc, calloc,
+   realloc and free in a file that includes util.h goes through the
+   track_ functions below, which keep process wide counts in alloc_stats
+   and report any blocks still allocated when the program exits. Sizes
+   are the usable sizes from malloc_usable_size(), so blocks need no
+   header and memory from strdup() and the like can still be freed, at
+   the price of counts that are a little off for it. alloc_stats is a
+   weak symbol so that every file linked into one binary, as in aoc,
+   shares it. See bench.h for the per phase figures. */
+
+struct AllocStats {
+    long long allocs;           // allocations, and reallocations that grew
+    long long bytes;            // bytes they added
+    long long live;             // bytes allocated and not freed
+    long long live_blocks;      // blocks allocated and not freed
+    long long peak;             // most live bytes since alloc_reset_peak()
+    int report_registered;      // the leak report runs at exit
+};
+
+__attribute__((weak)) struct AllocStats alloc_stats;
+
+static inline void alloc_report_leaks(void)
+{
+    long long blocks = __atomic_load_n(&alloc_stats.live_blocks, __ATOMIC_RELAXED);
+    if (blocks > 0)
+        fprintf(stderr, "Warning: Blocks never freed: %lld (%lld bytes).\n",
+                blocks, __atomic_load_n(&alloc_stats.live, __ATOMIC_RELAXED));
+}
+
+/*
+* Count a block coming into use or going out of it
+*
+* @param    bytes       usable size, negative for a freed block
+* @param    blocks      1 for a new block, -1 for a freed one, 0 for a resize
+*/
+static inline void alloc_count(long long bytes, int blocks)
+{
+    if (!__atomic_exchange_n(&alloc_stats.report_registered, 1, __ATOMIC_RELAXED))
+        atexit(alloc_report_leaks);
+    __atomic_add_fetch(&alloc_stats.live_blocks, blocks, __ATOMIC_RELAXED);
+    long long live = __atomic_add_fetch(&alloc_stats.live, bytes, __ATOMIC_RELAXED);
+    if (bytes <= 0)
+        return;
+    __atomic_add_fetch(&alloc_stats.allocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_stats.bytes, bytes, __ATOMIC_RELAXED);
+    long long peak = __atomic_load_n(&alloc_stats.peak, __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&alloc_stats.peak, &peak,
+                live, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static inline void *track_malloc(size_t size)
+{
+    void *ptr = malloc(size);
+    if (ptr != NULL)
+        alloc_count(malloc_usable_size(ptr), 1);
+    return ptr;
+}
+
+static inline void *track_calloc(size_t n, size_t size)
+{
+    void *ptr = calloc(n, size);
+    if (ptr != NULL)
+        alloc_count(malloc_usable_size(ptr), 1);
+    return ptr;
+}
+
+static inline void *track_realloc(void *ptr, size_t size)
+{
+    long long old_size = (ptr != NULL) ? (long long)malloc_usable_size(ptr) : 0;
+    void *new_ptr = realloc(ptr, size);
+    if (new_ptr != NULL)
+        alloc_count((long long)malloc_usable_size(new_ptr) - old_size, ptr == NULL);
+    else if (ptr != NULL && size == 0)
+        alloc_count(-old_size, -1);
+    return new_ptr;
+}
+
+static inline void track_free(void *ptr)
+{
+    if (ptr != NULL)
+        alloc_count(-(long long)malloc_usable_size(ptr), -1);
+    free(ptr);
+}
+
+/* Start a new peak, for both the tracked bytes and the resident set */
+static inline void alloc_reset_peak(void)
+{
+    __atomic_store_n(&alloc_stats.peak, __atomic_load_n(&alloc_stats.live,
+                __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    FILE *file = fopen("/proc/self/clear_refs", "w");
+    if (file != NULL) {
+        fputs("5", file);
+        fclose(file);
+    }
+}
+
+/*
+* Peak resident set size, since alloc_reset_peak() where the kernel allows
+* resetting it and since the program started otherwise
+*
+* @retval   bytes       peak resident set size
+*/
+static inline long long alloc_peak_rss(void)
+{
+    long long kb = -1;
+    char line[256];
+    FILE *file = fopen("/proc/self/status", "r");
+    if (file != NULL) {
+        while (kb < 0 && fgets(line, sizeof(line), file) != NULL)
+            sscanf(line, "VmHWM: %lld kB", &kb);
+        fclose(file);
+    }
+    if (kb < 0) {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        kb = usage.ru_maxrss;
+    }
+    return kb * 1024;
+}
+
+#define malloc(size) track_malloc(size)
+#define calloc(n, size) track_calloc(n, size)
+#define realloc(ptr, size) track_realloc(ptr, size)
+#define free(ptr) track_free(ptr)
+#endif
 
 // TODO: Figure out consistent error handling for this library.
 
-int errnum = 0; /* Used in test.c */
+static __thread int errnum = 0; /* Used in test.c, one per thread */
 
 /** Splits an input string str into an integer array
   * splitting by delims. Returns number of elements
-  * in integer array. */
-int split_input(char str[], int input[], char delims[])
+  * in integer array, or -1 (and sets errnum) if a
+  * piece is not an integer that fits in an int. */
+static inline int split_input(char str[], int input[], char delims[])
 {
     int num = 0;
-    char *ptr = strtok(str, delims);
+    char *saveptr = NULL;
+    char *ptr = strtok_r(str, delims, &saveptr);
     while(ptr != NULL) {
-        input[num] = atoi(ptr);
-        assert(input[num] >= 0);
-        ptr = strtok(NULL, delims);
+        char *rest;
+        errno = 0;
+        long value = strtol(ptr, &rest, 10);
+        if (rest == ptr || *rest != '\0' || errno == ERANGE
+                || value < INT_MIN || value > INT_MAX) {
+            errnum = 1;
+            return -1;
+        }
+        input[num] = (int)value;
+        ptr = strtok_r(NULL, delims, &saveptr);
         num++;
     }
     return num;
@@ -32,7 +184,7 @@ int split_input(char str[], int input[], char delims[])
 * @retval   0               element is not present
 * @reval    1               element is present
 */
-int is_in(const int element, const int *array, const int n) 
+static inline int is_in(const int element, const int *array, const int n) 
 {
     if (n <= 0 ) {
         errnum = 1; 
@@ -53,7 +205,7 @@ int is_in(const int element, const int *array, const int n)
 * @param    n           the length of the array
 *                       (or number of elements to print)
 */
-void print_array(const int array[], const int n)
+static inline void print_array(const int array[], const int n)
 {
     if (array == NULL) {
         printf("Error: print_array() called with bad pointer.\n");
@@ -66,61 +218,168 @@ void print_array(const int array[], const int n)
     printf("]\n");
 }
 
-/*
-* Push an element onto the end of an array
-*
-* @param    p_array             pointer to the array to push to
-* @param    p_n                 pointer to the number of elements in the array
-* @param    element             element to add to the end of the array
-*/
-void push(int *p_array, int *p_n, int element)
-{
-    if (p_array == NULL || p_n == NULL) {
-        printf("Invalid pointer in push()\n");
-        exit(-1);
-    }
-    if (*p_n < 0) {
-        printf("Error: push() attempted to access array of size < 0.\n");
-        exit(-1);
-    }
-    p_array[*p_n] = element;
-    (*p_n)++; // increase array size
+/* Growable containers for any element type. The macros generate a
+   struct and its functions for one element type, e.g.
+
+       DEFINE_VECTOR(IntVector, int)
+       struct IntVector v = { 0 };     // empty, nothing allocated yet
+       IntVector_push(&v, 42);
+
+   Storage doubles when full, so pushes are amortized O(1). _reserve()
+   allocates up front when the final size is known. A stack is a vector
+   used through _push(), _top() and _pop(). A deque is a ring buffer, so
+   both ends are O(1) and nothing is ever shifted. The functions are
+   static inline because each day instantiates the types it needs. */
+#define CONTAINER_GROW(capacity, needed) \
+    ((capacity) == 0 && (needed) <= 16 ? 16 : (capacity) * 2 < (needed) ? (needed) : (capacity) * 2)
+
+#define DEFINE_VECTOR(name, type) \
+struct name { \
+    type *data; \
+    size_t size; \
+    size_t capacity; \
+}; \
+\
+static inline void name##_reserve(struct name *vec, size_t capacity) \
+{ \
+    if (capacity <= vec->capacity) \
+        return; \
+    type *data = realloc(vec->data, capacity * sizeof(type)); \
+    if (data == NULL) { \
+        printf("Error: Could not grow " #name " to %zu elements.\n", capacity); \
+        exit(-1); \
+    } \
+    vec->data = data; \
+    vec->capacity = capacity; \
+} \
+\
+static inline void name##_push(struct name *vec, type element) \
+{ \
+    if (vec->size == vec->capacity) \
+        name##_reserve(vec, CONTAINER_GROW(vec->capacity, vec->size + 1)); \
+    vec->data[vec->size++] = element; \
+} \
+\
+static inline type name##_pop(struct name *vec) \
+{ \
+    if (vec->size == 0) { \
+        printf("Error: pop() from empty " #name ".\n"); \
+        exit(-1); \
+    } \
+    return vec->data[--vec->size]; \
+} \
+\
+static inline type name##_top(struct name *vec) \
+{ \
+    if (vec->size == 0) { \
+        printf("Error: top() of empty " #name ".\n"); \
+        exit(-1); \
+    } \
+    return vec->data[vec->size - 1]; \
+} \
+\
+static inline void name##_clear(struct name *vec) \
+{ \
+    vec->size = 0; \
+} \
+\
+static inline void name##_free(struct name *vec) \
+{ \
+    free(vec->data); \
+    vec->data = NULL; \
+    vec->size = vec->capacity = 0; \
 }
 
-/*
-* Push an element onto the end of an array that is not already in
-* the array
-*
-* @param    p_array             pointer to the array to push to
-* @param    p_n                 pointer to the number of elements in the array
-* @param    element             element to add to the end of the array
-*/
-void push_unique(int *p_array, int *p_n, int element)
-{
-    if (!is_in(element, p_array, *p_n)) {
-        push(p_array, p_n, element);
-    }
+#define DEFINE_STACK(name, type) DEFINE_VECTOR(name, type)
+
+#define DEFINE_DEQUE(name, type) \
+struct name { \
+    type *data; \
+    size_t head;        /* index of the front element */ \
+    size_t size; \
+    size_t capacity;    /* always a power of 2 */ \
+}; \
+\
+static inline void name##_reserve(struct name *deq, size_t capacity) \
+{ \
+    if (capacity <= deq->capacity) \
+        return; \
+    size_t new_capacity = 16; \
+    while (new_capacity < capacity) \
+        new_capacity *= 2; \
+    type *data = malloc(new_capacity * sizeof(type)); \
+    if (data == NULL) { \
+        printf("Error: Could not grow " #name " to %zu elements.\n", new_capacity); \
+        exit(-1); \
+    } \
+    /* unwrap the ring so the front is at index 0 again */ \
+    size_t i; \
+    for (i = 0; i < deq->size; i++) \
+        data[i] = deq->data[(deq->head + i) & (deq->capacity - 1)]; \
+    free(deq->data); \
+    deq->data = data; \
+    deq->head = 0; \
+    deq->capacity = new_capacity; \
+} \
+\
+static inline void name##_push_back(struct name *deq, type element) \
+{ \
+    if (deq->size == deq->capacity) \
+        name##_reserve(deq, deq->size + 1); \
+    deq->data[(deq->head + deq->size++) & (deq->capacity - 1)] = element; \
+} \
+\
+static inline void name##_push_front(struct name *deq, type element) \
+{ \
+    if (deq->size == deq->capacity) \
+        name##_reserve(deq, deq->size + 1); \
+    deq->head = (deq->head - 1) & (deq->capacity - 1); \
+    deq->data[deq->head] = element; \
+    deq->size++; \
+} \
+\
+static inline type name##_pop_front(struct name *deq) \
+{ \
+    if (deq->size == 0) { \
+        printf("Error: pop_front() from empty " #name ".\n"); \
+        exit(-1); \
+    } \
+    type element = deq->data[deq->head]; \
+    deq->head = (deq->head + 1) & (deq->capacity - 1); \
+    deq->size--; \
+    return element; \
+} \
+\
+static inline type name##_pop_back(struct name *deq) \
+{ \
+    if (deq->size == 0) { \
+        printf("Error: pop_back() from empty " #name ".\n"); \
+        exit(-1); \
+    } \
+    deq->size--; \
+    return deq->data[(deq->head + deq->size) & (deq->capacity - 1)]; \
+} \
+\
+static inline void name##_free(struct name *deq) \
+{ \
+    free(deq->data); \
+    deq->data = NULL; \
+    deq->head = deq->size = deq->capacity = 0; \
 }
 
+DEFINE_VECTOR(IntVector, int)
+
 /*
-* pop an element off of the end of an array
+* Push an int onto the end of a vector if it is not already in the vector
 *
-* @param    p_array             pointer to the array to pop from
-* @param    p_n                 pointer to the number of elements in the array
-* @retval   element             element at the end of the array
+* @param    vec                 the vector to push to
+* @param    element             element to add to the end of the vector
 */
-int pop(int *p_array, int *p_n)
+static inline void IntVector_push_unique(struct IntVector *vec, int element)
 {
-    if (p_array == NULL || p_n == NULL) {
-        printf("Invalid pointer in pop()\n");
-        exit(-1);
-    }
-    if (*p_n < 0) {
-        printf("Error: pop() attempted to access array of size < 0.\n");
-        exit(-1);
+    if (vec->size == 0 || !is_in(element, vec->data, vec->size)) {
+        IntVector_push(vec, element);
     }
-    (*p_n)--; // decrease the size of the array
-    return p_array[*p_n];
 }
 
 /*
@@ -130,7 +389,7 @@ int pop(int *p_array, int *p_n)
 * @param    n       number of elements
 * @retval   min     the smallest element in the array
 */
-int *min(int *arr, const int *n)
+static inline int *min(int *arr, const int *n)
 {
     if (arr == NULL) {
         printf("Bad array");
@@ -157,7 +416,7 @@ int *min(int *arr, const int *n)
 * @param    n       number of elements
 * @retval   max     the largest element in the array
 */
-int *max(int *arr, int *n)
+static inline int *max(int *arr, int *n)
 {
     assert(arr != NULL);
     assert(n != NULL);
@@ -182,7 +441,7 @@ int *max(int *arr, int *n)
 *                   (or first n elements to sum)
 * @retval   sum     sum of all elements in array
 */
-int sum(int *arr, int *n)
+static inline int sum(int *arr, int *n)
 {
     int *cur = arr;
     int sum = 0;
@@ -200,7 +459,7 @@ int sum(int *arr, int *n)
 *                   (or first n elements to find range of)
 * @retval   range   maximum - minimum values
 */
-int range(int *arr, int *n)
+static inline int range(int *arr, int *n)
 {
     if (*n <= 0) {
         errnum = 1;
@@ -216,7 +475,7 @@ int range(int *arr, int *n)
 *                   (or first n elements to find mean of)
 * @retval   mean    The mean of the first n elements
 */
-int mean(int *arr, int *n)
+static inline int mean(int *arr, int *n)
 {
     if (*n <= 0) {
         errnum = 1;
@@ -224,3 +483,901 @@ int mean(int *arr, int *n)
     }
     return (sum(arr, n) / *n);
 }
+
+/* A fixed set of worker threads that run batches of independent tasks.
+   ThreadPool_run() hands out task numbers 0 .. num_tasks - 1 to the
+   workers (and the calling thread) and returns when all are finished,
+   so a pool can be created once and reused for every parallel phase. */
+typedef void (*task_fn)(void *ctx, int task);
+
+struct ThreadPool {
+    int num_threads;            // including the calling thread
+    pthread_t *workers;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    unsigned long generation;   // incremented for every batch
+    int busy;                   // workers still inside a batch
+    int shutdown;
+
+    task_fn fn;
+    void *ctx;
+    int num_tasks;
+    int next_task;
+    int tasks_done;
+};
+
+/*
+* Claim and run tasks from the current batch until there are none left.
+* The batch is passed in as read under the lock, never read from the
+* pool here, so that a thread still in one batch never sees the next.
+*
+* @param    pool        the thread pool
+* @param    fn          the batch's task function
+* @param    ctx         the batch's context
+* @param    num_tasks   the batch's number of tasks
+*/
+static inline void ThreadPool_work(struct ThreadPool *pool, task_fn fn, void *ctx,
+        int num_tasks)
+{
+    int task;
+    while ((task = __atomic_fetch_add(&pool->next_task, 1, __ATOMIC_RELAXED))
+            < num_tasks) {
+        fn(ctx, task);
+        if (__atomic_add_fetch(&pool->tasks_done, 1, __ATOMIC_ACQ_REL)
+                == num_tasks) {
+            pthread_mutex_lock(&pool->lock);
+            pthread_cond_signal(&pool->work_done);
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+}
+
+static inline void *ThreadPool_worker(void *arg)
+{
+    struct ThreadPool *pool = arg;
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        // only join a batch that still has tasks to hand out. A worker
+        // that wakes late would otherwise count itself into a finished
+        // batch while ThreadPool_run() starts the next one.
+        while (!pool->shutdown && (pool->generation == seen
+                || __atomic_load_n(&pool->next_task, __ATOMIC_RELAXED) >= pool->num_tasks)) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown)
+            break;
+        // take the batch together with its generation
+        seen = pool->generation;
+        task_fn fn = pool->fn;
+        void *ctx = pool->ctx;
+        int num_tasks = pool->num_tasks;
+        pool->busy++;
+        pthread_mutex_unlock(&pool->lock);
+        ThreadPool_work(pool, fn, ctx, num_tasks);
+        pthread_mutex_lock(&pool->lock);
+        // a new batch may only start once no worker is still in this one
+        if (--pool->busy == 0)
+            pthread_cond_signal(&pool->work_done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/*
+* Create a thread pool
+*
+* @param    num_threads     number of threads, including the caller.
+*                           0 uses one per online processor.
+* @retval   pool            pointer to the thread pool
+*/
+static inline struct ThreadPool *ThreadPool_create(int num_threads)
+{
+    if (num_threads <= 0)
+        num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads <= 0)
+        num_threads = 1;
+
+    struct ThreadPool *pool = calloc(1, sizeof(struct ThreadPool));
+    if (pool == NULL) {
+        printf("Error: Could not allocate thread pool.\n");
+        exit(-1);
+    }
+    pool->num_threads = num_threads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    pool->workers = malloc((num_threads - 1) * sizeof(pthread_t) + 1);
+    for (int i = 0; i < num_threads - 1; i++) {
+        if (pthread_create(&pool->workers[i], NULL, ThreadPool_worker, pool) != 0) {
+            printf("Error: Could not start worker thread %d.\n", i);
+            exit(-1);
+        }
+    }
+    return pool;
+}
+
+/*
+* Run fn(ctx, task) for every task in 0 .. num_tasks - 1 and wait for
+* all of them to finish. Tasks may run in any order and on any thread.
+*
+* @param    pool        the thread pool
+* @param    fn          task function
+* @param    ctx         context passed to every task
+* @param    num_tasks   number of tasks
+*/
+static inline void ThreadPool_run(struct ThreadPool *pool, task_fn fn, void *ctx, int num_tasks)
+{
+    if (num_tasks <= 0)
+        return;
+    pthread_mutex_lock(&pool->lock);
+    // no worker may still be inside the last batch when this one starts
+    while (pool->busy > 0)
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->num_tasks = num_tasks;
+    pool->next_task = 0;
+    pool->tasks_done = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    ThreadPool_work(pool, fn, ctx, num_tasks);
+
+    pthread_mutex_lock(&pool->lock);
+    while (__atomic_load_n(&pool->tasks_done, __ATOMIC_ACQUIRE) < num_tasks
+            || pool->busy > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static inline void ThreadPool_destroy(struct ThreadPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->num_threads - 1; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->workers);
+    free(pool);
+}
+
+/* Counts the '1's in each column of rows of ASCII '0'/'1' characters.
+   Each row becomes a bit vector (one bit per column) and is added into
+   BIT_COUNTER_PLANES bit-sliced vertical counters, so one row costs a few
+   word operations however wide it is. The vertical counters are flushed
+   into 64 bit column totals before they can overflow. */
+#define BIT_COUNTER_PLANES 8
+#define BIT_COUNTER_FLUSH ((1 << BIT_COUNTER_PLANES) - 1)
+
+struct BitColumnCounter {
+    int width;              // characters per row
+    int num_words;          // 64 bit words per row
+    int pending;            // rows in the vertical counters
+    unsigned long num_rows; // rows counted
+    uint64_t *row_bits;     // scratch bit vector for one row
+    uint64_t *planes;       // BIT_COUNTER_PLANES x num_words
+    uint64_t *counts;       // number of '1's in each column
+};
+
+static inline struct BitColumnCounter *BitColumnCounter_create(int width)
+{
+    struct BitColumnCounter *counter = calloc(1, sizeof(struct BitColumnCounter));
+    if (counter == NULL) {
+        printf("Error: Could not allocate bit column counter.\n");
+        exit(-1);
+    }
+    counter->width = width;
+    counter->num_words = (width + 63) / 64;
+    counter->row_bits = calloc(counter->num_words, sizeof(uint64_t));
+    counter->planes = calloc(BIT_COUNTER_PLANES * counter->num_words, sizeof(uint64_t));
+    counter->counts = calloc(width, sizeof(uint64_t));
+    if (counter->row_bits == NULL || counter->planes == NULL || counter->counts == NULL) {
+        printf("Error: Could not allocate bit column counter of width %d.\n", width);
+        exit(-1);
+    }
+    return counter;
+}
+
+static inline void BitColumnCounter_destroy(struct BitColumnCounter *counter)
+{
+    free(counter->row_bits);
+    free(counter->planes);
+    free(counter->counts);
+    free(counter);
+}
+
+/*
+* Move the vertical counters into the column totals
+*
+* @param    counter     the column counter
+*/
+static inline void BitColumnCounter_flush(struct BitColumnCounter *counter)
+{
+    for (int col = 0; col < counter->width; col++) {
+        int word = col / 64, bit = col % 64;
+        uint64_t count = 0;
+        for (int k = 0; k < BIT_COUNTER_PLANES; k++) {
+            count |= ((counter->planes[k * counter->num_words + word] >> bit) & 1) << k;
+        }
+        counter->counts[col] += count;
+    }
+    memset(counter->planes, 0, BIT_COUNTER_PLANES * counter->num_words * sizeof(uint64_t));
+    counter->pending = 0;
+}
+
+/*
+* Add one row to the column counts
+*
+* @param    counter     the column counter
+* @param    row         counter->width characters, '1' counts and anything else doesn't
+*/
+static inline void BitColumnCounter_add_row(struct BitColumnCounter *counter, const char *row)
+{
+    uint64_t *bits = counter->row_bits;
+    memset(bits, 0, counter->num_words * sizeof(uint64_t));
+    int col = 0;
+#ifdef __SSE2__
+    // compare 16 characters at once and pack the results into 16 bits
+    const __m128i ones = _mm_set1_epi8('1');
+    for (; col + 16 <= counter->width; col += 16) {
+        __m128i chars = _mm_loadu_si128((const __m128i *)(row + col));
+        uint64_t mask = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, ones));
+        bits[col / 64] |= mask << (col % 64);
+    }
+#endif
+    for (; col < counter->width; col++) {
+        bits[col / 64] |= (uint64_t)(row[col] == '1') << (col % 64);
+    }
+
+    // ripple carry add of the row into the vertical counters
+    for (int word = 0; word < counter->num_words; word++) {
+        uint64_t carry = bits[word];
+        for (int k = 0; k < BIT_COUNTER_PLANES && carry; k++) {
+            uint64_t *plane = &counter->planes[k * counter->num_words + word];
+            uint64_t next_carry = *plane & carry;
+            *plane ^= carry;
+            carry = next_carry;
+        }
+    }
+    counter->num_rows++;
+    if (++counter->pending == BIT_COUNTER_FLUSH)
+        BitColumnCounter_flush(counter);
+}
+
+/*
+* Count the '1's in each column of a stream of equal length rows.
+* The stream is read in large chunks, so inputs of any size work.
+*
+* @param    data        stream to read
+* @retval   counter     column counts (caller frees), NULL if there are no rows
+*/
+static inline struct BitColumnCounter *count_bit_columns(FILE *data)
+{
+    size_t capacity = 1 << 20;
+    size_t filled = 0;
+    char *buffer = malloc(capacity + 1);
+    struct BitColumnCounter *counter = NULL;
+    int eof = 0;
+    if (buffer == NULL) {
+        printf("Error: Could not allocate read buffer.\n");
+        exit(-1);
+    }
+
+    while (!eof) {
+        size_t got = fread(buffer + filled, 1, capacity - filled, data);
+        filled += got;
+        if (got == 0) {
+            eof = 1;
+            // make sure the last row ends in a newline
+            if (filled > 0 && buffer[filled - 1] != '\n')
+                buffer[filled++] = '\n';
+        }
+
+        char *row = buffer, *end = buffer + filled, *newline;
+        while ((newline = memchr(row, '\n', end - row)) != NULL) {
+            int len = newline - row;
+            if (len > 0 && row[len - 1] == '\r')
+                len--;
+            if (len > 0) {
+                if (counter == NULL)
+                    counter = BitColumnCounter_create(len);
+                if (len != counter->width) {
+                    printf("Error: Row of width %d, expected %d.\n", len, counter->width);
+                    exit(-1);
+                }
+                BitColumnCounter_add_row(counter, row);
+            }
+            row = newline + 1;
+        }
+
+        // keep the partial row for the next chunk, making room if it fills the buffer
+        filled = end - row;
+        memmove(buffer, row, filled);
+        if (filled == capacity) {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity + 1);
+            if (buffer == NULL) {
+                printf("Error: Could not grow read buffer.\n");
+                exit(-1);
+            }
+        }
+    }
+
+    free(buffer);
+    if (counter != NULL)
+        BitColumnCounter_flush(counter);
+    return counter;
+}
+
+/*
+* Read a whole file into memory, or fail without exiting. A directory
+* fails with EISDIR rather than with the size it seeks to.
+*
+* @param    path        file to read
+* @param    p_size      pointer to the file size (output)
+* @retval   buffer      file contents plus a terminating zero (caller frees),
+*                       NULL (and errno and errnum set) if it cannot be read
+*/
+static inline char *try_read_file(const char *path, size_t *p_size)
+{
+    FILE *data = fopen(path, "r");
+    if (data == NULL) {
+        errnum = 1;
+        return NULL;
+    }
+    struct stat info;
+    char *buffer = NULL;
+    long file_size = -1;
+    if (fstat(fileno(data), &info) == 0 && S_ISDIR(info.st_mode))
+        errno = EISDIR;
+    else if (fseek(data, 0, SEEK_END) == 0)
+        file_size = ftell(data);
+    if (file_size >= 0) {
+        rewind(data);
+        buffer = malloc(file_size + 1);
+    }
+    if (buffer != NULL && fread(buffer, 1, file_size, data) != (size_t)file_size) {
+        if (!ferror(data))
+            errno = EIO; // the file shrank while it was read
+        free(buffer);
+        buffer = NULL;
+    }
+    int saved_errno = errno;
+    fclose(data);
+    if (buffer == NULL) {
+        errno = saved_errno;
+        errnum = 1;
+        return NULL;
+    }
+    buffer[file_size] = '\0';
+    *p_size = file_size;
+    return buffer;
+}
+
+/*
+* Read a whole file into memory, exiting if it cannot be read
+*
+* @param    path        file to read
+* @param    p_size      pointer to the file size (output)
+* @retval   buffer      file contents plus a terminating zero (caller frees)
+*/
+static inline char *read_file(const char *path, size_t *p_size)
+{
+    char *buffer = try_read_file(path, p_size);
+    if (buffer == NULL) {
+        printf("Error reading %s: %s.\n", path, strerror(errno));
+        exit(-1);
+    }
+    return buffer;
+}
+
+/*
+* Push an int onto the end of a growable array
+*
+* @param    p_array     pointer to the array (may be moved)
+* @param    p_n         pointer to the number of elements
+* @param    p_capacity  pointer to the capacity of the array
+* @param    element     element to add
+*/
+static inline void int_push(int **p_array, int *p_n, int *p_capacity, int element)
+{
+    if (*p_n == *p_capacity) {
+        *p_capacity = (*p_capacity) ? *p_capacity * 2 : 256;
+        *p_array = realloc(*p_array, *p_capacity * sizeof(int));
+        assert(*p_array != NULL);
+    }
+    (*p_array)[(*p_n)++] = element;
+}
+
+/* Integer parsing for the puzzle inputs. Anything that isn't a digit is
+   a delimiter, and a '-' directly in front of a digit makes the number
+   negative, so "1,2", "0,9 -> 5,9" and "fold along x=-3" all parse
+   without being told the delimiters (but "3-4" reads as 3 and -4).
+   Delimiters are skipped 16 bytes at a time with vector compares and
+   digit runs are converted 8 digits at a time. Nothing is kept between
+   calls, so threads can parse separate buffers at the same time. */
+#define IS_DIGIT(c) ((unsigned char)((c) - '0') < 10)
+
+/*
+* Find the next digit or '-' in a buffer
+*
+* @param    p           where to start looking
+* @param    end         end of the buffer
+* @retval   p           the first digit or '-' at or after p, end if none
+*/
+static inline const char *skip_to_number(const char *p, const char *end)
+{
+    // most delimiters are a character or two, so try those first
+    int i;
+    for (i = 0; i < 2 && p < end; i++, p++) {
+        if (IS_DIGIT(*p) || *p == '-')
+            return p;
+    }
+#ifdef __SSE2__
+    const __m128i below = _mm_set1_epi8('0' - 1);
+    const __m128i above = _mm_set1_epi8('9' + 1);
+    const __m128i minus = _mm_set1_epi8('-');
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmplt_epi8(v, above));
+        int mask = _mm_movemask_epi8(_mm_or_si128(digits, _mm_cmpeq_epi8(v, minus)));
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && !IS_DIGIT(*p) && *p != '-')
+        p++;
+    return p;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/*
+* Combine 8 digit values (one per byte, first digit in the lowest byte)
+* into a number: pairs of digits, then pairs of pairs, then the halves.
+*
+* @param    val         the digit bytes (ASCII or already minus '0')
+* @retval   value       the number
+*/
+static inline uint64_t combine_digits(uint64_t val)
+{
+    val = ((val & 0x0F0F0F0F0F0F0F0F) * 2561) >> 8;
+    val = ((val & 0x00FF00FF00FF00FF) * 6553601) >> 16;
+    return ((val & 0x0000FFFF0000FFFF) * 42949672960001) >> 32;
+}
+#endif
+
+/*
+* Convert the next 8 characters to a number if they are all digits
+*
+* @param    p           characters to convert (at least 8 available)
+* @param    p_value     the number (output)
+* @retval   1           converted
+* @retval   0           not 8 digits, nothing converted
+*/
+static inline int parse_eight_digits(const char *p, uint64_t *p_value)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t val;
+    memcpy(&val, p, sizeof(val));
+    // every byte 0x30 - 0x39: high nibble 3, and adding 6 doesn't carry into it
+    if (((val & 0xF0F0F0F0F0F0F0F0) |
+            (((val + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) != 0x3333333333333333)
+        return 0;
+    *p_value = combine_digits(val);
+    return 1;
+#else
+    uint64_t val = 0;
+    int i;
+    for (i = 0; i < 8; i++) {
+        if (!IS_DIGIT(p[i]))
+            return 0;
+        val = val * 10 + (p[i] - '0');
+    }
+    *p_value = val;
+    return 1;
+#endif
+}
+
+/*
+* Parse the next integer in a buffer. A number too big for an int64_t
+* reads as INT64_MAX (or INT64_MIN) and sets errnum.
+*
+* @param    p           where to start looking
+* @param    end         end of the buffer
+* @param    p_value     the number (output)
+* @retval   p           just past the number, NULL if there are no more
+*/
+static inline const char *next_int(const char *p, const char *end, int64_t *p_value)
+{
+    while ((p = skip_to_number(p, end)) < end) {
+        if (*p != '-')
+            break;
+        if (end - p > 1 && IS_DIGIT(p[1]))
+            break;
+        p++; // a '-' on its own is a delimiter
+    }
+    if (p >= end)
+        return NULL;
+
+    int negative = (*p == '-');
+    p += negative;
+    uint64_t value = 0, eight;
+#if defined(__SSE2__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // numbers of up to 8 digits: find the length with one compare and
+    // shift the digits to the top of a word, leaving zeros in front
+    if (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+        int len = __builtin_ctz(~_mm_movemask_epi8(digits));
+        if (len <= 8) {
+            memcpy(&eight, p, sizeof(eight));
+            value = combine_digits((eight & 0x0F0F0F0F0F0F0F0F) << (8 * (8 - len)));
+            *p_value = (negative) ? -(int64_t)value : (int64_t)value;
+            return p + len;
+        }
+    }
+#endif
+    int overflow = 0;
+    while (end - p >= 8 && parse_eight_digits(p, &eight)) {
+        overflow |= value > (UINT64_MAX - eight) / 100000000;
+        value = value * 100000000 + eight;
+        p += 8;
+    }
+    while (p < end && IS_DIGIT(*p)) {
+        overflow |= value > (UINT64_MAX - 9) / 10;
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    if (overflow || value > (uint64_t)INT64_MAX + negative) {
+        errnum = 1;
+        *p_value = (negative) ? INT64_MIN : INT64_MAX;
+        return p;
+    }
+    *p_value = (negative) ? (int64_t)(0 - value) : (int64_t)value;
+    return p;
+}
+
+/*
+* Parse every integer in a buffer onto the end of a growable int array
+*
+* @param    str         characters to parse
+* @param    len         number of characters
+* @param    p_array     pointer to the array (may be moved)
+* @param    p_n         pointer to the number of elements
+* @param    p_capacity  pointer to the capacity of the array
+* @retval   num         number of integers added, -1 (and errnum set) if
+*                       one does not fit in an int, after adding those
+*                       before it
+*/
+static inline int parse_ints(const char *str, size_t len, int **p_array, int *p_n, int *p_capacity)
+{
+    const char *p = str, *end = str + len;
+    int start = *p_n;
+    int64_t value;
+    while ((p = next_int(p, end, &value)) != NULL) {
+        if (value < INT_MIN || value > INT_MAX) {
+            errnum = 1;
+            return -1;
+        }
+        int_push(p_array, p_n, p_capacity, (int)value);
+    }
+    return *p_n - start;
+}
+
+/*
+* Parse every integer in a buffer onto the end of a growable int64_t array.
+* Numbers beyond int64_t are clamped, see next_int().
+*
+* @param    str         characters to parse
+* @param    len         number of characters
+* @param    p_array     pointer to the array (may be moved)
+* @param    p_n         pointer to the number of elements
+* @param    p_capacity  pointer to the capacity of the array
+* @retval   num         number of integers added
+*/
+static inline size_t parse_ints64(const char *str, size_t len, int64_t **p_array, size_t *p_n,
+        size_t *p_capacity)
+{
+    const char *p = str, *end = str + len;
+    size_t start = *p_n;
+    int64_t value;
+    while ((p = next_int(p, end, &value)) != NULL) {
+        if (*p_n == *p_capacity) {
+            *p_capacity = (*p_capacity) ? *p_capacity * 2 : 256;
+            *p_array = realloc(*p_array, *p_capacity * sizeof(int64_t));
+            assert(*p_array != NULL);
+        }
+        (*p_array)[(*p_n)++] = value;
+    }
+    return *p_n - start;
+}
+
+/* A bump allocator for objects that live as long as a run (or a phase of
+   one). Allocation is a pointer bump inside the current block; a new
+   block is chained on when it is full. Nothing is freed one at a time:
+   Arena_reset() rolls back to an Arena_mark(), and Arena_destroy()
+   releases everything in one go. An allocation can't grow in place, so
+   arrays built up with realloc() and the growable containers stay on
+   malloc. */
+#define ARENA_BLOCK_SIZE (1 << 20)
+#define ARENA_ALIGN 16
+
+struct ArenaBlock {
+    struct ArenaBlock *prev;    // block filled before this one
+    size_t size;                // bytes in data[]
+    size_t used;
+    char data[];
+};
+
+struct Arena {
+    struct ArenaBlock *block;   // current block
+    size_t block_size;          // size of new blocks
+    size_t total;               // bytes handed out, for reporting
+};
+
+struct ArenaMark {
+    struct ArenaBlock *block;
+    size_t used;
+    size_t total;
+};
+
+/*
+* Create an empty arena
+*
+* @param    block_size  bytes per block, 0 for ARENA_BLOCK_SIZE
+* @retval   arena       the arena (free with Arena_destroy())
+*/
+static inline struct Arena *Arena_create(size_t block_size)
+{
+    struct Arena *arena = calloc(1, sizeof(struct Arena));
+    if (arena == NULL) {
+        printf("Error: Could not allocate arena.\n");
+        exit(-1);
+    }
+    arena->block_size = (block_size) ? block_size : ARENA_BLOCK_SIZE;
+    return arena;
+}
+
+/*
+* Allocate from an arena with a given alignment
+*
+* @param    arena       arena to allocate from
+* @param    size        bytes to allocate
+* @param    align       alignment, a power of 2
+* @retval   ptr         uninitialized memory, valid until reset or destroy
+*/
+static inline void *Arena_alloc_aligned(struct Arena *arena, size_t size, size_t align)
+{
+    assert(align > 0 && (align & (align - 1)) == 0);
+    struct ArenaBlock *block = arena->block;
+    if (block != NULL) {
+        uintptr_t start = (uintptr_t)(block->data + block->used);
+        size_t pad = (align - (start & (align - 1))) & (align - 1);
+        if (block->used + pad + size <= block->size) {
+            block->used += pad + size;
+            arena->total += size;
+            return (void *)(start + pad);
+        }
+    }
+
+    // start a new block, big enough for this allocation on its own
+    size_t block_size = arena->block_size;
+    if (size + align > block_size)
+        block_size = size + align;
+    block = malloc(sizeof(struct ArenaBlock) + block_size);
+    if (block == NULL) {
+        printf("Error: Could not allocate arena block of %zu bytes.\n", block_size);
+        exit(-1);
+    }
+    block->prev = arena->block;
+    block->size = block_size;
+    block->used = 0;
+    arena->block = block;
+    return Arena_alloc_aligned(arena, size, align);
+}
+
+/*
+* Allocate from an arena, aligned for any type
+*
+* @param    arena       arena to allocate from
+* @param    size        bytes to allocate
+* @retval   ptr         uninitialized memory, valid until reset or destroy
+*/
+static inline void *Arena_alloc(struct Arena *arena, size_t size)
+{
+    return Arena_alloc_aligned(arena, size, ARENA_ALIGN);
+}
+
+/*
+* Allocate zeroed memory for an array from an arena
+*
+* @param    arena       arena to allocate from
+* @param    n           number of elements
+* @param    size        bytes per element
+* @retval   ptr         zeroed memory, valid until reset or destroy
+*/
+static inline void *Arena_calloc(struct Arena *arena, size_t n, size_t size)
+{
+    void *ptr = Arena_alloc(arena, n * size);
+    memset(ptr, 0, n * size);
+    return ptr;
+}
+
+/*
+* Copy a string (or the first n characters of one) into an arena
+*
+* @param    arena       arena to allocate from
+* @param    str         string to copy
+* @param    n           maximum characters to copy
+* @retval   copy        zero terminated copy
+*/
+static inline char *Arena_strndup(struct Arena *arena, const char *str, size_t n)
+{
+    size_t len = strnlen(str, n);
+    char *copy = Arena_alloc_aligned(arena, len + 1, 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/*
+* Remember the current state of an arena, to roll back to later
+*
+* @param    arena       the arena
+* @retval   mark        position to pass to Arena_reset()
+*/
+static inline struct ArenaMark Arena_mark(struct Arena *arena)
+{
+    struct ArenaMark mark = { arena->block, 0, arena->total };
+    if (arena->block != NULL)
+        mark.used = arena->block->used;
+    return mark;
+}
+
+/*
+* Free everything allocated since a mark. The first block is kept for
+* reuse even when resetting to a mark taken before it, so that an arena
+* reset in a loop does not allocate a block every time around.
+*
+* @param    arena       the arena
+* @param    mark        from Arena_mark(), or { 0 } to empty the arena
+*/
+static inline void Arena_reset(struct Arena *arena, struct ArenaMark mark)
+{
+    while (arena->block != mark.block) {
+        if (arena->block == NULL) {
+            printf("Error: Arena_reset() to a mark from another arena.\n");
+            exit(-1);
+        }
+        struct ArenaBlock *prev = arena->block->prev;
+        if (prev == NULL && mark.block == NULL)
+            break;
+        free(arena->block);
+        arena->block = prev;
+    }
+    if (arena->block != NULL)
+        arena->block->used = mark.used;
+    arena->total = mark.total;
+}
+
+/*
+* Free an arena and everything allocated from it
+*
+* @param    arena       the arena
+*/
+static inline void Arena_destroy(struct Arena *arena)
+{
+    if (arena == NULL)
+        return;
+    Arena_reset(arena, (struct ArenaMark){ 0 });
+    free(arena->block);
+    free(arena);
+}
+
+/* XXH64, the 64 bit xxHash of a block of memory. Fast enough to hash a
+   whole input every time it is read, and the same on every machine, so
+   the hash can name things on disk. */
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ull
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define XXH_PRIME64_3 0x165667B19E3779F9ull
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ull
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ull
+
+static inline uint64_t xxh64_rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t xxh64_read64(const unsigned char *p)
+{
+    uint64_t val;
+    memcpy(&val, p, sizeof(val));
+    return val;                 // little endian only, like the SIMD parsing
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    return xxh64_rotl(acc, 31) * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh64_round(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+/*
+* Hash a block of memory
+*
+* @param    data        bytes to hash
+* @param    len         number of bytes
+* @param    seed        seed, 0 for the standard hash
+* @retval   hash        64 bit XXH64 hash
+*/
+static inline uint64_t xxh64(const void *data, size_t len, uint64_t seed)
+{
+    const unsigned char *p = data;
+    const unsigned char *end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+        do {
+            v1 = xxh64_round(v1, xxh64_read64(p));
+            v2 = xxh64_round(v2, xxh64_read64(p + 8));
+            v3 = xxh64_round(v3, xxh64_read64(p + 16));
+            v4 = xxh64_round(v4, xxh64_read64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+        h = xxh64_rotl(v1, 1) + xxh64_rotl(v2, 7) + xxh64_rotl(v3, 12)
+            + xxh64_rotl(v4, 18);
+        h = xxh64_merge(h, v1);
+        h = xxh64_merge(h, v2);
+        h = xxh64_merge(h, v3);
+        h = xxh64_merge(h, v4);
+    } else {
+        h = seed + XXH_PRIME64_5;
+    }
+    h += len;
+
+    for (; end - p >= 8; p += 8) {
+        h ^= xxh64_round(0, xxh64_read64(p));
+        h = xxh64_rotl(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (end - p >= 4) {
+        uint32_t word;
+        memcpy(&word, p, sizeof(word));
+        h ^= word * XXH_PRIME64_1;
+        h = xxh64_rotl(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= *p * XXH_PRIME64_5;
+        h = xxh64_rotl(h, 11) * XXH_PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+#endif